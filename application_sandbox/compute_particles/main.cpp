@@ -16,6 +16,7 @@
 #include "support/containers/deque.h"
 #include "support/entry/entry.h"
 #include "vulkan_helpers/buffer_frame_data.h"
+#include "vulkan_helpers/draw_constants.h"
 #include "vulkan_helpers/helper_functions.h"
 #include "vulkan_helpers/vulkan_application.h"
 #include "vulkan_helpers/vulkan_model.h"
@@ -24,6 +25,7 @@
 #include "particle_data_shared.h"
 
 #include <chrono>
+#include <cstddef>
 
 #include <condition_variable>
 #include <functional>
@@ -62,11 +64,28 @@ struct time_data {
   float time;
 };
 
+// The layout that the simulation stores the particles in, see
+// particle_data_shared.h. The particle_storage sample compares them.
+const int32_t kSimulationLayout = SIMULATION_LAYOUT_AOS;
+
+// The specialization constants of the compute shaders.
+struct SimulationConstants {
+  int32_t layout;
+  uint32_t num_particles;
+};
+
+const VkSpecializationMapEntry kSimulationConstantEntries[2] = {
+    {0, offsetof(SimulationConstants, layout), sizeof(int32_t)},
+    {1, offsetof(SimulationConstants, num_particles), sizeof(uint32_t)},
+};
+
 class ComputeTask {
  public:
-  ComputeTask(containers::Allocator* allocator, vulkan::VulkanApplication* app)
+  ComputeTask(containers::Allocator* allocator, vulkan::VulkanApplication* app,
+              int32_t simulation_layout)
       : allocator_(allocator),
         compute_data_(allocator),
+        simulation_layout_(simulation_layout),
         app_(app),
         last_update_time_(std::chrono::high_resolution_clock::now()) {
     if (!app_->async_compute_queue()) {
@@ -146,23 +165,8 @@ class ComputeTask {
         ->vkBeginCommandBuffer(*initial_data_buffer,
                                &sample_application::kBeginCommandBuffer);
 
-    // Create the single SSBO for simulation
-    VkBufferCreateInfo create_info = {
-        VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,       // sType
-        nullptr,                                    // pNext
-        0,                                          // createFlags
-        sizeof(simulation_data) * TOTAL_PARTICLES,  // size
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,    // usageFlags
-        VK_SHARING_MODE_EXCLUSIVE,                 // sharingMode
-        0,                                         // queueFamilyIndexCount
-        nullptr                                    // pQueueFamilyIndices
-    };
-
-    simulation_ssbo_ = app_->CreateAndBindDeviceBuffer(&create_info);
-
     srand(0);
-    // Fill this SSBO with random initial positions.
+    // Fill the simulation with random initial positions.
     containers::vector<simulation_data> fill_data(allocator_);
     fill_data.resize(TOTAL_PARTICLES);
     for (auto& particle : fill_data) {
@@ -181,14 +185,45 @@ class ComputeTask {
       particle.position_velocity[3] = posx * 0.05f;
     }
 
-    // Fill the buffer. Technically we probably want to use a staging buffer
-    // and fill from that, since this is not really a "small" buffer.
+    // Fill the buffers. Technically we probably want to use a staging buffer
+    // and fill from that, since these are not really "small" buffers.
     // However, we have this helper function, so might as well use it.
-    app_->FillSmallBuffer(
-        simulation_ssbo_.get(), fill_data.data(),
-        fill_data.size() * sizeof(simulation_data), 0,
-        initial_data_buffer.get(),
-        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    if (simulation_layout_ == SIMULATION_LAYOUT_AOS) {
+      simulation_ssbo_ = CreateSimulationSSBO(sizeof(simulation_data));
+      FillSimulationSSBO(simulation_ssbo_.get(), fill_data.data(),
+                         fill_data.size() * sizeof(simulation_data),
+                         initial_data_buffer.get());
+    } else {
+      containers::vector<float> positions(allocator_);
+      containers::vector<float> velocities(allocator_);
+      containers::vector<uint32_t> half_positions(allocator_);
+      positions.reserve(2 * TOTAL_PARTICLES);
+      velocities.reserve(2 * TOTAL_PARTICLES);
+      for (auto& particle : fill_data) {
+        const Vector4& data = particle.position_velocity;
+        positions.push_back(data[0]);
+        positions.push_back(data[1]);
+        velocities.push_back(data[2]);
+        velocities.push_back(data[3]);
+        if (simulation_layout_ == SIMULATION_LAYOUT_SOA_HALF) {
+          half_positions.push_back(PackHalf2x16(Vector2(data[0], data[1])));
+        }
+      }
+      position_ssbo_ = CreateSimulationSSBO(2 * sizeof(float));
+      FillSimulationSSBO(position_ssbo_.get(), positions.data(),
+                         positions.size() * sizeof(float),
+                         initial_data_buffer.get());
+      velocity_ssbo_ = CreateSimulationSSBO(2 * sizeof(float));
+      FillSimulationSSBO(velocity_ssbo_.get(), velocities.data(),
+                         velocities.size() * sizeof(float),
+                         initial_data_buffer.get());
+      if (simulation_layout_ == SIMULATION_LAYOUT_SOA_HALF) {
+        half_position_ssbo_ = CreateSimulationSSBO(sizeof(uint32_t));
+        FillSimulationSSBO(half_position_ssbo_.get(), half_positions.data(),
+                           half_positions.size() * sizeof(uint32_t),
+                           initial_data_buffer.get());
+      }
+    }
 
     (*initial_data_buffer)->vkEndCommandBuffer(*initial_data_buffer);
 
@@ -215,6 +250,46 @@ class ComputeTask {
         ->vkQueueWaitIdle((*app_->async_compute_queue()));
   }
 
+  // Creates an SSBO with |particle_size| bytes for every particle, that only
+  // the simulation uses.
+  containers::unique_ptr<vulkan::VulkanApplication::Buffer>
+  CreateSimulationSSBO(size_t particle_size) {
+    VkBufferCreateInfo create_info = {
+        VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,  // sType
+        nullptr,                               // pNext
+        0,                                     // createFlags
+        particle_size * TOTAL_PARTICLES,       // size
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,  // usageFlags
+        VK_SHARING_MODE_EXCLUSIVE,               // sharingMode
+        0,                                       // queueFamilyIndexCount
+        nullptr                                  // pQueueFamilyIndices
+    };
+    return app_->CreateAndBindDeviceBuffer(&create_info);
+  }
+
+  void FillSimulationSSBO(vulkan::VulkanApplication::Buffer* buffer,
+                          const void* data, size_t size,
+                          vulkan::VkCommandBuffer* command_buffer) {
+    app_->FillSmallBuffer(
+        buffer, data, size, 0, command_buffer,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+  }
+
+  // The buffer to bind for one of the simulation SSBOs. Those that the layout
+  // does not use are never accessed, but still need a valid buffer.
+  VkDescriptorBufferInfo SimulationBufferInfo(
+      const vulkan::VulkanApplication::Buffer* buffer) const {
+    if (!buffer) {
+      buffer = simulation_ssbo_ ? simulation_ssbo_.get() : position_ssbo_.get();
+    }
+    return {
+        *buffer,         // buffer
+        0,               // offset
+        buffer->size(),  // range
+    };
+  }
+
   void InitComputeTaskData() {
     // For each async compute buffer, we have to create the semaphore,
     // the command_buffers, descriptor sets, and some synchronization data.
@@ -227,24 +302,26 @@ class ComputeTask {
               allocator_, app_->AllocateDescriptorSet(
                               {compute_descriptor_set_layouts_[0],
                                compute_descriptor_set_layouts_[1],
-                               compute_descriptor_set_layouts_[2]}))});
+                               compute_descriptor_set_layouts_[2],
+                               compute_descriptor_set_layouts_[3],
+                               compute_descriptor_set_layouts_[4],
+                               compute_descriptor_set_layouts_[5]}))});
 
-      VkDescriptorBufferInfo buffer_infos[3] = {
+      VkDescriptorBufferInfo buffer_infos[6] = {
           {
               update_time_data_->get_buffer(),             // buffer
               update_time_data_->get_offset_for_frame(i),  // offset
               update_time_data_->size(),                   // range
           },
-          {
-              *simulation_ssbo_,         // buffer
-              0,                         // offset
-              simulation_ssbo_->size(),  // range
-          },
+          SimulationBufferInfo(simulation_ssbo_.get()),
           {
               *render_ssbo_,         // buffer
               0,                     // offset
               render_ssbo_->size(),  // range
           },
+          SimulationBufferInfo(position_ssbo_.get()),
+          SimulationBufferInfo(velocity_ssbo_.get()),
+          SimulationBufferInfo(half_position_ssbo_.get()),
       };
       VkWriteDescriptorSet write = {
           VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,         // sType
@@ -252,7 +329,7 @@ class ComputeTask {
           *compute_data_.back().compute_descriptor_set_,  // dstSet
           0,                                              // dstbinding
           0,                                              // dstArrayElement
-          3,                                              // descriptorCount
+          6,                                              // descriptorCount
           VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,              // descriptorType
           nullptr,                                        // pImageInfo
           buffer_infos,                                   // pBufferInfo
@@ -294,16 +371,12 @@ class ComputeTask {
       // Run the first half of the simulation.
       command_buffer->vkCmdDispatch(
           command_buffer, TOTAL_PARTICLES / COMPUTE_SHADER_LOCAL_SIZE, 1, 1);
-      VkBufferMemoryBarrier simulation_barrier = {
-          VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,  // sType
-          nullptr,                                  // pNext
-          VK_ACCESS_SHADER_WRITE_BIT,               // srcAccessMask
-          VK_ACCESS_SHADER_READ_BIT,                // dstAccessMask
-          VK_QUEUE_FAMILY_IGNORED,                  // srcQueueFamilyIndex
-          VK_QUEUE_FAMILY_IGNORED,                  // dstQueueFamilyIndex
-          *simulation_ssbo_,                        // buffer
-          0,                                        //  offset
-          simulation_ssbo_->size(),                 // size
+      // This covers whichever SSBOs the layout keeps the simulation in.
+      VkMemoryBarrier simulation_barrier = {
+          VK_STRUCTURE_TYPE_MEMORY_BARRIER,  // sType
+          nullptr,                           // pNext
+          VK_ACCESS_SHADER_WRITE_BIT,        // srcAccessMask
+          VK_ACCESS_SHADER_READ_BIT,         // dstAccessMask
       };
       // Wait for all of the updates to velocity to be done before
       // moving on to the position updates. This is because the velocity
@@ -311,8 +384,8 @@ class ComputeTask {
       // particles, so avoid race conditions.
       command_buffer->vkCmdPipelineBarrier(
           command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1,
-          &simulation_barrier, 0, nullptr);
+          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &simulation_barrier, 0,
+          nullptr, 0, nullptr);
       command_buffer->vkCmdBindPipeline(command_buffer,
                                         VK_PIPELINE_BIND_POINT_COMPUTE,
                                         *position_update_pipeline_);
@@ -363,13 +436,37 @@ class ComputeTask {
         nullptr                             // pImmutableSamplers
     };
 
+    // The SSBOs that the simulation may be kept in, besides the one at
+    // binding 1. The layout picks which are used.
+    for (uint32_t i = 3; i < 6; ++i) {
+      compute_descriptor_set_layouts_[i] = {
+          i,                                  // binding
+          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,  // descriptorType
+          1,                                  // descriptorCount
+          VK_SHADER_STAGE_COMPUTE_BIT,        // stageFlags
+          nullptr                             // pImmutableSamplers
+      };
+    }
+
+    const SimulationConstants constants = {simulation_layout_,
+                                           TOTAL_PARTICLES};
+    const VkSpecializationInfo specialization_info = {
+        2,                           // mapEntryCount
+        kSimulationConstantEntries,  // pMapEntries
+        sizeof(constants),           // dataSize
+        &constants,                  // pData
+    };
+
     // This is the pipeline that updates the position, and transfers
     // the data to the other thread.
     compute_pipeline_layout_ = containers::make_unique<vulkan::PipelineLayout>(
         allocator_,
         app_->CreatePipelineLayout({{compute_descriptor_set_layouts_[0],
                                      compute_descriptor_set_layouts_[1],
-                                     compute_descriptor_set_layouts_[2]}}));
+                                     compute_descriptor_set_layouts_[2],
+                                     compute_descriptor_set_layouts_[3],
+                                     compute_descriptor_set_layouts_[4],
+                                     compute_descriptor_set_layouts_[5]}}));
     position_update_pipeline_ =
         containers::make_unique<vulkan::VulkanComputePipeline>(
             allocator_,
@@ -378,7 +475,7 @@ class ComputeTask {
                 VkShaderModuleCreateInfo{
                     VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, nullptr, 0,
                     sizeof(simulation_shader), simulation_shader},
-                "main"));
+                "main", &specialization_info));
 
     // This is the pipeline that updates the velocity based on all of the
     // particles positions.
@@ -389,7 +486,7 @@ class ComputeTask {
             VkShaderModuleCreateInfo{
                 VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, nullptr, 0,
                 sizeof(velocity_shader), velocity_shader},
-            "main"));
+            "main", &specialization_info));
   }
 
   void InitRenderSSBO() {
@@ -427,10 +524,19 @@ class ComputeTask {
   containers::Allocator* allocator_;
   // The actual data associated with those buffers.
   containers::vector<ComputeTaskData> compute_data_;
-  // This SSBO contains all of the up-to-date simulation information.
-  // It is shared by all frames, since all frames need the most up-to-date
-  // data.
+  // How the simulation is stored, one of the SIMULATION_LAYOUT_* values.
+  int32_t simulation_layout_;
+  // These SSBOs contain all of the up-to-date simulation information.
+  // They are shared by all frames, since all frames need the most
+  // up-to-date data. With SIMULATION_LAYOUT_AOS it is all in
+  // simulation_ssbo_, otherwise the positions and velocities are in
+  // position_ssbo_ and velocity_ssbo_, and with SIMULATION_LAYOUT_SOA_HALF
+  // half_position_ssbo_ has a copy of the positions in half precision.
   containers::unique_ptr<vulkan::VulkanApplication::Buffer> simulation_ssbo_;
+  containers::unique_ptr<vulkan::VulkanApplication::Buffer> position_ssbo_;
+  containers::unique_ptr<vulkan::VulkanApplication::Buffer> velocity_ssbo_;
+  containers::unique_ptr<vulkan::VulkanApplication::Buffer>
+      half_position_ssbo_;
   // The SSBO used for actually rendering.
   containers::unique_ptr<vulkan::VulkanApplication::Buffer> render_ssbo_;
 
@@ -438,7 +544,7 @@ class ComputeTask {
   // position_update_pipeline_.
   containers::unique_ptr<vulkan::PipelineLayout> compute_pipeline_layout_;
   // These descriptor sets are shared by both pipelines as well.
-  VkDescriptorSetLayoutBinding compute_descriptor_set_layouts_[3];
+  VkDescriptorSetLayoutBinding compute_descriptor_set_layouts_[6];
   // This pipeline is used to update the velocity component of the
   // simulation_ssbo_.
   containers::unique_ptr<vulkan::VulkanComputePipeline> velocity_pipeline_;
@@ -479,9 +585,10 @@ class ComputeParticlesSample
                                           sample_application::SampleOptions()
                                               .EnableAsyncCompute()
                                               .EnableMultisampling()),
+        aspect_data_(1.0f, 1.0f, 1.0f, 1.0f),
         quad_model_(data->allocator(), data->logger(), quad_data),
         particle_texture_(data->allocator(), data->logger(), texture_data),
-        compute_task_(data->allocator(), app()) {
+        compute_task_(data->allocator(), app(), kSimulationLayout) {
     if (!app()->async_compute_queue()) {
       app()->GetLogger()->LogError("Could not find async compute queue.");
       set_invalid(true);
@@ -496,13 +603,6 @@ class ComputeParticlesSample
         VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
         nullptr                             // pImmutableSamplers
     };
-    particle_descriptor_set_layouts_[3] = {
-        3,                                  // binding
-        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,  // descriptorType
-        1,                                  // descriptorCount
-        VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
-        nullptr                             // pImmutableSamplers
-    };
     particle_descriptor_set_layouts_[1] = {
         1,                             // binding
         VK_DESCRIPTOR_TYPE_SAMPLER,    // descriptorType
@@ -527,8 +627,8 @@ class ComputeParticlesSample
         data_->allocator(),
         app()->CreatePipelineLayout({{particle_descriptor_set_layouts_[0],
                                       particle_descriptor_set_layouts_[1],
-                                      particle_descriptor_set_layouts_[2],
-                                      particle_descriptor_set_layouts_[3]}}));
+                                      particle_descriptor_set_layouts_[2]}},
+                                    {aspect_constants_.get()}));
 
     VkAttachmentReference color_attachment = {
         0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
@@ -588,9 +688,9 @@ class ComputeParticlesSample
   virtual void InitializeApplicationData(
       vulkan::VkCommandBuffer* initialization_buffer,
       size_t num_swapchain_images) override {
-    aspect_buffer_ = containers::make_unique<vulkan::BufferFrameData<Vector4>>(
-        data_->allocator(), app(), num_swapchain_images,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    aspect_constants_ =
+        containers::make_unique<vulkan::DrawConstants<Vector4>>(
+            data_->allocator(), app(), VK_SHADER_STAGE_VERTEX_BIT);
     // All of this is the fairly standard setup for rendering.
     quad_model_.InitializeData(app(), initialization_buffer);
     particle_texture_.InitializeData(app(), initialization_buffer);
@@ -615,8 +715,7 @@ class ComputeParticlesSample
             data_->allocator(), app()->AllocateDescriptorSet(
                                     {particle_descriptor_set_layouts_[0],
                                      particle_descriptor_set_layouts_[1],
-                                     particle_descriptor_set_layouts_[2],
-                                     particle_descriptor_set_layouts_[3]}));
+                                     particle_descriptor_set_layouts_[2]}));
 
     frame_data->render_semaphore_ =
         containers::make_unique<vulkan::VkSemaphore>(
@@ -673,7 +772,7 @@ class ComputeParticlesSample
       frames_since_last_notify_ = 0;
       time_since_last_notify_ = 0;
     }
-    aspect_buffer_->data()[0] =
+    aspect_data_[0] =
         (float)app()->swapchain().width() / (float)app()->swapchain().height();
   }
 
@@ -684,20 +783,12 @@ class ComputeParticlesSample
     // Get the next buffer that we use for the particle positions.
     auto* buffer = compute_task_.GetBufferForRender();
 
-    aspect_buffer_->UpdateBuffer(&app()->render_queue(), frame_index);
-
     // Write that buffer into the descriptor sets.
-    VkDescriptorBufferInfo buffer_infos[2] = {
-        {
-            *buffer,         // buffer
-            0,               // offset
-            buffer->size(),  // range
-        },
-        {
-            aspect_buffer_->get_buffer(),                       // buffer
-            aspect_buffer_->get_offset_for_frame(frame_index),  // offset
-            aspect_buffer_->size(),                             // range
-        }};
+    VkDescriptorBufferInfo buffer_info = {
+        *buffer,         // buffer
+        0,               // offset
+        buffer->size(),  // range
+    };
 
     VkDescriptorImageInfo sampler_info = {
         *sampler_,                 // sampler
@@ -710,7 +801,7 @@ class ComputeParticlesSample
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,  // imageLayout
     };
 
-    VkWriteDescriptorSet writes[4]{
+    VkWriteDescriptorSet writes[3]{
         {
             VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  // sType
             nullptr,                                 // pNext
@@ -720,19 +811,7 @@ class ComputeParticlesSample
             1,                                       // descriptorCount
             VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,       // descriptorType
             nullptr,                                 // pImageInfo
-            &buffer_infos[0],                        // pBufferInfo
-            nullptr,                                 // pTexelBufferView
-        },
-        {
-            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  // sType
-            nullptr,                                 // pNext
-            *data->particle_descriptor_set_,         // dstSet
-            3,                                       // dstbinding
-            0,                                       // dstArrayElement
-            1,                                       // descriptorCount
-            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,       // descriptorType
-            nullptr,                                 // pImageInfo
-            &buffer_infos[1],                        // pBufferInfo
+            &buffer_info,                            // pBufferInfo
             nullptr,                                 // pTexelBufferView
         },
         {
@@ -761,7 +840,7 @@ class ComputeParticlesSample
         },
     };
 
-    app()->device()->vkUpdateDescriptorSets(app()->device(), 4, writes, 0,
+    app()->device()->vkUpdateDescriptorSets(app()->device(), 3, writes, 0,
                                             nullptr);
 
     // Record our command-buffer for rendering this frame
@@ -815,6 +894,7 @@ class ComputeParticlesSample
         cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
         ::VkPipelineLayout(*pipeline_layout_), 0, 1,
         &data->particle_descriptor_set_->raw_set(), 0, nullptr);
+    aspect_constants_->Push(&cmdBuffer, *pipeline_layout_, aspect_data_);
     // We only have to draw one model N times, in the shader we move
     // each instance to the correct location.
     quad_model_.DrawInstanced(&cmdBuffer, TOTAL_PARTICLES);
@@ -863,14 +943,16 @@ class ComputeParticlesSample
   const entry::EntryData* data_;
 
   // All of the data needed for the particle rendering pipeline.
-  VkDescriptorSetLayoutBinding particle_descriptor_set_layouts_[4];
+  VkDescriptorSetLayoutBinding particle_descriptor_set_layouts_[3];
   containers::unique_ptr<vulkan::PipelineLayout> pipeline_layout_;
   containers::unique_ptr<vulkan::VulkanGraphicsPipeline> particle_pipeline_;
   containers::unique_ptr<vulkan::VkRenderPass> render_pass_;
 
-  // This ssbo just contains the aspect ratio. We use a Vector4 just so we
-  // get proper alignment.
-  containers::unique_ptr<vulkan::BufferFrameData<Vector4>> aspect_buffer_;
+  // The aspect ratio, which is pushed to the vertex shader with every draw.
+  // We use a Vector4 just so we get proper alignment. At 16 bytes it always
+  // fits in the push constant block, which particle.vert relies on.
+  Vector4 aspect_data_;
+  containers::unique_ptr<vulkan::DrawConstants<Vector4>> aspect_constants_;
   // A model of a quad with corners. (-1, -1), (1, 1), (-1, 1), (1, -1)
   vulkan::VulkanModel quad_model_;
   // A simple circular texture with falloff.
@@ -24,7 +24,7 @@ layout (binding = 0) buffer DrawData {
   draw_data drawData[TOTAL_PARTICLES];
 };
 
-layout (binding = 3) buffer frame {
+layout (push_constant) uniform frame {
     Vector4 aspect_data;
 };
 
@@ -25,6 +25,17 @@ struct simulation_data {
   Vector4 position_velocity;
 };
 
+// How the simulation stores the particles. The compute shaders pick one with
+// a specialization constant.
+// Every particle is one simulation_data.
+#define SIMULATION_LAYOUT_AOS 0
+// The positions and velocities of the particles are in separate arrays of
+// Vector2, so a pass that only needs the positions only reads those.
+#define SIMULATION_LAYOUT_SOA 1
+// Like SIMULATION_LAYOUT_SOA, and the velocity update reads the positions of
+// the other particles from a copy that is packed to half precision.
+#define SIMULATION_LAYOUT_SOA_HALF 2
+
 #define TOTAL_PARTICLES (1024 * 64)
 #define COMPUTE_SHADER_LOCAL_SIZE 128
 
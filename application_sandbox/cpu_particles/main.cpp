@@ -0,0 +1,481 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "application_sandbox/sample_application_framework/pipelined_update.h"
+#include "application_sandbox/sample_application_framework/sample_application.h"
+#include "support/entry/entry.h"
+#include "vulkan_helpers/buffer_frame_data.h"
+#include "vulkan_helpers/helper_functions.h"
+#include "vulkan_helpers/instance_ring.h"
+#include "vulkan_helpers/vulkan_application.h"
+#include "vulkan_helpers/vulkan_model.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include "mathfu/matrix.h"
+#include "mathfu/vector.h"
+
+using Mat44 = mathfu::Matrix<float, 4, 4>;
+using Vector4 = mathfu::Vector<float, 4>;
+
+namespace cube_model {
+#include "cube.obj.h"
+}
+const auto& cube_data = cube_model::model;
+
+uint32_t particle_vertex_shader[] =
+#include "particle.vert.spv"
+    ;
+
+uint32_t particle_fragment_shader[] =
+#include "particle.frag.spv"
+    ;
+
+// Set to false to run Update and Render one after the other, to compare.
+const bool kPipelinedUpdate = true;
+
+const uint32_t kNumParticles = 64 * 1024;
+const uint32_t kNumAttractors = 8;
+// Every Update integrates this many steps, to give it a CPU cost in the
+// same range as Render.
+const uint32_t kStepsPerUpdate = 8;
+// The number of frames that the frame, Update and Render times are averaged
+// over before they are logged.
+const uint32_t kFramesPerReport = 100;
+
+struct Particle {
+  float position[2];
+  float velocity[2];
+};
+
+// Everything that Update simulates, and Render draws.
+struct Simulation {
+  Particle particles[kNumParticles];
+  float time;
+  // How long the Update that produced this state took.
+  float update_ms;
+};
+
+// The per-instance vertex attributes, at locations 3 and 4.
+struct Instance {
+  float offset[3];
+  // RGBA, 8 bits each.
+  uint32_t color;
+};
+
+struct CpuParticlesFrameData {
+  containers::unique_ptr<vulkan::VkCommandBuffer> command_buffer_;
+  containers::unique_ptr<vulkan::VkFramebuffer> framebuffer_;
+  containers::unique_ptr<vulkan::DescriptorSet> descriptor_set_;
+};
+
+sample_application::SampleOptions GetOptions() {
+  sample_application::SampleOptions options;
+  if (kPipelinedUpdate) {
+    options.EnablePipelinedUpdate();
+  }
+  return options;
+}
+
+// The position of the given attractor at |time|. They circle the center at
+// different distances and speeds.
+void AttractorPosition(uint32_t attractor, float time, float* x, float* y) {
+  const float radius = 0.3f + 0.15f * attractor;
+  const float angle = time * (0.2f + 0.05f * attractor) + attractor;
+  *x = radius * cosf(angle);
+  *y = radius * sinf(angle);
+}
+
+// This creates an application with 16MB of image memory, and 16MB of host
+// buffer memory, for an InstanceRing with one 1MB slot per swapchain image.
+class CpuParticlesSample
+    : public sample_application::Sample<CpuParticlesFrameData> {
+ public:
+  CpuParticlesSample(const entry::EntryData* data)
+      : data_(data),
+        Sample<CpuParticlesFrameData>(data->allocator(), data, 16, 16, 1, 1,
+                                      GetOptions()),
+        cube_(data->allocator(), data->logger(), cube_data),
+        last_render_(std::chrono::high_resolution_clock::now()),
+        reported_frames_(0),
+        frame_ms_(0.0f),
+        update_ms_(0.0f),
+        render_ms_(0.0f) {
+    simulation_ = containers::make_unique<
+        sample_application::DoubleBuffered<Simulation>>(data->allocator());
+    Simulation& simulation = simulation_->update_state();
+    srand(0);
+    for (auto& particle : simulation.particles) {
+      const float distance =
+          0.2f + 1.5f * static_cast<float>(rand()) / RAND_MAX;
+      const float angle =
+          6.2832f * static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+      const float speed = 0.5f / sqrtf(distance);
+      particle.position[0] = distance * cosf(angle);
+      particle.position[1] = distance * sinf(angle);
+      particle.velocity[0] = -speed * sinf(angle);
+      particle.velocity[1] = speed * cosf(angle);
+    }
+    simulation.time = 0.0f;
+    simulation.update_ms = 0.0f;
+    simulation_->Publish();
+  }
+
+  virtual void InitializeApplicationData(
+      vulkan::VkCommandBuffer* initialization_buffer,
+      size_t num_swapchain_images) override {
+    cube_.InitializeData(app(), initialization_buffer);
+
+    descriptor_set_layouts_[0] = {
+        0,                                  // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  // descriptorType
+        1,                                  // descriptorCount
+        VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
+        nullptr                             // pImmutableSamplers
+    };
+    descriptor_set_layouts_[1] = {
+        1,                                  // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  // descriptorType
+        1,                                  // descriptorCount
+        VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
+        nullptr                             // pImmutableSamplers
+    };
+
+    pipeline_layout_ = containers::make_unique<vulkan::PipelineLayout>(
+        data_->allocator(),
+        app()->CreatePipelineLayout(
+            {{descriptor_set_layouts_[0], descriptor_set_layouts_[1]}}));
+
+    VkAttachmentReference color_attachment = {
+        0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    render_pass_ = containers::make_unique<vulkan::VkRenderPass>(
+        data_->allocator(),
+        app()->CreateRenderPass(
+            {{
+                0,                                         // flags
+                render_format(),                           // format
+                num_samples(),                             // samples
+                VK_ATTACHMENT_LOAD_OP_CLEAR,               // loadOp
+                VK_ATTACHMENT_STORE_OP_STORE,              // storeOp
+                VK_ATTACHMENT_LOAD_OP_DONT_CARE,           // stenilLoadOp
+                VK_ATTACHMENT_STORE_OP_DONT_CARE,          // stenilStoreOp
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // initialLayout
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL   // finalLayout
+            }},  // AttachmentDescriptions
+            {{
+                0,                                // flags
+                VK_PIPELINE_BIND_POINT_GRAPHICS,  // pipelineBindPoint
+                0,                                // inputAttachmentCount
+                nullptr,                          // pInputAttachments
+                1,                                // colorAttachmentCount
+                &color_attachment,                // colorAttachment
+                nullptr,                          // pResolveAttachments
+                nullptr,                          // pDepthStencilAttachment
+                0,                                // preserveAttachmentCount
+                nullptr                           // pPreserveAttachments
+            }},                                   // SubpassDescriptions
+            {}                                    // SubpassDependencies
+            ));
+
+    instance_ring_ =
+        containers::make_unique<vulkan::InstanceRing<Instance>>(
+            data_->allocator(), app(), num_swapchain_images, kNumParticles);
+
+    pipeline_ = containers::make_unique<vulkan::VulkanGraphicsPipeline>(
+        data_->allocator(), app()->CreateGraphicsPipeline(
+                                pipeline_layout_.get(), render_pass_.get(), 0));
+    pipeline_->AddShader(VK_SHADER_STAGE_VERTEX_BIT, "main",
+                         particle_vertex_shader);
+    pipeline_->AddShader(VK_SHADER_STAGE_FRAGMENT_BIT, "main",
+                         particle_fragment_shader);
+    pipeline_->SetTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    pipeline_->SetInputStreams(&cube_);
+    instance_ring_->AddInputStream(
+        pipeline_.get(),
+        {{3, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Instance, offset)},
+         {4, VK_FORMAT_R8G8B8A8_UNORM, offsetof(Instance, color)}});
+    pipeline_->SetViewport(viewport());
+    pipeline_->SetScissor(scissor());
+    pipeline_->SetSamples(num_samples());
+    pipeline_->AddAttachment();
+    pipeline_->Commit();
+
+    camera_data_ = containers::make_unique<vulkan::BufferFrameData<CameraData>>(
+        data_->allocator(), app(), num_swapchain_images,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    model_data_ = containers::make_unique<vulkan::BufferFrameData<ModelData>>(
+        data_->allocator(), app(), num_swapchain_images,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    float aspect =
+        (float)app()->swapchain().width() / (float)app()->swapchain().height();
+    camera_data_->data().projection_matrix =
+        Mat44::FromScaleVector(mathfu::Vector<float, 3>{1.0f, -1.0f, 1.0f}) *
+        Mat44::Perspective(1.5708f, aspect, 0.1f, 100.0f);
+
+    model_data_->data().transform = Mat44::FromTranslationVector(
+        mathfu::Vector<float, 3>{0.0f, 0.0f, -3.0f});
+  }
+
+  virtual void InitializeFrameData(
+      CpuParticlesFrameData* frame_data,
+      vulkan::VkCommandBuffer* initialization_buffer,
+      size_t frame_index) override {
+    frame_data->command_buffer_ =
+        containers::make_unique<vulkan::VkCommandBuffer>(
+            data_->allocator(), app()->GetCommandBuffer());
+
+    frame_data->descriptor_set_ =
+        containers::make_unique<vulkan::DescriptorSet>(
+            data_->allocator(),
+            app()->AllocateDescriptorSet(
+                {descriptor_set_layouts_[0], descriptor_set_layouts_[1]}));
+
+    VkDescriptorBufferInfo buffer_infos[2] = {
+        {
+            camera_data_->get_buffer(),                       // buffer
+            camera_data_->get_offset_for_frame(frame_index),  // offset
+            camera_data_->size(),                             // range
+        },
+        {
+            model_data_->get_buffer(),                       // buffer
+            model_data_->get_offset_for_frame(frame_index),  // offset
+            model_data_->size(),                             // range
+        }};
+
+    VkWriteDescriptorSet write{
+        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  // sType
+        nullptr,                                 // pNext
+        *frame_data->descriptor_set_,            // dstSet
+        0,                                       // dstbinding
+        0,                                       // dstArrayElement
+        2,                                       // descriptorCount
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,       // descriptorType
+        nullptr,                                 // pImageInfo
+        buffer_infos,                            // pBufferInfo
+        nullptr,                                 // pTexelBufferView
+    };
+
+    app()->device()->vkUpdateDescriptorSets(app()->device(), 1, &write, 0,
+                                            nullptr);
+
+    ::VkImageView raw_view = color_view(frame_data);
+
+    // Create a framebuffer with depth and image attachments
+    VkFramebufferCreateInfo framebuffer_create_info{
+        VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,  // sType
+        nullptr,                                    // pNext
+        0,                                          // flags
+        *render_pass_,                              // renderPass
+        1,                                          // attachmentCount
+        &raw_view,                                  // attachments
+        app()->swapchain().width(),                 // width
+        app()->swapchain().height(),                // height
+        1                                           // layers
+    };
+
+    ::VkFramebuffer raw_framebuffer;
+    app()->device()->vkCreateFramebuffer(
+        app()->device(), &framebuffer_create_info, nullptr, &raw_framebuffer);
+    frame_data->framebuffer_ = containers::make_unique<vulkan::VkFramebuffer>(
+        data_->allocator(),
+        vulkan::VkFramebuffer(raw_framebuffer, nullptr, &app()->device()));
+
+    vulkan::VkCommandBuffer& cmd = *frame_data->command_buffer_;
+    cmd->vkBeginCommandBuffer(cmd, &sample_application::kBeginCommandBuffer);
+
+    VkClearValue clear;
+    vulkan::MemoryClear(&clear);
+
+    VkRenderPassBeginInfo pass_begin = {
+        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,  // sType
+        nullptr,                                   // pNext
+        *render_pass_,                             // renderPass
+        *frame_data->framebuffer_,                 // framebuffer
+        {{0, 0},
+         {app()->swapchain().width(),
+          app()->swapchain().height()}},  // renderArea
+        1,                                // clearValueCount
+        &clear                            // clears
+    };
+
+    cmd->vkCmdBeginRenderPass(cmd, &pass_begin, VK_SUBPASS_CONTENTS_INLINE);
+    cmd->vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, *pipeline_);
+    cmd->vkCmdBindDescriptorSets(
+        cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        ::VkPipelineLayout(*pipeline_layout_), 0, 1,
+        &frame_data->descriptor_set_->raw_set(), 0, nullptr);
+    instance_ring_->Bind(&cmd, frame_index);
+    cube_.DrawInstanced(&cmd, kNumParticles);
+    cmd->vkCmdEndRenderPass(cmd);
+    cmd->vkEndCommandBuffer(cmd);
+  }
+
+  // With pipelined updates this runs on a worker thread, at the same time
+  // as the Render of the frame before. It only touches update_state().
+  virtual void Update(float time_since_last_render) override {
+    auto start = std::chrono::high_resolution_clock::now();
+    Simulation& simulation = simulation_->update_state();
+    // Keep the steps small, even if a frame took long.
+    const float dt = fminf(time_since_last_render, 0.05f) / kStepsPerUpdate;
+    for (uint32_t step = 0; step < kStepsPerUpdate; ++step) {
+      simulation.time += dt;
+      float attractors[kNumAttractors][2];
+      for (uint32_t i = 0; i < kNumAttractors; ++i) {
+        AttractorPosition(i, simulation.time, &attractors[i][0],
+                          &attractors[i][1]);
+      }
+      for (auto& particle : simulation.particles) {
+        float acceleration[2] = {0.0f, 0.0f};
+        for (uint32_t i = 0; i < kNumAttractors; ++i) {
+          const float dx = attractors[i][0] - particle.position[0];
+          const float dy = attractors[i][1] - particle.position[1];
+          const float distance_squared = dx * dx + dy * dy + 0.01f;
+          const float scale =
+              0.02f / (distance_squared * sqrtf(distance_squared));
+          acceleration[0] += dx * scale;
+          acceleration[1] += dy * scale;
+        }
+        particle.velocity[0] += acceleration[0] * dt;
+        particle.velocity[1] += acceleration[1] * dt;
+        particle.position[0] += particle.velocity[0] * dt;
+        particle.position[1] += particle.velocity[1] * dt;
+      }
+    }
+    simulation.update_ms = std::chrono::duration<float, std::milli>(
+                               std::chrono::high_resolution_clock::now() -
+                               start)
+                               .count();
+  }
+
+  // Runs on the main thread while no Update does.
+  virtual void PublishUpdate() override { simulation_->Publish(); }
+
+  virtual void Render(vulkan::VkQueue* queue, size_t frame_index,
+                      CpuParticlesFrameData* frame_data) override {
+    auto start = std::chrono::high_resolution_clock::now();
+    const Simulation& simulation = simulation_->render_state();
+
+    // Turn the particles into instances right in the slot for this frame,
+    // colored by their speed.
+    auto writer = instance_ring_->Begin(frame_index);
+    Instance* instances = writer.Append(kNumParticles);
+    for (uint32_t i = 0; i < kNumParticles; ++i) {
+      const Particle& particle = simulation.particles[i];
+      const float speed = sqrtf(particle.velocity[0] * particle.velocity[0] +
+                                particle.velocity[1] * particle.velocity[1]);
+      const uint32_t red =
+          static_cast<uint32_t>(fminf(speed * 0.5f, 1.0f) * 255.0f);
+      instances[i] = {{particle.position[0], particle.position[1], 0.0f},
+                      red | ((255u - red) << 8) | (255u << 16) | (255u << 24)};
+    }
+    instance_ring_->End(writer);
+    app()->mapped_range_batcher()->Flush();
+
+    // Update our uniform buffers.
+    camera_data_->UpdateBuffer(queue, frame_index);
+    model_data_->UpdateBuffer(queue, frame_index);
+
+    VkSubmitInfo init_submit_info{
+        VK_STRUCTURE_TYPE_SUBMIT_INFO,  // sType
+        nullptr,                        // pNext
+        0,                              // waitSemaphoreCount
+        nullptr,                        // pWaitSemaphores
+        nullptr,                        // pWaitDstStageMask,
+        1,                              // commandBufferCount
+        &(frame_data->command_buffer_->get_command_buffer()),
+        0,       // signalSemaphoreCount
+        nullptr  // pSignalSemaphores
+    };
+
+    app()->render_queue()->vkQueueSubmit(app()->render_queue(), 1,
+                                         &init_submit_info,
+                                         static_cast<VkFence>(VK_NULL_HANDLE));
+
+    auto end = std::chrono::high_resolution_clock::now();
+    ReportFrame(
+        std::chrono::duration<float, std::milli>(start - last_render_).count(),
+        simulation.update_ms,
+        std::chrono::duration<float, std::milli>(end - start).count());
+    last_render_ = start;
+  }
+
+ private:
+  struct CameraData {
+    Mat44 projection_matrix;
+  };
+
+  struct ModelData {
+    Mat44 transform;
+  };
+
+  // Adds the times of one frame, and logs their averages every
+  // kFramesPerReport frames.
+  void ReportFrame(float frame_ms, float update_ms, float render_ms) {
+    frame_ms_ += frame_ms;
+    update_ms_ += update_ms;
+    render_ms_ += render_ms;
+    if (++reported_frames_ < kFramesPerReport) {
+      return;
+    }
+    data_->logger()->LogInfo(
+        kPipelinedUpdate ? "Pipelined" : "Serial", " update: frame ",
+        frame_ms_ / reported_frames_, " ms, Update ",
+        update_ms_ / reported_frames_, " ms, Render ",
+        render_ms_ / reported_frames_, " ms, averaged over ", reported_frames_,
+        " frames");
+    reported_frames_ = 0;
+    frame_ms_ = 0.0f;
+    update_ms_ = 0.0f;
+    render_ms_ = 0.0f;
+  }
+
+  const entry::EntryData* data_;
+  containers::unique_ptr<vulkan::PipelineLayout> pipeline_layout_;
+  containers::unique_ptr<vulkan::VulkanGraphicsPipeline> pipeline_;
+  containers::unique_ptr<vulkan::VkRenderPass> render_pass_;
+  VkDescriptorSetLayoutBinding descriptor_set_layouts_[2];
+  vulkan::VulkanModel cube_;
+
+  containers::unique_ptr<vulkan::BufferFrameData<CameraData>> camera_data_;
+  containers::unique_ptr<vulkan::BufferFrameData<ModelData>> model_data_;
+
+  containers::unique_ptr<vulkan::InstanceRing<Instance>> instance_ring_;
+  containers::unique_ptr<sample_application::DoubleBuffered<Simulation>>
+      simulation_;
+
+  std::chrono::high_resolution_clock::time_point last_render_;
+  uint32_t reported_frames_;
+  float frame_ms_;
+  float update_ms_;
+  float render_ms_;
+};
+
+int main_entry(const entry::EntryData* data) {
+  data->logger()->LogInfo("Application Startup");
+  CpuParticlesSample sample(data);
+  sample.Initialize();
+
+  while (!sample.should_exit() && !data->WindowClosing()) {
+    sample.ProcessFrame();
+  }
+  sample.WaitIdle();
+
+  data->logger()->LogInfo("Application Shutdown");
+  return 0;
+}
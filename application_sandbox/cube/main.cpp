@@ -53,7 +53,9 @@ class CubeSample : public sample_application::Sample<CubeFrameData> {
       : data_(data),
         Sample<CubeFrameData>(
             data->allocator(), data, 1, 512, 1, 1,
-            sample_application::SampleOptions().EnableMultisampling()),
+            sample_application::SampleOptions()
+                .EnableMultisampling()
+                .EnableInRenderPassResolve()),
         cube_(data->allocator(), data->logger(), cube_data) {}
   virtual void InitializeApplicationData(
       vulkan::VkCommandBuffer* initialization_buffer,
@@ -82,6 +84,8 @@ class CubeSample : public sample_application::Sample<CubeFrameData> {
 
     VkAttachmentReference color_attachment = {
         0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkAttachmentReference resolve_attachment = {
+        1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
 
     render_pass_ = containers::make_unique<vulkan::VkRenderPass>(
         data_->allocator(),
@@ -91,12 +95,23 @@ class CubeSample : public sample_application::Sample<CubeFrameData> {
                 render_format(),                           // format
                 num_samples(),                             // samples
                 VK_ATTACHMENT_LOAD_OP_CLEAR,               // loadOp
-                VK_ATTACHMENT_STORE_OP_STORE,              // storeOp
+                VK_ATTACHMENT_STORE_OP_DONT_CARE,          // storeOp
                 VK_ATTACHMENT_LOAD_OP_DONT_CARE,           // stenilLoadOp
                 VK_ATTACHMENT_STORE_OP_DONT_CARE,          // stenilStoreOp
                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // initialLayout
                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL   // finalLayout
-            }},  // AttachmentDescriptions
+            },
+             {
+                 0,                                         // flags
+                 render_format(),                           // format
+                 VK_SAMPLE_COUNT_1_BIT,                     // samples
+                 VK_ATTACHMENT_LOAD_OP_DONT_CARE,           // loadOp
+                 VK_ATTACHMENT_STORE_OP_STORE,              // storeOp
+                 VK_ATTACHMENT_LOAD_OP_DONT_CARE,           // stenilLoadOp
+                 VK_ATTACHMENT_STORE_OP_DONT_CARE,          // stenilStoreOp
+                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // initialLayout
+                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL   // finalLayout
+             }},  // AttachmentDescriptions
             {{
                 0,                                // flags
                 VK_PIPELINE_BIND_POINT_GRAPHICS,  // pipelineBindPoint
@@ -104,7 +119,7 @@ class CubeSample : public sample_application::Sample<CubeFrameData> {
                 nullptr,                          // pInputAttachments
                 1,                                // colorAttachmentCount
                 &color_attachment,                // colorAttachment
-                nullptr,                          // pResolveAttachments
+                &resolve_attachment,              // pResolveAttachments
                 nullptr,                          // pDepthStencilAttachment
                 0,                                // preserveAttachmentCount
                 nullptr                           // pPreserveAttachments
@@ -187,16 +202,17 @@ class CubeSample : public sample_application::Sample<CubeFrameData> {
     app()->device()->vkUpdateDescriptorSets(app()->device(), 1, &write, 0,
                                             nullptr);
 
-    ::VkImageView raw_view = color_view(frame_data);
+    ::VkImageView raw_views[2] = {color_view(frame_data),
+                                  resolve_view(frame_data)};
 
-    // Create a framebuffer with depth and image attachments
+    // Create a framebuffer with the multisampled and resolve attachments
     VkFramebufferCreateInfo framebuffer_create_info{
         VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,  // sType
         nullptr,                                    // pNext
         0,                                          // flags
         *render_pass_,                              // renderPass
-        1,                                          // attachmentCount
-        &raw_view,                                  // attachments
+        2,                                          // attachmentCount
+        raw_views,                                  // attachments
         app()->swapchain().width(),                 // width
         app()->swapchain().height(),                // height
         1                                           // layers
@@ -254,9 +270,21 @@ class CubeSample : public sample_application::Sample<CubeFrameData> {
   }
   virtual void Render(vulkan::VkQueue* queue, size_t frame_index,
                       CubeFrameData* frame_data) override {
-    // Update our uniform buffers.
-    camera_data_->UpdateBuffer(queue, frame_index);
-    model_data_->UpdateBuffer(queue, frame_index);
+    // Update our uniform buffers. Both updates share a single flush, and go
+    // in the same submit as the draw.
+    ::VkCommandBuffer command_buffers[3];
+    uint32_t num_command_buffers = 0;
+    if (camera_data_->StageBuffer(frame_index)) {
+      command_buffers[num_command_buffers++] =
+          camera_data_->update_command_buffer(frame_index);
+    }
+    if (model_data_->StageBuffer(frame_index)) {
+      command_buffers[num_command_buffers++] =
+          model_data_->update_command_buffer(frame_index);
+    }
+    command_buffers[num_command_buffers++] =
+        frame_data->command_buffer_->get_command_buffer();
+    app()->mapped_range_batcher()->Flush();
 
     VkSubmitInfo init_submit_info{
         VK_STRUCTURE_TYPE_SUBMIT_INFO,  // sType
@@ -264,10 +292,10 @@ class CubeSample : public sample_application::Sample<CubeFrameData> {
         0,                              // waitSemaphoreCount
         nullptr,                        // pWaitSemaphores
         nullptr,                        // pWaitDstStageMask,
-        1,                              // commandBufferCount
-        &(frame_data->command_buffer_->get_command_buffer()),
-        0,       // signalSemaphoreCount
-        nullptr  // pSignalSemaphores
+        num_command_buffers,            // commandBufferCount
+        command_buffers,                // pCommandBuffers
+        0,                              // signalSemaphoreCount
+        nullptr                         // pSignalSemaphores
     };
 
     app()->render_queue()->vkQueueSubmit(app()->render_queue(), 1,
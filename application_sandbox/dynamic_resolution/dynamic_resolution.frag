@@ -0,0 +1,34 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#version 450
+
+layout(location = 0) out vec4 out_color;
+layout (location = 1) in vec2 texcoord;
+
+// Enough work per fragment that the GPU time of a frame mostly depends on
+// how many fragments are shaded.
+const int kIterations = 256;
+
+void main() {
+    vec2 z = texcoord * 2.0 - 1.0;
+    float glow = 0.0;
+    for (int i = 0; i < kIterations; ++i) {
+        z = vec2(sin(z.x * 3.1 + z.y), cos(z.y * 2.7 - z.x)) * 0.98;
+        glow += abs(z.x * z.y);
+    }
+    glow /= float(kIterations);
+    out_color = vec4(texcoord * (0.5 + glow), glow, 1.0);
+}
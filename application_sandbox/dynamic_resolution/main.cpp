@@ -0,0 +1,328 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "application_sandbox/sample_application_framework/sample_application.h"
+#include "support/entry/entry.h"
+#include "vulkan_helpers/buffer_frame_data.h"
+#include "vulkan_helpers/helper_functions.h"
+#include "vulkan_helpers/vulkan_application.h"
+#include "vulkan_helpers/vulkan_model.h"
+
+#include <chrono>
+#include "mathfu/matrix.h"
+#include "mathfu/vector.h"
+
+using Mat44 = mathfu::Matrix<float, 4, 4>;
+using Vector4 = mathfu::Vector<float, 4>;
+
+namespace cube_model {
+#include "cube.obj.h"
+}
+const auto& cube_data = cube_model::model;
+
+uint32_t cube_vertex_shader[] =
+#include "dynamic_resolution.vert.spv"
+    ;
+
+uint32_t cube_fragment_shader[] =
+#include "dynamic_resolution.frag.spv"
+    ;
+
+// The GPU time that the resolution is adjusted to hold.
+const float kTargetFrameTimeMs = 8.0f;
+
+struct DynamicResolutionFrameData {
+  containers::unique_ptr<vulkan::VkCommandBuffer> command_buffer_;
+  containers::unique_ptr<vulkan::VkFramebuffer> framebuffer_;
+  containers::unique_ptr<vulkan::DescriptorSet> cube_descriptor_set_;
+};
+
+// This creates an application with 16MB of image memory, and defaults
+// for host, and device buffer sizes.
+class DynamicResolutionSample
+    : public sample_application::Sample<DynamicResolutionFrameData> {
+ public:
+  DynamicResolutionSample(const entry::EntryData* data)
+      : data_(data),
+        Sample<DynamicResolutionFrameData>(
+            data->allocator(), data, 1, 512, 1, 1,
+            sample_application::SampleOptions().EnableDynamicResolution(
+                kTargetFrameTimeMs)),
+        cube_(data->allocator(), data->logger(), cube_data) {}
+  virtual void InitializeApplicationData(
+      vulkan::VkCommandBuffer* initialization_buffer,
+      size_t num_swapchain_images) override {
+    cube_.InitializeData(app(), initialization_buffer);
+
+    cube_descriptor_set_layouts_[0] = {
+        0,                                  // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  // descriptorType
+        1,                                  // descriptorCount
+        VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
+        nullptr                             // pImmutableSamplers
+    };
+    cube_descriptor_set_layouts_[1] = {
+        1,                                  // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  // descriptorType
+        1,                                  // descriptorCount
+        VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
+        nullptr                             // pImmutableSamplers
+    };
+
+    pipeline_layout_ = containers::make_unique<vulkan::PipelineLayout>(
+        data_->allocator(),
+        app()->CreatePipelineLayout({{cube_descriptor_set_layouts_[0],
+                                      cube_descriptor_set_layouts_[1]}}));
+
+    VkAttachmentReference color_attachment = {
+        0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    render_pass_ = containers::make_unique<vulkan::VkRenderPass>(
+        data_->allocator(),
+        app()->CreateRenderPass(
+            {{
+                0,                                         // flags
+                render_format(),                           // format
+                num_samples(),                             // samples
+                VK_ATTACHMENT_LOAD_OP_CLEAR,               // loadOp
+                VK_ATTACHMENT_STORE_OP_STORE,              // storeOp
+                VK_ATTACHMENT_LOAD_OP_DONT_CARE,           // stenilLoadOp
+                VK_ATTACHMENT_STORE_OP_DONT_CARE,          // stenilStoreOp
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // initialLayout
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL   // finalLayout
+            }},  // AttachmentDescriptions
+            {{
+                0,                                // flags
+                VK_PIPELINE_BIND_POINT_GRAPHICS,  // pipelineBindPoint
+                0,                                // inputAttachmentCount
+                nullptr,                          // pInputAttachments
+                1,                                // colorAttachmentCount
+                &color_attachment,                // colorAttachment
+                nullptr,                          // pResolveAttachments
+                nullptr,                          // pDepthStencilAttachment
+                0,                                // preserveAttachmentCount
+                nullptr                           // pPreserveAttachments
+            }},                                   // SubpassDescriptions
+            {}                                    // SubpassDependencies
+            ));
+
+    // The viewport and scissor are left dynamic, they change with the
+    // resolution.
+    cube_pipeline_ = containers::make_unique<vulkan::VulkanGraphicsPipeline>(
+        data_->allocator(),
+        app()->CreateGraphicsPipeline(pipeline_layout_.get(),
+                                      render_pass_.get(), 0));
+    cube_pipeline_->AddShader(VK_SHADER_STAGE_VERTEX_BIT, "main",
+                              cube_vertex_shader);
+    cube_pipeline_->AddShader(VK_SHADER_STAGE_FRAGMENT_BIT, "main",
+                              cube_fragment_shader);
+    cube_pipeline_->SetTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    cube_pipeline_->SetInputStreams(&cube_);
+    cube_pipeline_->SetSamples(num_samples());
+    cube_pipeline_->AddAttachment();
+    cube_pipeline_->Commit();
+
+    camera_data_ = containers::make_unique<vulkan::BufferFrameData<CameraData>>(
+        data_->allocator(), app(), num_swapchain_images,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    model_data_ = containers::make_unique<vulkan::BufferFrameData<ModelData>>(
+        data_->allocator(), app(), num_swapchain_images,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    // The rendered area keeps the aspect ratio of the swapchain.
+    float aspect =
+        (float)app()->swapchain().width() / (float)app()->swapchain().height();
+    camera_data_->data().projection_matrix =
+        Mat44::FromScaleVector(mathfu::Vector<float, 3>{1.0f, -1.0f, 1.0f}) *
+        Mat44::Perspective(1.5708f, aspect, 0.1f, 100.0f);
+
+    model_data_->data().transform = Mat44::FromTranslationVector(
+        mathfu::Vector<float, 3>{0.0f, 0.0f, -2.0f});
+  }
+
+  virtual void InitializeFrameData(
+      DynamicResolutionFrameData* frame_data,
+      vulkan::VkCommandBuffer* initialization_buffer,
+      size_t frame_index) override {
+    frame_data->command_buffer_ =
+        containers::make_unique<vulkan::VkCommandBuffer>(
+            data_->allocator(), app()->GetCommandBuffer());
+
+    frame_data->cube_descriptor_set_ =
+        containers::make_unique<vulkan::DescriptorSet>(
+            data_->allocator(),
+            app()->AllocateDescriptorSet({cube_descriptor_set_layouts_[0],
+                                          cube_descriptor_set_layouts_[1]}));
+
+    VkDescriptorBufferInfo buffer_infos[2] = {
+        {
+            camera_data_->get_buffer(),                       // buffer
+            camera_data_->get_offset_for_frame(frame_index),  // offset
+            camera_data_->size(),                             // range
+        },
+        {
+            model_data_->get_buffer(),                       // buffer
+            model_data_->get_offset_for_frame(frame_index),  // offset
+            model_data_->size(),                             // range
+        }};
+
+    VkWriteDescriptorSet write{
+        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  // sType
+        nullptr,                                 // pNext
+        *frame_data->cube_descriptor_set_,       // dstSet
+        0,                                       // dstbinding
+        0,                                       // dstArrayElement
+        2,                                       // descriptorCount
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,       // descriptorType
+        nullptr,                                 // pImageInfo
+        buffer_infos,                            // pBufferInfo
+        nullptr,                                 // pTexelBufferView
+    };
+
+    app()->device()->vkUpdateDescriptorSets(app()->device(), 1, &write, 0,
+                                            nullptr);
+
+    ::VkImageView raw_view = color_view(frame_data);
+
+    // The framebuffer covers the whole render target, only the part of it
+    // in scissor() is rendered to.
+    VkFramebufferCreateInfo framebuffer_create_info{
+        VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,  // sType
+        nullptr,                                    // pNext
+        0,                                          // flags
+        *render_pass_,                              // renderPass
+        1,                                          // attachmentCount
+        &raw_view,                                  // attachments
+        app()->swapchain().width(),                 // width
+        app()->swapchain().height(),                // height
+        1                                           // layers
+    };
+
+    ::VkFramebuffer raw_framebuffer;
+    app()->device()->vkCreateFramebuffer(
+        app()->device(), &framebuffer_create_info, nullptr, &raw_framebuffer);
+    frame_data->framebuffer_ = containers::make_unique<vulkan::VkFramebuffer>(
+        data_->allocator(),
+        vulkan::VkFramebuffer(raw_framebuffer, nullptr, &app()->device()));
+  }
+
+  virtual void Update(float time_since_last_render) override {
+    model_data_->data().transform =
+        model_data_->data().transform *
+        Mat44::FromRotationMatrix(
+            Mat44::RotationX(3.14f * time_since_last_render) *
+            Mat44::RotationY(3.14f * time_since_last_render * 0.5f));
+  }
+  virtual void Render(vulkan::VkQueue* queue, size_t frame_index,
+                      DynamicResolutionFrameData* frame_data) override {
+    // The area to render to may have changed since this frame was last
+    // used, so record the commands again.
+    vulkan::VkCommandBuffer& cmdBuffer = (*frame_data->command_buffer_);
+    cmdBuffer->vkResetCommandBuffer(cmdBuffer, 0);
+    cmdBuffer->vkBeginCommandBuffer(cmdBuffer,
+                                    &sample_application::kBeginCommandBuffer);
+
+    VkClearValue clear;
+    vulkan::MemoryClear(&clear);
+
+    VkRenderPassBeginInfo pass_begin = {
+        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,  // sType
+        nullptr,                                   // pNext
+        *render_pass_,                             // renderPass
+        *frame_data->framebuffer_,                 // framebuffer
+        scissor(),                                 // renderArea
+        1,                                         // clearValueCount
+        &clear                                     // clears
+    };
+
+    cmdBuffer->vkCmdBeginRenderPass(cmdBuffer, &pass_begin,
+                                    VK_SUBPASS_CONTENTS_INLINE);
+    cmdBuffer->vkCmdSetViewport(cmdBuffer, 0, 1, &viewport());
+    cmdBuffer->vkCmdSetScissor(cmdBuffer, 0, 1, &scissor());
+    cmdBuffer->vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                 *cube_pipeline_);
+    cmdBuffer->vkCmdBindDescriptorSets(
+        cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        ::VkPipelineLayout(*pipeline_layout_), 0, 1,
+        &frame_data->cube_descriptor_set_->raw_set(), 0, nullptr);
+    cube_.Draw(&cmdBuffer);
+    cmdBuffer->vkCmdEndRenderPass(cmdBuffer);
+    cmdBuffer->vkEndCommandBuffer(cmdBuffer);
+
+    // Update our uniform buffers. Both updates share a single flush, and go
+    // in the same submit as the draw.
+    ::VkCommandBuffer command_buffers[3];
+    uint32_t num_command_buffers = 0;
+    if (camera_data_->StageBuffer(frame_index)) {
+      command_buffers[num_command_buffers++] =
+          camera_data_->update_command_buffer(frame_index);
+    }
+    if (model_data_->StageBuffer(frame_index)) {
+      command_buffers[num_command_buffers++] =
+          model_data_->update_command_buffer(frame_index);
+    }
+    command_buffers[num_command_buffers++] = cmdBuffer.get_command_buffer();
+    app()->mapped_range_batcher()->Flush();
+
+    VkSubmitInfo init_submit_info{
+        VK_STRUCTURE_TYPE_SUBMIT_INFO,  // sType
+        nullptr,                        // pNext
+        0,                              // waitSemaphoreCount
+        nullptr,                        // pWaitSemaphores
+        nullptr,                        // pWaitDstStageMask,
+        num_command_buffers,            // commandBufferCount
+        command_buffers,                // pCommandBuffers
+        0,                              // signalSemaphoreCount
+        nullptr                         // pSignalSemaphores
+    };
+
+    app()->render_queue()->vkQueueSubmit(app()->render_queue(), 1,
+                                         &init_submit_info,
+                                         static_cast<VkFence>(VK_NULL_HANDLE));
+  }
+
+ private:
+  struct CameraData {
+    Mat44 projection_matrix;
+  };
+
+  struct ModelData {
+    Mat44 transform;
+  };
+
+  const entry::EntryData* data_;
+  containers::unique_ptr<vulkan::PipelineLayout> pipeline_layout_;
+  containers::unique_ptr<vulkan::VulkanGraphicsPipeline> cube_pipeline_;
+  containers::unique_ptr<vulkan::VkRenderPass> render_pass_;
+  VkDescriptorSetLayoutBinding cube_descriptor_set_layouts_[2];
+  vulkan::VulkanModel cube_;
+
+  containers::unique_ptr<vulkan::BufferFrameData<CameraData>> camera_data_;
+  containers::unique_ptr<vulkan::BufferFrameData<ModelData>> model_data_;
+};
+
+int main_entry(const entry::EntryData* data) {
+  data->logger()->LogInfo("Application Startup");
+  DynamicResolutionSample sample(data);
+  sample.Initialize();
+
+  while (!sample.should_exit() && !data->WindowClosing()) {
+    sample.ProcessFrame();
+  }
+  sample.WaitIdle();
+
+  data->logger()->LogInfo("Application Shutdown");
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "support/containers/huge_page_allocator.h"
+#include "support/entry/entry.h"
+
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+namespace {
+const size_t kArraySize = 256 * 1024 * 1024;
+const size_t kNumCopies = 16;
+
+// Allocates two large arrays from |allocator|, and logs how long it takes
+// to touch them for the first time, and how fast they can be copied.
+// Returns false if the arrays could not be allocated.
+bool MeasureBandwidth(const entry::EntryData* data, const char* name,
+                      containers::Allocator* allocator) {
+  typedef std::chrono::high_resolution_clock clock;
+  char* src = static_cast<char*>(allocator->malloc(kArraySize));
+  char* dst = static_cast<char*>(allocator->malloc(kArraySize));
+  if (!src || !dst) {
+    data->logger()->LogError(name, ": could not allocate two arrays of ",
+                             kArraySize, " bytes");
+    allocator->free(dst, kArraySize);
+    allocator->free(src, kArraySize);
+    return false;
+  }
+
+  auto start = clock::now();
+  memset(src, 1, kArraySize);
+  memset(dst, 0, kArraySize);
+  std::chrono::duration<double> touch_time = clock::now() - start;
+
+  start = clock::now();
+  for (size_t i = 0; i < kNumCopies; ++i) {
+    memcpy(dst, src, kArraySize);
+    // Make sure that every copy reads what the previous one wrote.
+    std::swap(src, dst);
+  }
+  std::chrono::duration<double> copy_time = clock::now() - start;
+
+  const double gigabytes =
+      static_cast<double>(kArraySize) * kNumCopies / (1024.0 * 1024 * 1024);
+  data->logger()->LogInfo(name, ": first touch of ", 2 * kArraySize,
+                          " bytes took ", touch_time.count() * 1000.0,
+                          " ms, memcpy ", gigabytes / copy_time.count(),
+                          " GiB/s");
+
+  allocator->free(dst, kArraySize);
+  allocator->free(src, kArraySize);
+  return true;
+}
+}  // anonymous namespace
+
+int main_entry(const entry::EntryData* data) {
+  data->logger()->LogInfo("Application Startup");
+
+  containers::LeakCheckAllocator malloc_allocator;
+  containers::HugePageAllocator huge_page_allocator(&malloc_allocator);
+
+  if (!MeasureBandwidth(data, "malloc", &malloc_allocator) ||
+      !MeasureBandwidth(data, "Huge pages", &huge_page_allocator)) {
+    return -1;
+  }
+  data->logger()->LogInfo(
+      "Huge page allocations: ",
+      huge_page_allocator.explicit_huge_page_allocations_.load(),
+      " explicit, ",
+      huge_page_allocator.transparent_huge_page_allocations_.load(),
+      " transparent");
+
+  data->logger()->LogInfo("Application Shutdown");
+  return 0;
+}
@@ -0,0 +1,388 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "application_sandbox/sample_application_framework/sample_application.h"
+#include "support/entry/entry.h"
+#include "vulkan_helpers/buffer_frame_data.h"
+#include "vulkan_helpers/helper_functions.h"
+#include "vulkan_helpers/instance_ring.h"
+#include "vulkan_helpers/vulkan_application.h"
+#include "vulkan_helpers/vulkan_model.h"
+
+#include <chrono>
+#include <cstddef>
+#include "mathfu/matrix.h"
+#include "mathfu/vector.h"
+
+using Mat44 = mathfu::Matrix<float, 4, 4>;
+using Vector4 = mathfu::Vector<float, 4>;
+
+namespace cube_model {
+#include "cube.obj.h"
+}
+const auto& cube_data = cube_model::model;
+
+uint32_t instance_ring_vertex_shader[] =
+#include "instance_ring.vert.spv"
+    ;
+
+uint32_t instance_ring_fragment_shader[] =
+#include "instance_ring.frag.spv"
+    ;
+
+// This must match grid_size in instance_ring.vert.
+const uint32_t kGridSize = 1024;
+const uint32_t kNumInstances = kGridSize * kGridSize;
+// The number of frames that the cost of streaming the instances is averaged
+// over before it is logged.
+const uint32_t kFramesPerReport = 100;
+
+// The per-instance vertex attributes, at locations 3 and 4.
+struct Instance {
+  float offset[3];
+  // RGBA, 8 bits each.
+  uint32_t color;
+};
+
+struct InstanceRingFrameData {
+  containers::unique_ptr<vulkan::VkCommandBuffer> command_buffer_;
+  containers::unique_ptr<vulkan::VkFramebuffer> framebuffer_;
+  containers::unique_ptr<vulkan::DescriptorSet> descriptor_set_;
+};
+
+// This creates an application with 16MB of image memory, and 96MB of host
+// buffer memory, for an InstanceRing with one 16MB slot per swapchain image.
+class InstanceRingSample
+    : public sample_application::Sample<InstanceRingFrameData> {
+ public:
+  InstanceRingSample(const entry::EntryData* data)
+      : data_(data),
+        Sample<InstanceRingFrameData>(data->allocator(), data, 96, 16, 1, 1,
+                                      sample_application::SampleOptions()),
+        cube_(data->allocator(), data->logger(), cube_data),
+        instances_(data->allocator()),
+        reported_frames_(0),
+        copy_ms_(0.0f),
+        flush_ms_(0.0f) {}
+
+  virtual void InitializeApplicationData(
+      vulkan::VkCommandBuffer* initialization_buffer,
+      size_t num_swapchain_images) override {
+    cube_.InitializeData(app(), initialization_buffer);
+
+    descriptor_set_layouts_[0] = {
+        0,                                  // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  // descriptorType
+        1,                                  // descriptorCount
+        VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
+        nullptr                             // pImmutableSamplers
+    };
+    descriptor_set_layouts_[1] = {
+        1,                                  // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  // descriptorType
+        1,                                  // descriptorCount
+        VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
+        nullptr                             // pImmutableSamplers
+    };
+
+    pipeline_layout_ = containers::make_unique<vulkan::PipelineLayout>(
+        data_->allocator(),
+        app()->CreatePipelineLayout(
+            {{descriptor_set_layouts_[0], descriptor_set_layouts_[1]}}));
+
+    VkAttachmentReference color_attachment = {
+        0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    render_pass_ = containers::make_unique<vulkan::VkRenderPass>(
+        data_->allocator(),
+        app()->CreateRenderPass(
+            {{
+                0,                                         // flags
+                render_format(),                           // format
+                num_samples(),                             // samples
+                VK_ATTACHMENT_LOAD_OP_CLEAR,               // loadOp
+                VK_ATTACHMENT_STORE_OP_STORE,              // storeOp
+                VK_ATTACHMENT_LOAD_OP_DONT_CARE,           // stenilLoadOp
+                VK_ATTACHMENT_STORE_OP_DONT_CARE,          // stenilStoreOp
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // initialLayout
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL   // finalLayout
+            }},  // AttachmentDescriptions
+            {{
+                0,                                // flags
+                VK_PIPELINE_BIND_POINT_GRAPHICS,  // pipelineBindPoint
+                0,                                // inputAttachmentCount
+                nullptr,                          // pInputAttachments
+                1,                                // colorAttachmentCount
+                &color_attachment,                // colorAttachment
+                nullptr,                          // pResolveAttachments
+                nullptr,                          // pDepthStencilAttachment
+                0,                                // preserveAttachmentCount
+                nullptr                           // pPreserveAttachments
+            }},                                   // SubpassDescriptions
+            {}                                    // SubpassDependencies
+            ));
+
+    instance_ring_ =
+        containers::make_unique<vulkan::InstanceRing<Instance>>(
+            data_->allocator(), app(), num_swapchain_images, kNumInstances);
+
+    pipeline_ = containers::make_unique<vulkan::VulkanGraphicsPipeline>(
+        data_->allocator(), app()->CreateGraphicsPipeline(
+                                pipeline_layout_.get(), render_pass_.get(), 0));
+    pipeline_->AddShader(VK_SHADER_STAGE_VERTEX_BIT, "main",
+                         instance_ring_vertex_shader);
+    pipeline_->AddShader(VK_SHADER_STAGE_FRAGMENT_BIT, "main",
+                         instance_ring_fragment_shader);
+    pipeline_->SetTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    pipeline_->SetInputStreams(&cube_);
+    instance_ring_->AddInputStream(
+        pipeline_.get(),
+        {{3, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Instance, offset)},
+         {4, VK_FORMAT_R8G8B8A8_UNORM, offsetof(Instance, color)}});
+    pipeline_->SetViewport(viewport());
+    pipeline_->SetScissor(scissor());
+    pipeline_->SetSamples(num_samples());
+    pipeline_->AddAttachment();
+    pipeline_->Commit();
+
+    camera_data_ = containers::make_unique<vulkan::BufferFrameData<CameraData>>(
+        data_->allocator(), app(), num_swapchain_images,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    model_data_ = containers::make_unique<vulkan::BufferFrameData<ModelData>>(
+        data_->allocator(), app(), num_swapchain_images,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    float aspect =
+        (float)app()->swapchain().width() / (float)app()->swapchain().height();
+    camera_data_->data().projection_matrix =
+        Mat44::FromScaleVector(mathfu::Vector<float, 3>{1.0f, -1.0f, 1.0f}) *
+        Mat44::Perspective(1.5708f, aspect, 0.1f, 100.0f);
+
+    model_data_->data().transform = Mat44::FromTranslationVector(
+        mathfu::Vector<float, 3>{0.0f, 0.0f, -3.0f});
+
+    // Lay the cubes out in a grid, shaded by where they are in it.
+    instances_.reserve(kNumInstances);
+    for (uint32_t y = 0; y < kGridSize; ++y) {
+      for (uint32_t x = 0; x < kGridSize; ++x) {
+        const uint32_t red = x * 255 / (kGridSize - 1);
+        const uint32_t green = y * 255 / (kGridSize - 1);
+        instances_.push_back(
+            {{(x + 0.5f) / kGridSize * 4.0f - 2.0f,
+              (y + 0.5f) / kGridSize * 4.0f - 2.0f, 0.0f},
+             red | (green << 8) | (128u << 16) | (255u << 24)});
+      }
+    }
+  }
+
+  virtual void InitializeFrameData(
+      InstanceRingFrameData* frame_data,
+      vulkan::VkCommandBuffer* initialization_buffer,
+      size_t frame_index) override {
+    frame_data->command_buffer_ =
+        containers::make_unique<vulkan::VkCommandBuffer>(
+            data_->allocator(), app()->GetCommandBuffer());
+
+    frame_data->descriptor_set_ =
+        containers::make_unique<vulkan::DescriptorSet>(
+            data_->allocator(),
+            app()->AllocateDescriptorSet(
+                {descriptor_set_layouts_[0], descriptor_set_layouts_[1]}));
+
+    VkDescriptorBufferInfo buffer_infos[2] = {
+        {
+            camera_data_->get_buffer(),                       // buffer
+            camera_data_->get_offset_for_frame(frame_index),  // offset
+            camera_data_->size(),                             // range
+        },
+        {
+            model_data_->get_buffer(),                       // buffer
+            model_data_->get_offset_for_frame(frame_index),  // offset
+            model_data_->size(),                             // range
+        }};
+
+    VkWriteDescriptorSet write{
+        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  // sType
+        nullptr,                                 // pNext
+        *frame_data->descriptor_set_,            // dstSet
+        0,                                       // dstbinding
+        0,                                       // dstArrayElement
+        2,                                       // descriptorCount
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,       // descriptorType
+        nullptr,                                 // pImageInfo
+        buffer_infos,                            // pBufferInfo
+        nullptr,                                 // pTexelBufferView
+    };
+
+    app()->device()->vkUpdateDescriptorSets(app()->device(), 1, &write, 0,
+                                            nullptr);
+
+    ::VkImageView raw_view = color_view(frame_data);
+
+    // Create a framebuffer with depth and image attachments
+    VkFramebufferCreateInfo framebuffer_create_info{
+        VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,  // sType
+        nullptr,                                    // pNext
+        0,                                          // flags
+        *render_pass_,                              // renderPass
+        1,                                          // attachmentCount
+        &raw_view,                                  // attachments
+        app()->swapchain().width(),                 // width
+        app()->swapchain().height(),                // height
+        1                                           // layers
+    };
+
+    ::VkFramebuffer raw_framebuffer;
+    app()->device()->vkCreateFramebuffer(
+        app()->device(), &framebuffer_create_info, nullptr, &raw_framebuffer);
+    frame_data->framebuffer_ = containers::make_unique<vulkan::VkFramebuffer>(
+        data_->allocator(),
+        vulkan::VkFramebuffer(raw_framebuffer, nullptr, &app()->device()));
+
+    vulkan::VkCommandBuffer& cmd = *frame_data->command_buffer_;
+    cmd->vkBeginCommandBuffer(cmd, &sample_application::kBeginCommandBuffer);
+
+    VkClearValue clear;
+    vulkan::MemoryClear(&clear);
+
+    VkRenderPassBeginInfo pass_begin = {
+        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,  // sType
+        nullptr,                                   // pNext
+        *render_pass_,                             // renderPass
+        *frame_data->framebuffer_,                 // framebuffer
+        {{0, 0},
+         {app()->swapchain().width(),
+          app()->swapchain().height()}},  // renderArea
+        1,                                // clearValueCount
+        &clear                            // clears
+    };
+
+    cmd->vkCmdBeginRenderPass(cmd, &pass_begin, VK_SUBPASS_CONTENTS_INLINE);
+    cmd->vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, *pipeline_);
+    cmd->vkCmdBindDescriptorSets(
+        cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        ::VkPipelineLayout(*pipeline_layout_), 0, 1,
+        &frame_data->descriptor_set_->raw_set(), 0, nullptr);
+    // Every frame draws from its own slot of the ring, which Render fills
+    // with all of the instances.
+    instance_ring_->Bind(&cmd, frame_index);
+    cube_.DrawInstanced(&cmd, kNumInstances);
+    cmd->vkCmdEndRenderPass(cmd);
+    cmd->vkEndCommandBuffer(cmd);
+  }
+
+  virtual void Update(float time_since_last_render) override {
+    model_data_->data().transform =
+        model_data_->data().transform *
+        Mat44::FromRotationMatrix(
+            Mat44::RotationZ(3.14f * time_since_last_render * 0.1f));
+  }
+
+  virtual void Render(vulkan::VkQueue* queue, size_t frame_index,
+                      InstanceRingFrameData* frame_data) override {
+    // The instances do not change, but all of them are streamed every frame
+    // as if they did: one memcpy into the slot for this frame, and a single
+    // flush of the range that was written.
+    auto start = std::chrono::high_resolution_clock::now();
+    instance_ring_->Write(frame_index, instances_.data(), instances_.size());
+    auto copied = std::chrono::high_resolution_clock::now();
+    app()->mapped_range_batcher()->Flush();
+    auto flushed = std::chrono::high_resolution_clock::now();
+    ReportStreamingCost(
+        std::chrono::duration<float, std::milli>(copied - start).count(),
+        std::chrono::duration<float, std::milli>(flushed - copied).count());
+
+    // Update our uniform buffers.
+    camera_data_->UpdateBuffer(queue, frame_index);
+    model_data_->UpdateBuffer(queue, frame_index);
+
+    VkSubmitInfo init_submit_info{
+        VK_STRUCTURE_TYPE_SUBMIT_INFO,  // sType
+        nullptr,                        // pNext
+        0,                              // waitSemaphoreCount
+        nullptr,                        // pWaitSemaphores
+        nullptr,                        // pWaitDstStageMask,
+        1,                              // commandBufferCount
+        &(frame_data->command_buffer_->get_command_buffer()),
+        0,       // signalSemaphoreCount
+        nullptr  // pSignalSemaphores
+    };
+
+    app()->render_queue()->vkQueueSubmit(app()->render_queue(), 1,
+                                         &init_submit_info,
+                                         static_cast<VkFence>(VK_NULL_HANDLE));
+  }
+
+ private:
+  struct CameraData {
+    Mat44 projection_matrix;
+  };
+
+  struct ModelData {
+    Mat44 transform;
+  };
+
+  // Adds the cost of streaming the instances for one frame, and logs the
+  // average every kFramesPerReport frames.
+  void ReportStreamingCost(float copy_ms, float flush_ms) {
+    copy_ms_ += copy_ms;
+    flush_ms_ += flush_ms;
+    if (++reported_frames_ < kFramesPerReport) {
+      return;
+    }
+    const float bytes = float(kNumInstances) * sizeof(Instance);
+    const float average_copy_ms = copy_ms_ / reported_frames_;
+    data_->logger()->LogInfo(
+        "Streamed ", kNumInstances, " instances (", bytes / (1024 * 1024),
+        " MB) per frame: memcpy ", average_copy_ms, " ms (",
+        bytes / (average_copy_ms * 1000000.0f), " GB/s), flush ",
+        flush_ms_ / reported_frames_, " ms, averaged over ", reported_frames_,
+        " frames");
+    reported_frames_ = 0;
+    copy_ms_ = 0.0f;
+    flush_ms_ = 0.0f;
+  }
+
+  const entry::EntryData* data_;
+  containers::unique_ptr<vulkan::PipelineLayout> pipeline_layout_;
+  containers::unique_ptr<vulkan::VulkanGraphicsPipeline> pipeline_;
+  containers::unique_ptr<vulkan::VkRenderPass> render_pass_;
+  VkDescriptorSetLayoutBinding descriptor_set_layouts_[2];
+  vulkan::VulkanModel cube_;
+
+  containers::unique_ptr<vulkan::BufferFrameData<CameraData>> camera_data_;
+  containers::unique_ptr<vulkan::BufferFrameData<ModelData>> model_data_;
+
+  containers::unique_ptr<vulkan::InstanceRing<Instance>> instance_ring_;
+  containers::vector<Instance> instances_;
+
+  uint32_t reported_frames_;
+  float copy_ms_;
+  float flush_ms_;
+};
+
+int main_entry(const entry::EntryData* data) {
+  data->logger()->LogInfo("Application Startup");
+  InstanceRingSample sample(data);
+  sample.Initialize();
+
+  while (!sample.should_exit() && !data->WindowClosing()) {
+    sample.ProcessFrame();
+  }
+  sample.WaitIdle();
+
+  data->logger()->LogInfo("Application Shutdown");
+  return 0;
+}
@@ -0,0 +1,397 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "application_sandbox/sample_application_framework/sample_application.h"
+#include "support/entry/entry.h"
+#include "vulkan_helpers/buffer_frame_data.h"
+#include "vulkan_helpers/helper_functions.h"
+#include "vulkan_helpers/mesh_pool.h"
+#include "vulkan_helpers/vulkan_application.h"
+
+#include <chrono>
+#include "mathfu/matrix.h"
+#include "mathfu/vector.h"
+
+using Mat44 = mathfu::Matrix<float, 4, 4>;
+using Vector4 = mathfu::Vector<float, 4>;
+
+namespace cube_model {
+#include "cube.obj.h"
+}
+const auto& cube_data = cube_model::model;
+
+namespace prism_model {
+#include "prism.obj.h"
+}
+const auto& prism_data = prism_model::model;
+
+uint32_t mesh_pool_vertex_shader[] =
+#include "mesh_pool.vert.spv"
+    ;
+
+uint32_t mesh_pool_fragment_shader[] =
+#include "mesh_pool.frag.spv"
+    ;
+
+// This must match grid_size in mesh_pool.vert.
+const uint32_t kGridSize = 100;
+const uint32_t kNumMeshes = kGridSize * kGridSize;
+
+struct MeshPoolFrameData {
+  containers::unique_ptr<vulkan::VkCommandBuffer> command_buffer_;
+  containers::unique_ptr<vulkan::VkFramebuffer> framebuffer_;
+  containers::unique_ptr<vulkan::DescriptorSet> descriptor_set_;
+};
+
+VkPhysicalDeviceFeatures GetRequestedFeatures() {
+  VkPhysicalDeviceFeatures features = {0};
+  features.multiDrawIndirect = VK_TRUE;
+  features.drawIndirectFirstInstance = VK_TRUE;
+  return features;
+}
+
+// This creates an application with 16MB of image memory, and 32MB of host
+// and device buffer memory for the pooled meshes.
+class MeshPoolSample : public sample_application::Sample<MeshPoolFrameData> {
+ public:
+  MeshPoolSample(const entry::EntryData* data)
+      : data_(data),
+        Sample<MeshPoolFrameData>(data->allocator(), data, 32, 16, 32, 1,
+                                  sample_application::SampleOptions(),
+                                  GetRequestedFeatures()),
+        pool_(data->allocator(), data->logger()) {}
+
+  virtual void InitializeApplicationData(
+      vulkan::VkCommandBuffer* initialization_buffer,
+      size_t num_swapchain_images) override {
+    // Every mesh gets its own copy of the vertex and index data, so that
+    // the pool really holds kNumMeshes distinct meshes.
+    for (uint32_t i = 0; i < kNumMeshes; ++i) {
+      if (i % 2) {
+        pool_.AddMesh(prism_data);
+      } else {
+        pool_.AddMesh(cube_data);
+      }
+    }
+    pool_.InitializeData(app(), initialization_buffer);
+
+    descriptor_set_layouts_[0] = {
+        0,                                  // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  // descriptorType
+        1,                                  // descriptorCount
+        VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
+        nullptr                             // pImmutableSamplers
+    };
+    descriptor_set_layouts_[1] = {
+        1,                                  // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  // descriptorType
+        1,                                  // descriptorCount
+        VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
+        nullptr                             // pImmutableSamplers
+    };
+
+    pipeline_layout_ = containers::make_unique<vulkan::PipelineLayout>(
+        data_->allocator(),
+        app()->CreatePipelineLayout(
+            {{descriptor_set_layouts_[0], descriptor_set_layouts_[1]}}));
+
+    VkAttachmentReference color_attachment = {
+        0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    render_pass_ = containers::make_unique<vulkan::VkRenderPass>(
+        data_->allocator(),
+        app()->CreateRenderPass(
+            {{
+                0,                                         // flags
+                render_format(),                           // format
+                num_samples(),                             // samples
+                VK_ATTACHMENT_LOAD_OP_CLEAR,               // loadOp
+                VK_ATTACHMENT_STORE_OP_STORE,              // storeOp
+                VK_ATTACHMENT_LOAD_OP_DONT_CARE,           // stenilLoadOp
+                VK_ATTACHMENT_STORE_OP_DONT_CARE,          // stenilStoreOp
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // initialLayout
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL   // finalLayout
+            }},  // AttachmentDescriptions
+            {{
+                0,                                // flags
+                VK_PIPELINE_BIND_POINT_GRAPHICS,  // pipelineBindPoint
+                0,                                // inputAttachmentCount
+                nullptr,                          // pInputAttachments
+                1,                                // colorAttachmentCount
+                &color_attachment,                // colorAttachment
+                nullptr,                          // pResolveAttachments
+                nullptr,                          // pDepthStencilAttachment
+                0,                                // preserveAttachmentCount
+                nullptr                           // pPreserveAttachments
+            }},                                   // SubpassDescriptions
+            {}                                    // SubpassDependencies
+            ));
+
+    pipeline_ = containers::make_unique<vulkan::VulkanGraphicsPipeline>(
+        data_->allocator(), app()->CreateGraphicsPipeline(
+                                pipeline_layout_.get(), render_pass_.get(), 0));
+    pipeline_->AddShader(VK_SHADER_STAGE_VERTEX_BIT, "main",
+                         mesh_pool_vertex_shader);
+    pipeline_->AddShader(VK_SHADER_STAGE_FRAGMENT_BIT, "main",
+                         mesh_pool_fragment_shader);
+    pipeline_->SetTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    pipeline_->SetInputStreams(&pool_);
+    pipeline_->SetViewport(viewport());
+    pipeline_->SetScissor(scissor());
+    pipeline_->SetSamples(num_samples());
+    pipeline_->AddAttachment();
+    pipeline_->Commit();
+
+    camera_data_ = containers::make_unique<vulkan::BufferFrameData<CameraData>>(
+        data_->allocator(), app(), num_swapchain_images,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    model_data_ = containers::make_unique<vulkan::BufferFrameData<ModelData>>(
+        data_->allocator(), app(), num_swapchain_images,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    float aspect =
+        (float)app()->swapchain().width() / (float)app()->swapchain().height();
+    camera_data_->data().projection_matrix =
+        Mat44::FromScaleVector(mathfu::Vector<float, 3>{1.0f, -1.0f, 1.0f}) *
+        Mat44::Perspective(1.5708f, aspect, 0.1f, 100.0f);
+
+    model_data_->data().transform = Mat44::FromTranslationVector(
+        mathfu::Vector<float, 3>{0.0f, 0.0f, -3.0f});
+
+    containers::vector<VkDrawIndexedIndirectCommand> commands(
+        data_->allocator());
+    pool_.GetDrawCommands(&commands);
+    const size_t commands_size =
+        commands.size() * sizeof(VkDrawIndexedIndirectCommand);
+    draw_data_buffer_ = app()->CreateAndBindDefaultExclusiveHostBuffer(
+        commands_size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    app()->FillHostVisibleBuffer(
+        draw_data_buffer_.get(), commands.data(), commands_size, 0,
+        initialization_buffer, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+  }
+
+  virtual void InitializationComplete() override {
+    pool_.ReleaseStagingData();
+  }
+
+  virtual void InitializeFrameData(
+      MeshPoolFrameData* frame_data,
+      vulkan::VkCommandBuffer* initialization_buffer,
+      size_t frame_index) override {
+    frame_data->command_buffer_ =
+        containers::make_unique<vulkan::VkCommandBuffer>(
+            data_->allocator(), app()->GetCommandBuffer());
+
+    frame_data->descriptor_set_ =
+        containers::make_unique<vulkan::DescriptorSet>(
+            data_->allocator(),
+            app()->AllocateDescriptorSet(
+                {descriptor_set_layouts_[0], descriptor_set_layouts_[1]}));
+
+    VkDescriptorBufferInfo buffer_infos[2] = {
+        {
+            camera_data_->get_buffer(),                       // buffer
+            camera_data_->get_offset_for_frame(frame_index),  // offset
+            camera_data_->size(),                             // range
+        },
+        {
+            model_data_->get_buffer(),                       // buffer
+            model_data_->get_offset_for_frame(frame_index),  // offset
+            model_data_->size(),                             // range
+        }};
+
+    VkWriteDescriptorSet write{
+        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  // sType
+        nullptr,                                 // pNext
+        *frame_data->descriptor_set_,            // dstSet
+        0,                                       // dstbinding
+        0,                                       // dstArrayElement
+        2,                                       // descriptorCount
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,       // descriptorType
+        nullptr,                                 // pImageInfo
+        buffer_infos,                            // pBufferInfo
+        nullptr,                                 // pTexelBufferView
+    };
+
+    app()->device()->vkUpdateDescriptorSets(app()->device(), 1, &write, 0,
+                                            nullptr);
+
+    ::VkImageView raw_view = color_view(frame_data);
+
+    // Create a framebuffer with depth and image attachments
+    VkFramebufferCreateInfo framebuffer_create_info{
+        VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,  // sType
+        nullptr,                                    // pNext
+        0,                                          // flags
+        *render_pass_,                              // renderPass
+        1,                                          // attachmentCount
+        &raw_view,                                  // attachments
+        app()->swapchain().width(),                 // width
+        app()->swapchain().height(),                // height
+        1                                           // layers
+    };
+
+    ::VkFramebuffer raw_framebuffer;
+    app()->device()->vkCreateFramebuffer(
+        app()->device(), &framebuffer_create_info, nullptr, &raw_framebuffer);
+    frame_data->framebuffer_ = containers::make_unique<vulkan::VkFramebuffer>(
+        data_->allocator(),
+        vulkan::VkFramebuffer(raw_framebuffer, nullptr, &app()->device()));
+
+    if (frame_index == 0) {
+      LogRecordingCost(frame_data);
+    }
+
+    RecordFrame(frame_data->command_buffer_.get(), frame_data, false);
+  }
+
+  virtual void Update(float time_since_last_render) override {
+    model_data_->data().transform =
+        model_data_->data().transform *
+        Mat44::FromRotationMatrix(
+            Mat44::RotationZ(3.14f * time_since_last_render * 0.1f));
+  }
+
+  virtual void Render(vulkan::VkQueue* queue, size_t frame_index,
+                      MeshPoolFrameData* frame_data) override {
+    // Update our uniform buffers.
+    camera_data_->UpdateBuffer(queue, frame_index);
+    model_data_->UpdateBuffer(queue, frame_index);
+
+    VkSubmitInfo init_submit_info{
+        VK_STRUCTURE_TYPE_SUBMIT_INFO,  // sType
+        nullptr,                        // pNext
+        0,                              // waitSemaphoreCount
+        nullptr,                        // pWaitSemaphores
+        nullptr,                        // pWaitDstStageMask,
+        1,                              // commandBufferCount
+        &(frame_data->command_buffer_->get_command_buffer()),
+        0,       // signalSemaphoreCount
+        nullptr  // pSignalSemaphores
+    };
+
+    app()->render_queue()->vkQueueSubmit(app()->render_queue(), 1,
+                                         &init_submit_info,
+                                         static_cast<VkFence>(VK_NULL_HANDLE));
+  }
+
+ private:
+  struct CameraData {
+    Mat44 projection_matrix;
+  };
+
+  struct ModelData {
+    Mat44 transform;
+  };
+
+  // Records a render pass that draws every mesh in the pool into
+  // |cmdBuffer|. If |per_mesh| is set, then every mesh is drawn with its own
+  // vkCmdDrawIndexed and the vertex and index buffers are rebound for each,
+  // which is what drawing the meshes as separate VulkanModels costs.
+  // Otherwise all of them are drawn with one vkCmdDrawIndexedIndirect.
+  void RecordFrame(vulkan::VkCommandBuffer* cmdBuffer,
+                   MeshPoolFrameData* frame_data, bool per_mesh) {
+    vulkan::VkCommandBuffer& cmd = *cmdBuffer;
+    cmd->vkBeginCommandBuffer(cmd, &sample_application::kBeginCommandBuffer);
+
+    VkClearValue clear;
+    vulkan::MemoryClear(&clear);
+
+    VkRenderPassBeginInfo pass_begin = {
+        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,  // sType
+        nullptr,                                   // pNext
+        *render_pass_,                             // renderPass
+        *frame_data->framebuffer_,                 // framebuffer
+        {{0, 0},
+         {app()->swapchain().width(),
+          app()->swapchain().height()}},  // renderArea
+        1,                                // clearValueCount
+        &clear                            // clears
+    };
+
+    cmd->vkCmdBeginRenderPass(cmd, &pass_begin, VK_SUBPASS_CONTENTS_INLINE);
+    cmd->vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, *pipeline_);
+    cmd->vkCmdBindDescriptorSets(
+        cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        ::VkPipelineLayout(*pipeline_layout_), 0, 1,
+        &frame_data->descriptor_set_->raw_set(), 0, nullptr);
+
+    if (per_mesh) {
+      for (uint32_t i = 0; i < kNumMeshes; ++i) {
+        pool_.BindVertexAndIndexBuffers(&cmd);
+        pool_.Draw(&cmd, i, 1, i);
+      }
+    } else {
+      pool_.BindVertexAndIndexBuffers(&cmd);
+      cmd->vkCmdDrawIndexedIndirect(
+          cmd, *draw_data_buffer_, 0, kNumMeshes,
+          static_cast<uint32_t>(sizeof(VkDrawIndexedIndirectCommand)));
+    }
+
+    cmd->vkCmdEndRenderPass(cmd);
+    cmd->vkEndCommandBuffer(cmd);
+  }
+
+  // Measures the CPU time it takes to record the scene both ways. The
+  // command buffers used for this are never submitted.
+  void LogRecordingCost(MeshPoolFrameData* frame_data) {
+    vulkan::VkCommandBuffer per_mesh_buffer = app()->GetCommandBuffer();
+    vulkan::VkCommandBuffer indirect_buffer = app()->GetCommandBuffer();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    RecordFrame(&per_mesh_buffer, frame_data, true);
+    auto per_mesh_end = std::chrono::high_resolution_clock::now();
+    RecordFrame(&indirect_buffer, frame_data, false);
+    auto indirect_end = std::chrono::high_resolution_clock::now();
+
+    data_->logger()->LogInfo(
+        "Recording ", kNumMeshes, " meshes one draw at a time took ",
+        std::chrono::duration_cast<std::chrono::microseconds>(per_mesh_end -
+                                                              start)
+            .count(),
+        "us, with one indirect draw it took ",
+        std::chrono::duration_cast<std::chrono::microseconds>(indirect_end -
+                                                              per_mesh_end)
+            .count(),
+        "us");
+  }
+
+  const entry::EntryData* data_;
+  containers::unique_ptr<vulkan::PipelineLayout> pipeline_layout_;
+  containers::unique_ptr<vulkan::VulkanGraphicsPipeline> pipeline_;
+  containers::unique_ptr<vulkan::VkRenderPass> render_pass_;
+  VkDescriptorSetLayoutBinding descriptor_set_layouts_[2];
+  vulkan::MeshPool pool_;
+
+  containers::unique_ptr<vulkan::BufferFrameData<CameraData>> camera_data_;
+  containers::unique_ptr<vulkan::BufferFrameData<ModelData>> model_data_;
+
+  containers::unique_ptr<vulkan::VulkanApplication::Buffer> draw_data_buffer_;
+};
+
+int main_entry(const entry::EntryData* data) {
+  data->logger()->LogInfo("Application Startup");
+  MeshPoolSample sample(data);
+  sample.Initialize();
+
+  while (!sample.should_exit() && !data->WindowClosing()) {
+    sample.ProcessFrame();
+  }
+  sample.WaitIdle();
+
+  data->logger()->LogInfo("Application Shutdown");
+  return 0;
+}
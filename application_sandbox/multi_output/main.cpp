@@ -0,0 +1,426 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "application_sandbox/sample_application_framework/sample_application.h"
+#include "support/entry/entry.h"
+#include "vulkan_helpers/buffer_frame_data.h"
+#include "vulkan_helpers/helper_functions.h"
+#include "vulkan_helpers/vulkan_application.h"
+#include "vulkan_helpers/vulkan_model.h"
+
+#include <chrono>
+#include "mathfu/matrix.h"
+#include "mathfu/vector.h"
+
+using Mat44 = mathfu::Matrix<float, 4, 4>;
+using Vector4 = mathfu::Vector<float, 4>;
+
+namespace cube_model {
+#include "cube.obj.h"
+}
+const auto& cube_data = cube_model::model;
+
+uint32_t cube_vertex_shader[] =
+#include "cube.vert.spv"
+    ;
+
+uint32_t cube_fragment_shader[] =
+#include "cube.frag.spv"
+    ;
+
+// The size of the preview window.
+const uint32_t kPreviewSize = 256;
+
+struct CubeFrameData {
+  containers::unique_ptr<vulkan::VkCommandBuffer> command_buffer_;
+  containers::unique_ptr<vulkan::VkFramebuffer> framebuffer_;
+  containers::unique_ptr<vulkan::DescriptorSet> cube_descriptor_set_;
+  // Like cube_descriptor_set_, but with the camera of the preview.
+  containers::unique_ptr<vulkan::DescriptorSet> preview_descriptor_set_;
+};
+
+// This renders a rotating cube to the main window, and the back of the same
+// cube to a small preview window. Both are rendered with the same device,
+// and presented together.
+class MultiOutputSample : public sample_application::Sample<CubeFrameData> {
+ public:
+  MultiOutputSample(const entry::EntryData* data)
+      : data_(data),
+        Sample<CubeFrameData>(
+            data->allocator(), data, 1, 512, 1, 1,
+            sample_application::SampleOptions().AddOutput(kPreviewSize,
+                                                          kPreviewSize)),
+        cube_(data->allocator(), data->logger(), cube_data),
+        preview_framebuffers_(data->allocator()) {}
+  virtual void InitializeApplicationData(
+      vulkan::VkCommandBuffer* initialization_buffer,
+      size_t num_swapchain_images) override {
+    cube_.InitializeData(app(), initialization_buffer);
+
+    cube_descriptor_set_layouts_[0] = {
+        0,                                  // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  // descriptorType
+        1,                                  // descriptorCount
+        VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
+        nullptr                             // pImmutableSamplers
+    };
+    cube_descriptor_set_layouts_[1] = {
+        1,                                  // binding
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,  // descriptorType
+        1,                                  // descriptorCount
+        VK_SHADER_STAGE_VERTEX_BIT,         // stageFlags
+        nullptr                             // pImmutableSamplers
+    };
+
+    pipeline_layout_ = containers::make_unique<vulkan::PipelineLayout>(
+        data_->allocator(),
+        app()->CreatePipelineLayout({{cube_descriptor_set_layouts_[0],
+                                      cube_descriptor_set_layouts_[1]}}));
+
+    render_pass_ = CreateRenderPass(render_format());
+    cube_pipeline_ = CreatePipeline(render_pass_.get(), viewport(), scissor());
+
+    camera_data_ = containers::make_unique<vulkan::BufferFrameData<CameraData>>(
+        data_->allocator(), app(), num_swapchain_images,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    model_data_ = containers::make_unique<vulkan::BufferFrameData<ModelData>>(
+        data_->allocator(), app(), num_swapchain_images,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    float aspect =
+        (float)app()->swapchain().width() / (float)app()->swapchain().height();
+    camera_data_->data().projection_matrix =
+        Mat44::FromScaleVector(mathfu::Vector<float, 3>{1.0f, -1.0f, 1.0f}) *
+        Mat44::Perspective(1.5708f, aspect, 0.1f, 100.0f);
+
+    model_data_->data().transform = Mat44::FromTranslationVector(
+        mathfu::Vector<float, 3>{0.0f, 0.0f, -3.0f});
+
+    if (num_additional_outputs() == 0) {
+      app()->GetLogger()->LogInfo(
+          "The preview window could not be created, only rendering to the "
+          "main window");
+      return;
+    }
+    InitializePreview(num_swapchain_images);
+  }
+
+  virtual void InitializeFrameData(
+      CubeFrameData* frame_data, vulkan::VkCommandBuffer* initialization_buffer,
+      size_t frame_index) override {
+    frame_data->command_buffer_ =
+        containers::make_unique<vulkan::VkCommandBuffer>(
+            data_->allocator(), app()->GetCommandBuffer());
+
+    frame_data->cube_descriptor_set_ =
+        CreateDescriptorSet(camera_data_.get(), frame_index);
+    if (preview_camera_data_) {
+      frame_data->preview_descriptor_set_ =
+          CreateDescriptorSet(preview_camera_data_.get(), frame_index);
+    }
+
+    ::VkImageView raw_view = color_view(frame_data);
+
+    // Create a framebuffer with the image attachment
+    VkFramebufferCreateInfo framebuffer_create_info{
+        VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,  // sType
+        nullptr,                                    // pNext
+        0,                                          // flags
+        *render_pass_,                              // renderPass
+        1,                                          // attachmentCount
+        &raw_view,                                  // attachments
+        app()->swapchain().width(),                 // width
+        app()->swapchain().height(),                // height
+        1                                           // layers
+    };
+
+    ::VkFramebuffer raw_framebuffer;
+    app()->device()->vkCreateFramebuffer(
+        app()->device(), &framebuffer_create_info, nullptr, &raw_framebuffer);
+    frame_data->framebuffer_ = containers::make_unique<vulkan::VkFramebuffer>(
+        data_->allocator(),
+        vulkan::VkFramebuffer(raw_framebuffer, nullptr, &app()->device()));
+
+    (*frame_data->command_buffer_)
+        ->vkBeginCommandBuffer((*frame_data->command_buffer_),
+                               &sample_application::kBeginCommandBuffer);
+    vulkan::VkCommandBuffer& cmdBuffer = (*frame_data->command_buffer_);
+    RecordCube(&cmdBuffer, *render_pass_, *frame_data->framebuffer_,
+               scissor(), *cube_pipeline_, *frame_data->cube_descriptor_set_);
+    (*frame_data->command_buffer_)
+        ->vkEndCommandBuffer(*frame_data->command_buffer_);
+  }
+
+  virtual void Update(float time_since_last_render) override {
+    model_data_->data().transform =
+        model_data_->data().transform *
+        Mat44::FromRotationMatrix(
+            Mat44::RotationX(3.14f * time_since_last_render) *
+            Mat44::RotationY(3.14f * time_since_last_render * 0.5f));
+  }
+
+  virtual void Render(vulkan::VkQueue* queue, size_t frame_index,
+                      CubeFrameData* frame_data) override {
+    // Update our uniform buffers. The commands of the preview are submitted
+    // after these, so they see the same transform.
+    camera_data_->UpdateBuffer(queue, frame_index);
+    model_data_->UpdateBuffer(queue, frame_index);
+    if (preview_camera_data_) {
+      preview_camera_data_->UpdateBuffer(queue, frame_index);
+    }
+
+    VkSubmitInfo init_submit_info{
+        VK_STRUCTURE_TYPE_SUBMIT_INFO,  // sType
+        nullptr,                        // pNext
+        0,                              // waitSemaphoreCount
+        nullptr,                        // pWaitSemaphores
+        nullptr,                        // pWaitDstStageMask,
+        1,                              // commandBufferCount
+        &(frame_data->command_buffer_->get_command_buffer()),
+        0,       // signalSemaphoreCount
+        nullptr  // pSignalSemaphores
+    };
+
+    app()->render_queue()->vkQueueSubmit(app()->render_queue(), 1,
+                                         &init_submit_info,
+                                         static_cast<VkFence>(VK_NULL_HANDLE));
+  }
+
+  // Runs at the same time as Render, and only reads what was set up during
+  // initialization.
+  virtual void RecordOutput(size_t output, uint32_t image_index,
+                            vulkan::VkCommandBuffer* command_buffer,
+                            CubeFrameData* frame_data) override {
+    const VkExtent2D extent = output_extent(output);
+    RecordCube(command_buffer, *preview_render_pass_,
+               *preview_framebuffers_[image_index], {{0, 0}, extent},
+               *preview_pipeline_, *frame_data->preview_descriptor_set_);
+  }
+
+ private:
+  struct CameraData {
+    Mat44 projection_matrix;
+  };
+
+  struct ModelData {
+    Mat44 transform;
+  };
+
+  // The preview window has a swapchain of its own, which may not have the
+  // same format as the main one, so it gets its own render pass and
+  // pipeline.
+  void InitializePreview(size_t num_swapchain_images) {
+    const VkExtent2D extent = output_extent(0);
+    preview_render_pass_ = CreateRenderPass(output_format(0));
+    preview_pipeline_ = CreatePipeline(
+        preview_render_pass_.get(),
+        {0.0f, 0.0f, static_cast<float>(extent.width),
+         static_cast<float>(extent.height), 0.0f, 1.0f},
+        {{0, 0}, extent});
+
+    for (size_t i = 0; i < output_image_count(0); ++i) {
+      ::VkImageView raw_view = output_view(0, i);
+      VkFramebufferCreateInfo framebuffer_create_info{
+          VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,  // sType
+          nullptr,                                    // pNext
+          0,                                          // flags
+          *preview_render_pass_,                      // renderPass
+          1,                                          // attachmentCount
+          &raw_view,                                  // attachments
+          extent.width,                               // width
+          extent.height,                              // height
+          1                                           // layers
+      };
+      ::VkFramebuffer raw_framebuffer;
+      app()->device()->vkCreateFramebuffer(
+          app()->device(), &framebuffer_create_info, nullptr, &raw_framebuffer);
+      preview_framebuffers_.push_back(
+          containers::make_unique<vulkan::VkFramebuffer>(
+              data_->allocator(), vulkan::VkFramebuffer(raw_framebuffer, nullptr,
+                                                        &app()->device())));
+    }
+
+    preview_camera_data_ =
+        containers::make_unique<vulkan::BufferFrameData<CameraData>>(
+            data_->allocator(), app(), num_swapchain_images,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+    // Looks at the cube from behind, around the point it spins about.
+    const mathfu::Vector<float, 3> cube_center{0.0f, 0.0f, -3.0f};
+    preview_camera_data_->data().projection_matrix =
+        Mat44::FromScaleVector(mathfu::Vector<float, 3>{1.0f, -1.0f, 1.0f}) *
+        Mat44::Perspective(1.5708f,
+                           (float)extent.width / (float)extent.height, 0.1f,
+                           100.0f) *
+        Mat44::FromTranslationVector(cube_center) *
+        Mat44::FromRotationMatrix(Mat44::RotationY(3.14159f)) *
+        Mat44::FromTranslationVector(-cube_center);
+  }
+
+  containers::unique_ptr<vulkan::VkRenderPass> CreateRenderPass(
+      VkFormat format) {
+    VkAttachmentReference color_attachment = {
+        0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    return containers::make_unique<vulkan::VkRenderPass>(
+        data_->allocator(),
+        app()->CreateRenderPass(
+            {{
+                0,                                         // flags
+                format,                                    // format
+                VK_SAMPLE_COUNT_1_BIT,                     // samples
+                VK_ATTACHMENT_LOAD_OP_CLEAR,               // loadOp
+                VK_ATTACHMENT_STORE_OP_STORE,              // storeOp
+                VK_ATTACHMENT_LOAD_OP_DONT_CARE,           // stenilLoadOp
+                VK_ATTACHMENT_STORE_OP_DONT_CARE,          // stenilStoreOp
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // initialLayout
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL   // finalLayout
+            }},  // AttachmentDescriptions
+            {{
+                0,                                // flags
+                VK_PIPELINE_BIND_POINT_GRAPHICS,  // pipelineBindPoint
+                0,                                // inputAttachmentCount
+                nullptr,                          // pInputAttachments
+                1,                                // colorAttachmentCount
+                &color_attachment,                // colorAttachment
+                nullptr,                          // pResolveAttachments
+                nullptr,                          // pDepthStencilAttachment
+                0,                                // preserveAttachmentCount
+                nullptr                           // pPreserveAttachments
+            }},                                   // SubpassDescriptions
+            {}                                    // SubpassDependencies
+            ));
+  }
+
+  containers::unique_ptr<vulkan::VulkanGraphicsPipeline> CreatePipeline(
+      vulkan::VkRenderPass* render_pass, const VkViewport& viewport,
+      const VkRect2D& scissor) {
+    auto pipeline = containers::make_unique<vulkan::VulkanGraphicsPipeline>(
+        data_->allocator(),
+        app()->CreateGraphicsPipeline(pipeline_layout_.get(), render_pass, 0));
+    pipeline->AddShader(VK_SHADER_STAGE_VERTEX_BIT, "main",
+                        cube_vertex_shader);
+    pipeline->AddShader(VK_SHADER_STAGE_FRAGMENT_BIT, "main",
+                        cube_fragment_shader);
+    pipeline->SetTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    pipeline->SetInputStreams(&cube_);
+    pipeline->SetViewport(viewport);
+    pipeline->SetScissor(scissor);
+    pipeline->SetSamples(VK_SAMPLE_COUNT_1_BIT);
+    pipeline->AddAttachment();
+    pipeline->Commit();
+    return pipeline;
+  }
+
+  containers::unique_ptr<vulkan::DescriptorSet> CreateDescriptorSet(
+      vulkan::BufferFrameData<CameraData>* camera_data, size_t frame_index) {
+    auto descriptor_set = containers::make_unique<vulkan::DescriptorSet>(
+        data_->allocator(),
+        app()->AllocateDescriptorSet({cube_descriptor_set_layouts_[0],
+                                      cube_descriptor_set_layouts_[1]}));
+
+    VkDescriptorBufferInfo buffer_infos[2] = {
+        {
+            camera_data->get_buffer(),                       // buffer
+            camera_data->get_offset_for_frame(frame_index),  // offset
+            camera_data->size(),                             // range
+        },
+        {
+            model_data_->get_buffer(),                       // buffer
+            model_data_->get_offset_for_frame(frame_index),  // offset
+            model_data_->size(),                             // range
+        }};
+
+    VkWriteDescriptorSet write{
+        VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  // sType
+        nullptr,                                 // pNext
+        *descriptor_set,                         // dstSet
+        0,                                       // dstbinding
+        0,                                       // dstArrayElement
+        2,                                       // descriptorCount
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,       // descriptorType
+        nullptr,                                 // pImageInfo
+        buffer_infos,                            // pBufferInfo
+        nullptr,                                 // pTexelBufferView
+    };
+
+    app()->device()->vkUpdateDescriptorSets(app()->device(), 1, &write, 0,
+                                            nullptr);
+    return descriptor_set;
+  }
+
+  void RecordCube(vulkan::VkCommandBuffer* command_buffer,
+                  ::VkRenderPass render_pass, ::VkFramebuffer framebuffer,
+                  const VkRect2D& render_area, ::VkPipeline pipeline,
+                  const vulkan::DescriptorSet& descriptor_set) {
+    vulkan::VkCommandBuffer& cmdBuffer = *command_buffer;
+
+    VkClearValue clear;
+    vulkan::MemoryClear(&clear);
+
+    VkRenderPassBeginInfo pass_begin = {
+        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,  // sType
+        nullptr,                                   // pNext
+        render_pass,                               // renderPass
+        framebuffer,                               // framebuffer
+        render_area,                               // renderArea
+        1,                                         // clearValueCount
+        &clear                                     // clears
+    };
+
+    cmdBuffer->vkCmdBeginRenderPass(cmdBuffer, &pass_begin,
+                                    VK_SUBPASS_CONTENTS_INLINE);
+
+    cmdBuffer->vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                 pipeline);
+    cmdBuffer->vkCmdBindDescriptorSets(
+        cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        ::VkPipelineLayout(*pipeline_layout_), 0, 1,
+        &descriptor_set.raw_set(), 0, nullptr);
+    cube_.Draw(&cmdBuffer);
+    cmdBuffer->vkCmdEndRenderPass(cmdBuffer);
+  }
+
+  const entry::EntryData* data_;
+  containers::unique_ptr<vulkan::PipelineLayout> pipeline_layout_;
+  containers::unique_ptr<vulkan::VulkanGraphicsPipeline> cube_pipeline_;
+  containers::unique_ptr<vulkan::VkRenderPass> render_pass_;
+  VkDescriptorSetLayoutBinding cube_descriptor_set_layouts_[2];
+  vulkan::VulkanModel cube_;
+
+  containers::unique_ptr<vulkan::BufferFrameData<CameraData>> camera_data_;
+  containers::unique_ptr<vulkan::BufferFrameData<ModelData>> model_data_;
+
+  // Only set if the preview window could be created.
+  containers::unique_ptr<vulkan::VkRenderPass> preview_render_pass_;
+  containers::unique_ptr<vulkan::VulkanGraphicsPipeline> preview_pipeline_;
+  containers::vector<containers::unique_ptr<vulkan::VkFramebuffer>>
+      preview_framebuffers_;
+  containers::unique_ptr<vulkan::BufferFrameData<CameraData>>
+      preview_camera_data_;
+};
+
+int main_entry(const entry::EntryData* data) {
+  data->logger()->LogInfo("Application Startup");
+  MultiOutputSample sample(data);
+  sample.Initialize();
+
+  while (!sample.should_exit() && !data->WindowClosing()) {
+    sample.ProcessFrame();
+  }
+  sample.WaitIdle();
+
+  data->logger()->LogInfo("Application Shutdown");
+  return 0;
+}
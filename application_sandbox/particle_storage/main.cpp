@@ -0,0 +1,312 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "application_sandbox/compute_particles/particle_data_shared.h"
+#include "support/entry/entry.h"
+#include "vulkan_helpers/helper_functions.h"
+#include "vulkan_helpers/vulkan_application.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+
+uint32_t simulation_shader[] =
+#include "particle_update.comp.spv"
+    ;
+
+uint32_t velocity_shader[] =
+#include "particle_velocity_update.comp.spv"
+    ;
+
+// The particle counts that every layout is measured at. They must be
+// multiples of COMPUTE_SHADER_LOCAL_SIZE.
+const uint32_t kParticleCounts[] = {1024 * 16, 1024 * 64, 1024 * 256};
+const uint32_t kMaxParticles = 1024 * 256;
+// The number of simulation steps that are timed for each.
+const uint32_t kNumSteps = 16;
+
+const int32_t kLayouts[] = {SIMULATION_LAYOUT_AOS, SIMULATION_LAYOUT_SOA,
+                            SIMULATION_LAYOUT_SOA_HALF};
+
+const char* LayoutName(int32_t layout) {
+  switch (layout) {
+    case SIMULATION_LAYOUT_AOS:
+      return "AoS";
+    case SIMULATION_LAYOUT_SOA:
+      return "SoA";
+    case SIMULATION_LAYOUT_SOA_HALF:
+      return "SoA with half precision positions";
+    default:
+      return "unknown layout";
+  }
+}
+
+// The bytes that one simulation step reads and writes, when every access
+// goes to memory. The velocity update dominates, as every particle reads the
+// positions of num_particles / 128 others. With SIMULATION_LAYOUT_AOS those
+// reads count whole particles, as the velocities share their cache lines.
+double BytesPerStep(int32_t layout, uint32_t num_particles) {
+  const double n = num_particles;
+  const double others = n * (n / 128);
+  const double draw = n * sizeof(draw_data);
+  switch (layout) {
+    case SIMULATION_LAYOUT_AOS:
+      // Velocity update: others, the particle, its new velocity.
+      // Position update: the particle, the particle, the draw data.
+      return others * 16 + n * (16 + 8) + n * (16 + 16) + draw;
+    case SIMULATION_LAYOUT_SOA:
+      // Velocity update: others, position and velocity, new velocity.
+      // Position update: position and velocity, new position, draw data.
+      return others * 8 + n * (8 + 8 + 8) + n * (8 + 8 + 8) + draw;
+    case SIMULATION_LAYOUT_SOA_HALF:
+      // Like SIMULATION_LAYOUT_SOA, and the position update also writes the
+      // half precision copy.
+      return others * 4 + n * (8 + 8 + 8) + n * (8 + 8 + 8 + 4) + draw;
+    default:
+      return 0;
+  }
+}
+
+// The specialization constants of the compute shaders.
+struct SimulationConstants {
+  int32_t layout;
+  uint32_t num_particles;
+};
+
+const VkSpecializationMapEntry kSimulationConstantEntries[2] = {
+    {0, offsetof(SimulationConstants, layout), sizeof(int32_t)},
+    {1, offsetof(SimulationConstants, num_particles), sizeof(uint32_t)},
+};
+
+// This sample runs the particle simulation of the compute_particles sample
+// for every storage layout, at several particle counts, and logs how long a
+// step takes on the GPU, and the bandwidth that works out to.
+int main_entry(const entry::EntryData* data) {
+  data->logger()->LogInfo("Application Startup");
+
+  vulkan::VulkanApplication app(data->allocator(), data->logger(), data, {},
+                                {}, {0}, 1024 * 1024, 1024 * 1024,
+                                32 * 1024 * 1024);
+  vulkan::VkDevice& device = app.device();
+
+  auto queue_family_properties = vulkan::GetQueueFamilyProperties(
+      data->allocator(), app.instance(), device.physical_device());
+  const uint32_t timestamp_valid_bits =
+      queue_family_properties[app.render_queue().index()].timestampValidBits;
+  if (timestamp_valid_bits == 0) {
+    data->logger()->LogError("The queue does not support timestamps");
+    return -1;
+  }
+  const uint64_t timestamp_mask =
+      timestamp_valid_bits >= 64 ? ~uint64_t(0)
+                                 : (uint64_t(1) << timestamp_valid_bits) - 1;
+
+  const VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  auto time_buffer =
+      app.CreateAndBindDefaultExclusiveHostBuffer(2 * sizeof(float), usage);
+  auto simulation_buffer = app.CreateAndBindDefaultExclusiveDeviceBuffer(
+      kMaxParticles * sizeof(simulation_data), usage);
+  auto draw_buffer = app.CreateAndBindDefaultExclusiveDeviceBuffer(
+      kMaxParticles * sizeof(draw_data), usage);
+  auto position_buffer = app.CreateAndBindDefaultExclusiveDeviceBuffer(
+      kMaxParticles * 2 * sizeof(float), usage);
+  auto velocity_buffer = app.CreateAndBindDefaultExclusiveDeviceBuffer(
+      kMaxParticles * 2 * sizeof(float), usage);
+  auto half_position_buffer = app.CreateAndBindDefaultExclusiveDeviceBuffer(
+      kMaxParticles * sizeof(uint32_t), usage);
+
+  // The same initial state as in compute_particles, in every layout.
+  containers::vector<simulation_data> particles(data->allocator());
+  containers::vector<float> positions(data->allocator());
+  containers::vector<float> velocities(data->allocator());
+  containers::vector<uint32_t> half_positions(data->allocator());
+  particles.resize(kMaxParticles);
+  srand(0);
+  for (auto& particle : particles) {
+    float distance = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    float angle = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    angle = angle * 3.1415f * 2.0f;
+    const float x = sin(angle) * (1 - (distance * distance));
+    const float y = cos(angle) * (1 - (distance * distance));
+    particle.position_velocity = Vector4(x, y, -y * 0.05f, x * 0.05f);
+    positions.push_back(x);
+    positions.push_back(y);
+    velocities.push_back(-y * 0.05f);
+    velocities.push_back(x * 0.05f);
+    half_positions.push_back(PackHalf2x16(Vector2(x, y)));
+  }
+  // The frame number, which offsets the particles that each one is pulled
+  // by, and the time step.
+  const float time_data[2] = {0.0f, 0.001f};
+
+  {
+    auto cmd_buf = app.GetCommandBuffer();
+    app.BeginCommandBuffer(&cmd_buf);
+    const VkAccessFlags access =
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    app.FillHostVisibleBuffer(time_buffer.get(), time_data, sizeof(time_data),
+                              0, &cmd_buf, access,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    app.FillSmallBuffer(simulation_buffer.get(), particles.data(),
+                        particles.size() * sizeof(simulation_data), 0,
+                        &cmd_buf, access);
+    app.FillSmallBuffer(position_buffer.get(), positions.data(),
+                        positions.size() * sizeof(float), 0, &cmd_buf, access);
+    app.FillSmallBuffer(velocity_buffer.get(), velocities.data(),
+                        velocities.size() * sizeof(float), 0, &cmd_buf,
+                        access);
+    app.FillSmallBuffer(half_position_buffer.get(), half_positions.data(),
+                        half_positions.size() * sizeof(uint32_t), 0, &cmd_buf,
+                        access);
+    LOG_ASSERT(==, data->logger(), VK_SUCCESS,
+               app.EndAndSubmitCommandBufferAndWaitForQueueIdle(
+                   &cmd_buf, &app.render_queue()));
+  }
+
+  // The bindings of the compute shaders, see particle_update.comp.
+  VkDescriptorSetLayoutBinding bindings[6];
+  for (uint32_t i = 0; i < 6; ++i) {
+    bindings[i] = {
+        i,                                  // binding
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,  // descriptorType
+        1,                                  // descriptorCount
+        VK_SHADER_STAGE_COMPUTE_BIT,        // stageFlags
+        nullptr                             // pImmutableSamplers
+    };
+  }
+  auto descriptor_set = containers::make_unique<vulkan::DescriptorSet>(
+      data->allocator(),
+      app.AllocateDescriptorSet({bindings[0], bindings[1], bindings[2],
+                                 bindings[3], bindings[4], bindings[5]}));
+  const VkDescriptorBufferInfo buffer_infos[6] = {
+      {*time_buffer, 0, VK_WHOLE_SIZE},
+      {*simulation_buffer, 0, VK_WHOLE_SIZE},
+      {*draw_buffer, 0, VK_WHOLE_SIZE},
+      {*position_buffer, 0, VK_WHOLE_SIZE},
+      {*velocity_buffer, 0, VK_WHOLE_SIZE},
+      {*half_position_buffer, 0, VK_WHOLE_SIZE},
+  };
+  const VkWriteDescriptorSet write{
+      VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,  // sType
+      nullptr,                                 // pNext
+      *descriptor_set,                         // dstSet
+      0,                                       // dstBinding
+      0,                                       // dstArrayElement
+      6,                                       // descriptorCount
+      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,       // descriptorType
+      nullptr,                                 // pImageInfo
+      buffer_infos,                            // pBufferInfo
+      nullptr,                                 // pTexelBufferView
+  };
+  device->vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+  auto pipeline_layout = containers::make_unique<vulkan::PipelineLayout>(
+      data->allocator(),
+      app.CreatePipelineLayout({{bindings[0], bindings[1], bindings[2],
+                                 bindings[3], bindings[4], bindings[5]}}));
+
+  vulkan::VkQueryPool query_pool = vulkan::CreateQueryPool(
+      &device, {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO, nullptr, 0,
+                VK_QUERY_TYPE_TIMESTAMP, 2, 0});
+
+  for (uint32_t num_particles : kParticleCounts) {
+    float aos_ms = 0.0f;
+    for (int32_t layout : kLayouts) {
+      const SimulationConstants constants = {layout, num_particles};
+      const VkSpecializationInfo specialization_info = {
+          2,                           // mapEntryCount
+          kSimulationConstantEntries,  // pMapEntries
+          sizeof(constants),           // dataSize
+          &constants,                  // pData
+      };
+      vulkan::VulkanComputePipeline velocity_pipeline =
+          app.CreateComputePipeline(
+              pipeline_layout.get(),
+              VkShaderModuleCreateInfo{
+                  VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, nullptr, 0,
+                  sizeof(velocity_shader), velocity_shader},
+              "main", &specialization_info);
+      vulkan::VulkanComputePipeline position_pipeline =
+          app.CreateComputePipeline(
+              pipeline_layout.get(),
+              VkShaderModuleCreateInfo{
+                  VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, nullptr, 0,
+                  sizeof(simulation_shader), simulation_shader},
+              "main", &specialization_info);
+
+      auto cmd_buf = app.GetCommandBuffer();
+      app.BeginCommandBuffer(&cmd_buf);
+      cmd_buf->vkCmdResetQueryPool(cmd_buf, query_pool, 0, 2);
+      cmd_buf->vkCmdBindDescriptorSets(
+          cmd_buf, VK_PIPELINE_BIND_POINT_COMPUTE, *pipeline_layout, 0, 1,
+          &descriptor_set->raw_set(), 0, nullptr);
+      cmd_buf->vkCmdWriteTimestamp(cmd_buf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                   query_pool, 0);
+      // Each pass has to see everything that the one before wrote.
+      const VkMemoryBarrier barrier = {
+          VK_STRUCTURE_TYPE_MEMORY_BARRIER,  // sType
+          nullptr,                           // pNext
+          VK_ACCESS_SHADER_WRITE_BIT,        // srcAccessMask
+          VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,  // dst
+      };
+      for (uint32_t step = 0; step < kNumSteps; ++step) {
+        cmd_buf->vkCmdBindPipeline(cmd_buf, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                   velocity_pipeline);
+        cmd_buf->vkCmdDispatch(cmd_buf,
+                               num_particles / COMPUTE_SHADER_LOCAL_SIZE, 1, 1);
+        cmd_buf->vkCmdPipelineBarrier(
+            cmd_buf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr,
+            0, nullptr);
+        cmd_buf->vkCmdBindPipeline(cmd_buf, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                   position_pipeline);
+        cmd_buf->vkCmdDispatch(cmd_buf,
+                               num_particles / COMPUTE_SHADER_LOCAL_SIZE, 1, 1);
+        cmd_buf->vkCmdPipelineBarrier(
+            cmd_buf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr,
+            0, nullptr);
+      }
+      cmd_buf->vkCmdWriteTimestamp(
+          cmd_buf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 1);
+      LOG_ASSERT(==, data->logger(), VK_SUCCESS,
+                 app.EndAndSubmitCommandBufferAndWaitForQueueIdle(
+                     &cmd_buf, &app.render_queue()));
+
+      uint64_t timestamps[2];
+      LOG_ASSERT(==, data->logger(), VK_SUCCESS,
+                 device->vkGetQueryPoolResults(
+                     device, query_pool, 0, 2, sizeof(timestamps), timestamps,
+                     sizeof(uint64_t),
+                     VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+      const uint64_t ticks = (timestamps[1] - timestamps[0]) & timestamp_mask;
+      const float step_ms =
+          ticks * app.physical_device_properties().limits.timestampPeriod /
+          1000000.0f / kNumSteps;
+      if (layout == SIMULATION_LAYOUT_AOS) {
+        aos_ms = step_ms;
+      }
+      const double bytes = BytesPerStep(layout, num_particles);
+      data->logger()->LogInfo(
+          num_particles, " particles, ", LayoutName(layout), ": ", step_ms,
+          " ms per step (", aos_ms / step_ms, "x AoS), ",
+          bytes / (1024 * 1024), " MB per step, ",
+          bytes / (step_ms * 1000000.0), " GB/s");
+    }
+  }
+
+  data->logger()->LogInfo("Application Shutdown");
+  return 0;
+}
@@ -113,7 +113,9 @@ class RenderQuadSample
         Sample<RenderQuadFrameData>(
             // Each copy of color unpacked source data is: 400*400*4 bytes.
             data->allocator(), data, 10, 512, 10, 1,
-            sample_application::SampleOptions().EnableDepthBuffer(),
+            sample_application::SampleOptions()
+                .EnableDepthBuffer()
+                .EnableRenderOnDemand(),
             requested_features),
         plane_(data->allocator(), data->logger(), plane_data) {}
   virtual void InitializeApplicationData(
@@ -522,7 +524,8 @@ class RenderQuadSample
   }
 
   virtual void Update(float time_since_last_render) override {
-    // Do not update any data in this sample.
+    // Do not update any data in this sample. Nothing changes, so only the
+    // first frame is rendered.
   }
 
   virtual void Render(vulkan::VkQueue* queue, size_t frame_index,
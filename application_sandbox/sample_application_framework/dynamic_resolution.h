@@ -0,0 +1,111 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SAMPLE_APPLICATION_FRAMEWORK_DYNAMIC_RESOLUTION_H_
+#define SAMPLE_APPLICATION_FRAMEWORK_DYNAMIC_RESOLUTION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace sample_application {
+
+// DynamicResolutionController picks the size to render at, so that the GPU
+// time of a frame stays close to a target. The time of a frame is taken to
+// be proportional to the number of pixels rendered, so each dimension is
+// scaled by the square root of target / measured time.
+// Frame times are smoothed, and the size only changes once the smoothed time
+// is more than kTolerance away from the target, so that the size does not
+// flicker between two values.
+class DynamicResolutionController {
+ public:
+  // How far, relative to the target, the smoothed frame time may be from the
+  // target before the size changes.
+  static constexpr float kTolerance = 0.1f;
+  // The weight of the newest frame time in the smoothed one.
+  static constexpr float kSmoothing = 0.1f;
+  // Widths and heights are kept to multiples of this, which is friendlier to
+  // the tiling of most GPUs.
+  static const uint32_t kGranularity = 8;
+
+  DynamicResolutionController(float target_frame_time_ms, uint32_t full_width,
+                              uint32_t full_height, float min_scale = 0.5f)
+      : target_ms_(target_frame_time_ms),
+        full_width_(full_width),
+        full_height_(full_height),
+        min_scale_(min_scale),
+        scale_(1.0f),
+        smoothed_ms_(0.0f),
+        width_(full_width),
+        height_(full_height) {}
+
+  // Adds the GPU time of one frame, in milliseconds. Returns true if the size
+  // to render at has changed.
+  bool AddFrameTime(float gpu_ms) {
+    smoothed_ms_ = smoothed_ms_ == 0.0f
+                       ? gpu_ms
+                       : gpu_ms * kSmoothing + smoothed_ms_ * (1 - kSmoothing);
+    if (std::fabs(smoothed_ms_ - target_ms_) <= target_ms_ * kTolerance ||
+        smoothed_ms_ <= 0.0f) {
+      return false;
+    }
+    const float scale =
+        std::min(1.0f, std::max(min_scale_, scale_ * std::sqrt(target_ms_ /
+                                                               smoothed_ms_)));
+    const uint32_t width = Quantize(scale * full_width_, full_width_);
+    const uint32_t height = Quantize(scale * full_height_, full_height_);
+    if (width == width_ && height == height_) {
+      return false;
+    }
+    // The smoothed time still mostly reflects the old size, so predict what
+    // it would have been at the new one. Otherwise it keeps pushing the size
+    // the same way for several frames, and overshoots.
+    smoothed_ms_ *= (static_cast<float>(width) * height) /
+                    (static_cast<float>(width_) * height_);
+    scale_ = scale;
+    width_ = width;
+    height_ = height;
+    return true;
+  }
+
+  float target_frame_time() const { return target_ms_; }
+  float smoothed_frame_time() const { return smoothed_ms_; }
+  float scale() const { return scale_; }
+  uint32_t width() const { return width_; }
+  uint32_t height() const { return height_; }
+
+ private:
+  static uint32_t Quantize(float size, uint32_t full_size) {
+    uint32_t quantized =
+        static_cast<uint32_t>(size + kGranularity / 2) / kGranularity *
+        kGranularity;
+    if (quantized < kGranularity) {
+      quantized = kGranularity;
+    }
+    return std::min(full_size, quantized);
+  }
+
+  float target_ms_;
+  uint32_t full_width_;
+  uint32_t full_height_;
+  float min_scale_;
+  float scale_;
+  float smoothed_ms_;
+  uint32_t width_;
+  uint32_t height_;
+};
+
+}  // namespace sample_application
+
+#endif  // SAMPLE_APPLICATION_FRAMEWORK_DYNAMIC_RESOLUTION_H_
@@ -0,0 +1,119 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SAMPLE_APPLICATION_FRAMEWORK_LATENCY_TRACKER_H_
+#define SAMPLE_APPLICATION_FRAMEWORK_LATENCY_TRACKER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "support/containers/allocator.h"
+#include "support/containers/vector.h"
+
+namespace sample_application {
+
+// LatencyTracker measures how long it takes for input to show up on screen.
+// It makes up input that arrives every input_period(), like a timer would,
+// starting when the tracker is created. Each Update takes the inputs that
+// arrived since the one before, the frame it goes into carries them, and
+// once that frame has been presented, the latency of every one of them is
+// recorded. So the latencies include the wait for the next Update, just as
+// they would for real input.
+class LatencyTracker {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // The inputs [first, end) in the order they arrived.
+  struct Inputs {
+    uint64_t first;
+    uint64_t end;
+    bool empty() const { return first == end; }
+  };
+
+  // Inputs that follow each other, |a| before |b|, as one range.
+  static Inputs Merge(const Inputs& a, const Inputs& b) {
+    if (a.empty()) {
+      return b;
+    }
+    if (b.empty()) {
+      return a;
+    }
+    return {a.first, b.end};
+  }
+
+  explicit LatencyTracker(containers::Allocator* allocator)
+      : start_(Clock::now()),
+        // Not a divisor of common refresh periods, so inputs arrive all over
+        // the frame.
+        input_period_(std::chrono::microseconds(1700)),
+        next_input_(0),
+        latencies_ms_(allocator) {}
+
+  // Takes all of the inputs that arrived up to |now|, and not taken before.
+  Inputs TakeInputs(Clock::time_point now) {
+    const uint64_t end = (now - start_) / input_period_ + 1;
+    Inputs inputs = {next_input_, std::max(next_input_, end)};
+    next_input_ = inputs.end;
+    return inputs;
+  }
+
+  // Records that the frame that carried |inputs| was presented at |time|.
+  void Complete(const Inputs& inputs, Clock::time_point time) {
+    for (uint64_t i = inputs.first; i < inputs.end; ++i) {
+      const Clock::time_point arrival = start_ + input_period_ * i;
+      latencies_ms_.push_back(
+          std::chrono::duration<float, std::milli>(time - arrival).count());
+    }
+  }
+
+  Clock::duration input_period() const { return input_period_; }
+
+  // Logs the distribution of the latencies that were recorded. |presented|
+  // says how the time of presentation was measured. Logger can be anything
+  // with a LogInfo(...) like logging::Logger.
+  template <typename Logger>
+  void LogReport(Logger* log, const char* presented, const char* present_mode) {
+    if (latencies_ms_.empty()) {
+      log->LogInfo("Input to present latency: no frame was presented");
+      return;
+    }
+    std::sort(latencies_ms_.begin(), latencies_ms_.end());
+    float total = 0.0f;
+    for (float latency : latencies_ms_) {
+      total += latency;
+    }
+    log->LogInfo("Input to present latency (", presented, ", ", present_mode,
+                 "): ", latencies_ms_.size(), " of ", next_input_,
+                 " inputs measured, mean ", total / latencies_ms_.size(),
+                 " ms, min ", latencies_ms_.front(), " ms, p50 ",
+                 Percentile(50), " ms, p90 ", Percentile(90), " ms, p99 ",
+                 Percentile(99), " ms, max ", latencies_ms_.back(), " ms");
+  }
+
+ private:
+  // Only valid once latencies_ms_ is sorted.
+  float Percentile(size_t percent) const {
+    return latencies_ms_[(latencies_ms_.size() - 1) * percent / 100];
+  }
+
+  const Clock::time_point start_;
+  const Clock::duration input_period_;
+  uint64_t next_input_;
+  containers::vector<float> latencies_ms_;
+};
+
+}  // namespace sample_application
+
+#endif  // SAMPLE_APPLICATION_FRAMEWORK_LATENCY_TRACKER_H_
@@ -0,0 +1,122 @@
+// Copyright 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SAMPLE_APPLICATION_FRAMEWORK_PIPELINED_UPDATE_H_
+#define SAMPLE_APPLICATION_FRAMEWORK_PIPELINED_UPDATE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace sample_application {
+
+// UpdateWorker runs one function at a time on its own thread. With
+// pipelined updates the Sample uses it to run the Update of the next frame
+// while the main thread renders the current one, and with additional outputs
+// to record the commands of each of them while the main one renders.
+class UpdateWorker {
+ public:
+  UpdateWorker()
+      : has_work_(false),
+        exit_(false),
+        thread_(&UpdateWorker::ThreadMain, this) {}
+  ~UpdateWorker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exit_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+  }
+  UpdateWorker(const UpdateWorker&) = delete;
+  UpdateWorker& operator=(const UpdateWorker&) = delete;
+
+  // Starts running |work| on the worker thread. The work that was started
+  // before must have been waited for.
+  void Start(std::function<void()> work) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      work_ = std::move(work);
+      has_work_ = true;
+    }
+    condition_.notify_all();
+  }
+
+  // Waits until the work that was started last has returned. Returns
+  // immediately if there is none.
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() { return !has_work_; });
+  }
+
+ private:
+  void ThreadMain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      condition_.wait(lock, [this]() { return has_work_ || exit_; });
+      if (exit_) {
+        return;
+      }
+      lock.unlock();
+      work_();
+      lock.lock();
+      has_work_ = false;
+      condition_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::function<void()> work_;
+  bool has_work_;
+  bool exit_;
+  // Declared last, so that everything it uses is initialized before it
+  // starts.
+  std::thread thread_;
+};
+
+// DoubleBuffered holds the state that a pipelined sample simulates in
+// Update and draws in Render. Update only touches update_state(), and
+// Render only reads render_state(), so the two can run at the same time.
+// Publish() hands the result of the last Update over to Render, it must
+// be called from PublishUpdate().
+template <typename T>
+class DoubleBuffered {
+ public:
+  DoubleBuffered() : update_index_(0) {}
+  explicit DoubleBuffered(const T& initial) : update_index_(0) {
+    states_[0] = initial;
+    states_[1] = initial;
+  }
+
+  T& update_state() { return states_[update_index_]; }
+  const T& render_state() const { return states_[1 - update_index_]; }
+
+  // Makes the state written by the last Update the one that Render reads.
+  // The next Update continues from a copy of it.
+  void Publish() {
+    update_index_ = 1 - update_index_;
+    states_[update_index_] = states_[1 - update_index_];
+  }
+
+ private:
+  T states_[2];
+  size_t update_index_;
+};
+
+}  // namespace sample_application
+
+#endif  // SAMPLE_APPLICATION_FRAMEWORK_PIPELINED_UPDATE_H_
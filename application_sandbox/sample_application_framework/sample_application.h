@@ -15,18 +15,28 @@
 #ifndef SAMPLE_APPLICATION_FRAMEWORK_SAMPLE_APPLICATION_H_
 #define SAMPLE_APPLICATION_FRAMEWORK_SAMPLE_APPLICATION_H_
 
+#include "application_sandbox/sample_application_framework/dynamic_resolution.h"
+#include "application_sandbox/sample_application_framework/latency_tracker.h"
+#include "application_sandbox/sample_application_framework/pipelined_update.h"
+#include "support/containers/deque.h"
+#include "support/containers/tagged_allocator.h"
 #include "support/entry/entry.h"
 #include "vulkan_helpers/helper_functions.h"
 #include "vulkan_helpers/vulkan_application.h"
 
 #include <chrono>
 #include <cstddef>
+#include <thread>
 
 namespace sample_application {
 
 const static VkSampleCountFlagBits kVkMultiSampledSampleCount =
     VK_SAMPLE_COUNT_4_BIT;
 const static VkFormat kDepthFormat = VK_FORMAT_D16_UNORM;
+// How long ProcessFrame sleeps when rendering on demand and there is nothing
+// to render. About one refresh at 60Hz, so a request is not held up for
+// long.
+const static std::chrono::milliseconds kRenderOnDemandIdleTime(16);
 const static VkFormat kMutableSwapchainFormats[] = {VK_FORMAT_B8G8R8A8_UNORM,
                                                     VK_FORMAT_B8G8R8A8_SRGB};
 const static VkImageFormatListCreateInfoKHR kMutableSwapchainImageFormatList = {
@@ -48,6 +58,16 @@ struct SampleOptions {
   bool mutable_swapchain_format = false;
   bool enable_display_timing = false;
   bool enable_10bit_hdr = false;
+  bool resolve_in_render_pass = false;
+  bool track_driver_memory = false;
+  bool pipelined_update = false;
+  float dynamic_resolution_target_ms = 0.0f;
+  bool render_on_demand = false;
+  uint32_t front_buffer_bands = 0;
+  // The most outputs that can be added besides the main one.
+  static const size_t kMaxAdditionalOutputs = 3;
+  size_t num_additional_outputs = 0;
+  VkExtent2D additional_output_extents[kMaxAdditionalOutputs] = {};
   void* device_extension_structures = nullptr;
 
   SampleOptions& EnableMultisampling() {
@@ -106,6 +126,85 @@ struct SampleOptions {
     enable_10bit_hdr = true;
     return *this;
   }
+  // The sample resolves the multisampled target into resolve_view() through
+  // pResolveAttachments in its own render pass. The framework then skips its
+  // vkCmdResolveImage, and the multisampled target becomes transient.
+  SampleOptions& EnableInRenderPassResolve() {
+    resolve_in_render_pass = true;
+    return *this;
+  }
+  // Counts the host memory that the driver allocates for the device and the
+  // objects created through the framework, per object type and per frame.
+  // The totals are logged when the application exits. Running with
+  // -memory-report turns this on for every sample.
+  SampleOptions& EnableDriverMemoryTracking() {
+    track_driver_memory = true;
+    return *this;
+  }
+  // Runs the Update of the next frame on a worker thread, while the current
+  // frame is rendered, so a frame takes about as long as the slower of the
+  // two rather than both. Update and Render then run at the same time, so
+  // the sample must keep the state they share in DoubleBuffered, and
+  // publish it in PublishUpdate(). The time passed to Update is that of the
+  // frame before.
+  SampleOptions& EnablePipelinedUpdate() {
+    pipelined_update = true;
+    return *this;
+  }
+  // Renders each frame into an offscreen target, at a size picked from GPU
+  // timestamps so that a frame takes about |target_frame_time_ms| on the
+  // GPU, and blits that up to the swapchain image. viewport() and scissor()
+  // cover the area to render to in the current frame, so the sample must
+  // set them as dynamic state in command buffers it records every frame.
+  // It is turned off, with a message, when combined with multisampling or a
+  // mutable swapchain format, with a separate present queue, or if the
+  // render queue has no timestamps.
+  SampleOptions& EnableDynamicResolution(float target_frame_time_ms) {
+    dynamic_resolution_target_ms = target_frame_time_ms;
+    return *this;
+  }
+  // Only renders and presents a frame when the sample asked for one with
+  // RequestRender(), usually from Update when something has changed, on the
+  // first frame, and when the window was exposed or resized. Otherwise
+  // ProcessFrame only runs Update and then sleeps, so a static sample costs
+  // next to nothing while idle. It is ignored when a frame is to be written
+  // out, since that counts presents.
+  SampleOptions& EnableRenderOnDemand() {
+    render_on_demand = true;
+    return *this;
+  }
+  // Renders straight into the single image of a shared presentable swapchain
+  // in SHARED_CONTINUOUS_REFRESH mode, which the display keeps scanning out,
+  // instead of going through a ring of swapchain images. The image is
+  // acquired and presented once, and each frame is then rendered in
+  // |bands| horizontal bands, top to bottom, so the top of the image is
+  // finished without waiting for the rest. Render is called for every band,
+  // with the band as frame_index and scissor() covering it, and the sample
+  // must keep its color attachment in color_attachment_layout() and limit
+  // its render area to scissor(). The sample must ask for the extensions
+  // that shared presentation needs. It is turned off, with a message, when
+  // combined with multisampling, dynamic resolution or display timing, with
+  // a separate present queue, or when a frame is to be written out, and
+  // frames are then presented through the shared image as usual.
+  SampleOptions& EnableFrontBufferRendering(uint32_t bands = 4) {
+    shared_presentation = true;
+    front_buffer_bands = bands;
+    return *this;
+  }
+  // Also renders to another window of the given size, such as a preview
+  // next to the main one. Every frame, an image of each output is acquired
+  // along with the main one, RecordOutput records the commands for it on a
+  // thread of its own while Render runs, and all of the swapchains are
+  // presented with a single vkQueuePresentKHR. Outputs that cannot be
+  // created are left out with a message, as are all of them when combined
+  // with front buffer rendering, display timing or a separate present
+  // queue.
+  SampleOptions& AddOutput(uint32_t width, uint32_t height) {
+    if (num_additional_outputs < kMaxAdditionalOutputs) {
+      additional_output_extents[num_additional_outputs++] = {width, height};
+    }
+    return *this;
+  }
   SampleOptions& AddDeviceExtensionStructure(void* device_extension_structure) {
     device_extension_structures = device_extension_structure;
     return *this;
@@ -149,6 +248,9 @@ class Sample {
     ::VkImage swapchain_image_;
     // The view for the image that is to be rendered to on this frame.
     containers::unique_ptr<vulkan::VkImageView> image_view;
+    // The view of the swapchain image that the multisampled target is
+    // resolved into, if resolving in the render pass.
+    containers::unique_ptr<vulkan::VkImageView> resolve_view_;
     // The view for the depth that is to be rendered to on this frame
     containers::unique_ptr<vulkan::VkImageView> depth_view_;
     // A commandbuffer to transfer the swapchain from the present queue to
@@ -171,6 +273,17 @@ class Sample {
     vulkan::ImagePointer depth_stencil_;
     // The multisampled render target if it exists.
     vulkan::ImagePointer multisampled_target_;
+    // The offscreen target that is rendered to with dynamic resolution.
+    vulkan::ImagePointer scaled_target_;
+    // The commandbuffer that blits the rendered area of scaled_target_ to the
+    // swapchain image and gets it ready for present. It is recorded again
+    // every frame, as the rendered area changes.
+    containers::unique_ptr<vulkan::VkCommandBuffer> upscale_command_buffer_;
+    // True once this frame has written its timestamps.
+    bool has_timestamps_;
+    // When measuring latency without display timing, the inputs that this
+    // frame shows, until its work has finished.
+    LatencyTracker::Inputs inputs_;
     // The semaphore controlling access to the swapchain.
     containers::unique_ptr<vulkan::VkSemaphore> ready_semaphore_;
     // The fence that signals that the resources for this frame are free.
@@ -207,13 +320,28 @@ class Sample {
             options.mutable_swapchain_format ? &kMutableSwapchainImageFormatList
                                              : nullptr,
             options.enable_vulkan_1_1, options.enable_10bit_hdr,
-            options.device_extension_structures),
+            options.device_extension_structures, options.track_driver_memory),
         frame_data_(allocator),
         swapchain_images_(application_.swapchain_images()),
         last_frame_time_(std::chrono::high_resolution_clock::now()),
         initialization_command_buffer_(application_.GetCommandBuffer()),
         average_frame_time_(0),
-        is_valid_(true) {
+        is_valid_(true),
+        update_worker_(options.pipelined_update
+                           ? containers::make_unique<UpdateWorker>(allocator)
+                           : nullptr),
+        first_update_(true),
+        render_requested_(true),
+        latency_tracker_(
+            entry_data->measure_latency()
+                ? containers::make_unique<LatencyTracker>(allocator, allocator)
+                : nullptr),
+        pending_inputs_({0, 0}),
+        presented_inputs_(allocator),
+        front_buffer_bands_(0),
+        outputs_(allocator),
+        timestamp_mask_(0),
+        upscale_filter_(VK_FILTER_NEAREST) {
     if (data_->fixed_timestep()) {
       app()->GetLogger()->LogInfo("Running with a fixed timestep of 0.1s");
     }
@@ -242,6 +370,16 @@ class Sample {
     default_scissor_ = {
         {0, 0},
         {application_.swapchain().width(), application_.swapchain().height()}};
+
+    if (options.dynamic_resolution_target_ms > 0.0f) {
+      SetupDynamicResolution();
+    }
+    if (options.front_buffer_bands > 0) {
+      SetupFrontBufferRendering();
+    }
+    if (options.num_additional_outputs > 0) {
+      SetupAdditionalOutputs();
+    }
   }
 
   // This must be called before any other methods on this class. It initializes
@@ -249,11 +387,19 @@ class Sample {
   // on the subclass, as well as InitializeLocalFrameData for every
   // image in the swapchain.
   void Initialize() {
+    // Everything the sample sets up is charged to it, unless it is
+    // explicitly allocated for another subsystem.
+    containers::ScopedAllocationTag tag(containers::AllocationTag::kSampleData);
     initialization_command_buffer_->vkBeginCommandBuffer(
         initialization_command_buffer_, &kBeginCommandBuffer);
-
-    InitializeApplicationData(&initialization_command_buffer_,
-                              swapchain_images_.size());
+    app()->debug_labels().BeginLabel(&initialization_command_buffer_,
+                                     "Initialization");
+
+    // When rendering to the front buffer, every band gets its own frame
+    // data, as it is rendered while the others may still be in flight.
+    const size_t num_frames =
+        front_buffer_bands_ ? front_buffer_bands_ : swapchain_images_.size();
+    InitializeApplicationData(&initialization_command_buffer_, num_frames);
 	
     if (options_.enable_10bit_hdr) {
       VkHdrMetadataEXT hdr10_metadata{
@@ -274,12 +420,19 @@ class Sample {
           &hdr10_metadata);
     }
 
-    for (size_t i = 0; i < swapchain_images_.size(); ++i) {
+    for (size_t i = 0; i < num_frames; ++i) {
+      if (front_buffer_bands_) {
+        default_scissor_ = FrontBufferBand(static_cast<uint32_t>(i));
+      }
       frame_data_.push_back(SampleFrameData());
       InitializeLocalFrameData(&frame_data_.back(),
                                &initialization_command_buffer_, i);
     }
+    default_scissor_ = {
+        {0, 0},
+        {application_.swapchain().width(), application_.swapchain().height()}};
 
+    app()->debug_labels().EndLabel(&initialization_command_buffer_);
     initialization_command_buffer_->vkEndCommandBuffer(
         initialization_command_buffer_);
 
@@ -301,13 +454,48 @@ class Sample {
       application_.render_queue()->vkQueueSubmit(
           application_.render_queue(), 0, nullptr, *frame_data.ready_fence_);
     }
+    if (front_buffer_bands_) {
+      AcquireFrontBuffer();
+    }
+
+    if (resolves_in_render_pass()) {
+      // A vkCmdResolveImage reads every sample of the multisampled target
+      // back from memory after the render pass has stored it. Resolving in
+      // the render pass removes that read, and with transient memory the
+      // store as well.
+      const size_t multisampled_bytes =
+          vulkan::GetImageExtentSizeInBytes(
+              {application_.swapchain().width(),
+               application_.swapchain().height(), 1},
+              render_target_format_) *
+          num_samples_;
+      app()->GetLogger()->LogInfo(
+          "Resolving in the render pass saves ",
+          application_.HasTransientImageMemory() ? 2 * multisampled_bytes
+                                                 : multisampled_bytes,
+          " bytes of multisampled target traffic per frame");
+    }
 
     application_.InitializationComplete();
     InitializationComplete();
     data_->NotifyReady();
   }
 
-  void WaitIdle() { app()->device()->vkDeviceWaitIdle(app()->device()); }
+  // Waits for the device to finish all of its work. Samples call this just
+  // before they exit, so with -fast-exit this also starts bulk teardown.
+  void WaitIdle() {
+    app()->device()->vkDeviceWaitIdle(app()->device());
+    if (latency_tracker_) {
+      latency_tracker_->LogReport(
+          app()->GetLogger(),
+          options_.enable_display_timing ? "display timing"
+                                         : "GPU completion (fence)",
+          PresentModeName(app()->swapchain().present_mode()));
+    }
+    if (data_->fast_exit()) {
+      app()->BeginBulkTeardown();
+    }
+  }
 
   // The format that we are using to render. This will be either the swapchain
   // format if we are not rendering multi-sampled, or the multisampled image
@@ -318,6 +506,12 @@ class Sample {
 
   // The number of samples that we are rendering with.
   VkSampleCountFlagBits num_samples() const { return num_samples_; }
+  // True if the sample resolves the multisampled target into resolve_view()
+  // from within its render pass.
+  bool resolves_in_render_pass() const {
+    return options_.resolve_in_render_pass && options_.enable_multisampling &&
+           !options_.enable_mixed_multisampling;
+  }
   // The number of color samples that will be used with mixed sampling
   VkSampleCountFlagBits num_color_samples() const { return num_color_samples_; }
   // The number of depth/stencil samples that will be used with mixed sampling
@@ -326,23 +520,108 @@ class Sample {
   vulkan::VulkanApplication* app() { return &application_; }
   const vulkan::VulkanApplication* app() const { return &application_; }
 
+  // With dynamic resolution these cover only the area of the render target
+  // that is rendered to in the current frame. When rendering to the front
+  // buffer, the scissor covers the band of the frame being initialized or
+  // rendered.
   const VkViewport& viewport() const { return default_viewport_; }
   const VkRect2D& scissor() const { return default_scissor_; }
+  bool dynamic_resolution() const { return resolution_controller_ != nullptr; }
+  bool front_buffer_rendering() const { return front_buffer_bands_ != 0; }
+  // The layout that the color attachment is in before and after Render.
+  VkImageLayout color_attachment_layout() const {
+    return front_buffer_bands_ ? VK_IMAGE_LAYOUT_SHARED_PRESENT_KHR
+                               : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  }
+
+  // The outputs that were added with SampleOptions::AddOutput, and could be
+  // created. RecordOutput renders to them.
+  size_t num_additional_outputs() const { return outputs_.size(); }
+  VkExtent2D output_extent(size_t output) const {
+    const vulkan::VkSwapchainKHR& swapchain =
+        outputs_[output]->output->swapchain;
+    return {swapchain.width(), swapchain.height()};
+  }
+  VkFormat output_format(size_t output) const {
+    return outputs_[output]->output->swapchain.format();
+  }
+  size_t output_image_count(size_t output) const {
+    return outputs_[output]->views.size();
+  }
+  const ::VkImageView& output_view(size_t output, size_t image_index) const {
+    return outputs_[output]->views[image_index]->get_raw_object();
+  }
+
+  // Asks for the next frame to be rendered when rendering on demand. With
+  // pipelined updates, a request made from Update applies to the frame that
+  // shows the results of that Update.
+  void RequestRender() { render_requested_ = true; }
 
   // This calls both Update(time) and Render() for the subclass.
   // The update is meant to update all of the non-graphics state of the
   // application. Render() is used to actually process the commands
   // for rendering this particular frame.
   void ProcessFrame() {
+    if (latency_tracker_ && !options_.enable_display_timing) {
+      CompleteFinishedFrames();
+    }
+    entry::WindowEvent event;
+    while (data_->PollWindowEvent(&event)) {
+      if (event.type == entry::WindowEvent::Type::kExpose ||
+          event.type == entry::WindowEvent::Type::kResize) {
+        // What is on screen was lost, or no longer fits the window.
+        RequestRender();
+      }
+      HandleWindowEvent(event);
+    }
     auto current_time = std::chrono::high_resolution_clock::now();
     std::chrono::duration<float> elapsed_time = current_time - last_frame_time_;
     last_frame_time_ = current_time;
-    Update(data_->fixed_timestep() ? 0.1f : elapsed_time.count());
+    const float update_time =
+        data_->fixed_timestep() ? 0.1f : elapsed_time.count();
+    // When pipelined, the Update for this frame already ran during the last
+    // one, except on the very first frame.
+    if (!update_worker_ || first_update_) {
+      RunUpdate(update_time);
+      first_update_ = false;
+    }
+    PublishUpdate();
+    // Everything Update wrote to mapped memory for this frame goes to the
+    // device in one flush, before anything is submitted.
+    app()->mapped_range_batcher()->Flush();
+    // Taken before the next Update starts, which may request the frame
+    // after this one.
+    const bool render_frame = !options_.render_on_demand ||
+                              data_->output_frame_index() >= 0 ||
+                              render_requested_;
+    render_requested_ = false;
+    // Inputs of frames that are not rendered go into the next one that is.
+    LatencyTracker::Inputs frame_inputs = {0, 0};
+    if (latency_tracker_ && render_frame) {
+      frame_inputs = pending_inputs_;
+      pending_inputs_ = {0, 0};
+    }
+    if (update_worker_) {
+      update_worker_->Start([this, update_time]() { RunUpdate(update_time); });
+    }
+    if (!render_frame) {
+      std::this_thread::sleep_for(kRenderOnDemandIdleTime);
+      if (update_worker_) {
+        update_worker_->Wait();
+      }
+      return;
+    }
 
     // Smooth this out, so that it is more sensible.
     average_frame_time_ =
         elapsed_time.count() * 0.05f + average_frame_time_ * 0.95f;
 
+    if (front_buffer_bands_) {
+      RenderFrontBuffer(frame_inputs);
+      EndFrame();
+      return;
+    }
+
 	// Display Timing
     VkRefreshCycleDurationGOOGLE rc_dur = {};
     static unsigned refresh_multiplier = 1;
@@ -366,6 +645,9 @@ class Sample {
             app()->device(), app()->swapchain(), &count, &past[0]);
 
         for (uint32_t i = 0; i < count; ++i) {
+          if (latency_tracker_) {
+            CompletePresentedFrame(past[i]);
+          }
           if (past[i].actualPresentTime >
               (past[i].desiredPresentTime + rc_dur.refreshDuration)) {
             early_frame_count = 0;
@@ -428,13 +710,25 @@ class Sample {
 
     ::VkFence ready_fence = *frame_data_[image_idx].ready_fence_;
 
-    LOG_ASSERT(
+    LOG_DEBUG_ASSERT(
         ==, app()->GetLogger(), VK_SUCCESS,
         app()->device()->vkWaitForFences(app()->device(), 1, &ready_fence,
                                          VK_FALSE, 0xFFFFFFFFFFFFFFFF));
-    LOG_ASSERT(
+    if (latency_tracker_ && !options_.enable_display_timing) {
+      // The last frame that used this image is done, record it before its
+      // inputs are replaced.
+      CompleteFinishedFrames();
+      frame_data_[image_idx].inputs_ = frame_inputs;
+    }
+    LOG_DEBUG_ASSERT(
         ==, app()->GetLogger(), VK_SUCCESS,
         app()->device()->vkResetFences(app()->device(), 1, &ready_fence));
+    if (resolution_controller_) {
+      UpdateDynamicResolution(image_idx);
+    }
+    if (!outputs_.empty()) {
+      StartRecordingOutputs(image_idx);
+    }
     if (options_.verbose_output) {
       app()->GetLogger()->LogInfo("Rendering frame <", elapsed_time.count(),
                                   ">: <", image_idx, ">", " Average: <",
@@ -471,12 +765,21 @@ class Sample {
           static_cast<::VkFence>(VK_NULL_HANDLE));
     }
 
+    // With dynamic resolution, the setup command buffer writes the start
+    // timestamp of the frame at TOP_OF_PIPE. Waiting only at
+    // COLOR_ATTACHMENT_OUTPUT would let it be written before the image is
+    // acquired, and count the wait for vsync as GPU time.
+    VkPipelineStageFlags render_wait_flags =
+        resolution_controller_
+            ? VkPipelineStageFlags(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT)
+            : flags;
+
     VkSubmitInfo init_submit_info{
         VK_STRUCTURE_TYPE_SUBMIT_INFO,  // sType
         nullptr,                        // pNext
         1,                              // waitSemaphoreCount
         &render_wait_semaphore,         // pWaitSemaphores
-        &flags,                         // pWaitDstStageMask,
+        &render_wait_flags,             // pWaitDstStageMask,
         1,                              // commandBufferCount
         &(frame_data_[image_idx].setup_command_buffer_->get_command_buffer()),
         0,       // signalSemaphoreCount
@@ -492,10 +795,18 @@ class Sample {
         app()->render_queue(), 1, &init_submit_info,
         static_cast<::VkFence>(VK_NULL_HANDLE));
 
-    Render(&app()->render_queue(), image_idx,
-           &frame_data_[image_idx].child_data_);
+    {
+      vulkan::ScopedDebugLabel<vulkan::VkQueue> label(
+          app()->debug_labels(), &app()->render_queue(), "Render");
+      Render(&app()->render_queue(), image_idx,
+             &frame_data_[image_idx].child_data_);
+    }
     init_submit_info.pCommandBuffers =
-        &(frame_data_[image_idx].resolve_command_buffer_->get_command_buffer());
+        resolution_controller_
+            ? &(frame_data_[image_idx]
+                    .upscale_command_buffer_->get_command_buffer())
+            : &(frame_data_[image_idx]
+                    .resolve_command_buffer_->get_command_buffer());
 
     init_submit_info.waitSemaphoreCount = 0;
     init_submit_info.pWaitSemaphores = nullptr;
@@ -503,8 +814,35 @@ class Sample {
     init_submit_info.signalSemaphoreCount = 1;
     init_submit_info.pSignalSemaphores = &present_ready_semaphore;
 
-    app()->render_queue()->vkQueueSubmit(
-        app()->render_queue(), 1, &init_submit_info, ::VkFence(ready_fence));
+    // Picks up whatever Render and RecordOutput left unflushed.
+    app()->mapped_range_batcher()->Flush();
+    if (outputs_.empty()) {
+      app()->render_queue()->vkQueueSubmit(
+          app()->render_queue(), 1, &init_submit_info, ::VkFence(ready_fence));
+    } else {
+      // The work of the other outputs goes in the same submission, so that
+      // the fence covers it as well.
+      ::VkSemaphore output_semaphores[SampleOptions::kMaxAdditionalOutputs];
+      VkPipelineStageFlags output_flags[SampleOptions::kMaxAdditionalOutputs];
+      ::VkCommandBuffer output_commands[SampleOptions::kMaxAdditionalOutputs];
+      FinishRecordingOutputs(image_idx, output_semaphores, output_flags,
+                             output_commands);
+      VkSubmitInfo output_submit_info{
+          VK_STRUCTURE_TYPE_SUBMIT_INFO,           // sType
+          nullptr,                                 // pNext
+          static_cast<uint32_t>(outputs_.size()),  // waitSemaphoreCount
+          output_semaphores,                       // pWaitSemaphores
+          output_flags,                            // pWaitDstStageMask,
+          static_cast<uint32_t>(outputs_.size()),  // commandBufferCount
+          output_commands,                         // pCommandBuffers
+          0,                                       // signalSemaphoreCount
+          nullptr                                  // pSignalSemaphores
+      };
+      const VkSubmitInfo submit_infos[2] = {output_submit_info,
+                                            init_submit_info};
+      app()->render_queue()->vkQueueSubmit(
+          app()->render_queue(), 2, submit_infos, ::VkFence(ready_fence));
+    }
 
     if (application_.HasSeparatePresentQueue()) {
       ::VkSemaphore transfer_semaphore =
@@ -555,10 +893,31 @@ class Sample {
       present_info.pNext = &present_time;
     }
 
+    // Every output is presented with the one call, the main one first.
+    ::VkSwapchainKHR swapchains[1 + SampleOptions::kMaxAdditionalOutputs];
+    uint32_t image_indices[1 + SampleOptions::kMaxAdditionalOutputs];
+    if (!outputs_.empty()) {
+      swapchains[0] = app()->swapchain();
+      image_indices[0] = image_idx;
+      for (size_t i = 0; i < outputs_.size(); ++i) {
+        swapchains[i + 1] = outputs_[i]->output->swapchain;
+        image_indices[i + 1] = outputs_[i]->image_index;
+      }
+      present_info.swapchainCount = static_cast<uint32_t>(1 + outputs_.size());
+      present_info.pSwapchains = swapchains;
+      present_info.pImageIndices = image_indices;
+    }
+
     LOG_ASSERT(==, app()->GetLogger(),
                app()->present_queue()->vkQueuePresentKHR(app()->present_queue(),
                                                          &present_info),
                VK_SUCCESS);
+    if (latency_tracker_ && options_.enable_display_timing &&
+        !frame_inputs.empty()) {
+      presented_inputs_.push_back({ptime.presentID, frame_inputs});
+    }
+
+    EndFrame();
   }
 
   void set_invalid(bool invaid) { is_valid_ = false; }
@@ -585,6 +944,14 @@ class Sample {
     return base->image_view->get_raw_object();
   }
 
+  // The swapchain image view to use as the resolve attachment. Only valid if
+  // resolves_in_render_pass() is true.
+  const ::VkImageView& resolve_view(FrameData* data) {
+    SampleFrameData* base = reinterpret_cast<SampleFrameData*>(
+        reinterpret_cast<uint8_t*>(data) - sample_frame_data_offset);
+    return base->resolve_view_->get_raw_object();
+  }
+
   const ::VkImage& swapchain_image(FrameData* data) {
     SampleFrameData* base = reinterpret_cast<SampleFrameData*>(
         reinterpret_cast<uint8_t*>(data) - sample_frame_data_offset);
@@ -615,15 +982,124 @@ class Sample {
   // buffers.
   virtual void InitializationComplete() {}
 
+  // Will be called on the main thread, at the start of every frame, with
+  // each event of the window that arrived since the last one. Samples must
+  // not poll the window events themselves.
+  virtual void HandleWindowEvent(const entry::WindowEvent& event) {}
+
   // Will be called to instruct the application to update it's non
   // frame-specific data.
   virtual void Update(float time_since_last_render) = 0;
 
+  // Will be called on the main thread after an Update has finished, and
+  // before the Render that should show its results. No Update runs at the
+  // same time. Samples that enable pipelined updates publish the state of
+  // that Update to Render here.
+  virtual void PublishUpdate() {}
+
+  void RunUpdate(float time_since_last_render) {
+    containers::ScopedAllocationTag tag(containers::AllocationTag::kSampleData);
+    if (latency_tracker_) {
+      // Anything that arrives from here on is too late for this Update.
+      pending_inputs_ = LatencyTracker::Merge(
+          pending_inputs_,
+          latency_tracker_->TakeInputs(LatencyTracker::Clock::now()));
+    }
+    Update(time_since_last_render);
+  }
+
+  // Records the latency of the inputs of every frame whose work has
+  // finished. Without display timing this is as close to the time of
+  // presentation as can be measured, and it is only noticed once per frame.
+  void CompleteFinishedFrames() {
+    const LatencyTracker::Clock::time_point now = LatencyTracker::Clock::now();
+    for (auto& data : frame_data_) {
+      if (!data.inputs_.empty() &&
+          app()->device()->vkGetFenceStatus(app()->device(),
+                                            *data.ready_fence_) == VK_SUCCESS) {
+        latency_tracker_->Complete(data.inputs_, now);
+        data.inputs_ = {0, 0};
+      }
+    }
+  }
+
+  // Records the latency of the inputs of the frame that |timing| is for.
+  // Frames that the driver reported no timing for are skipped.
+  void CompletePresentedFrame(const VkPastPresentationTimingGOOGLE& timing) {
+    while (!presented_inputs_.empty() &&
+           presented_inputs_.front().present_id <= timing.presentID) {
+      if (presented_inputs_.front().present_id == timing.presentID) {
+        // Presentation times are in nanoseconds of CLOCK_MONOTONIC, which is
+        // what steady_clock uses as well.
+        latency_tracker_->Complete(
+            presented_inputs_.front().inputs,
+            LatencyTracker::Clock::time_point(
+                std::chrono::duration_cast<LatencyTracker::Clock::duration>(
+                    std::chrono::nanoseconds(timing.actualPresentTime))));
+      }
+      presented_inputs_.pop_front();
+    }
+  }
+
+  static const char* PresentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+      case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "IMMEDIATE";
+      case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "MAILBOX";
+      case VK_PRESENT_MODE_FIFO_KHR:
+        return "FIFO";
+      case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "FIFO_RELAXED";
+      case VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR:
+        return "SHARED_DEMAND_REFRESH";
+      case VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR:
+        return "SHARED_CONTINUOUS_REFRESH";
+      default:
+        return "unknown present mode";
+    }
+  }
+
+  // The work at the end of every rendered frame.
+  void EndFrame() {
+    if (options_.verbose_output) {
+      const vulkan::MappedRangeBatcher::Stats stats =
+          app()->mapped_range_batcher()->stats();
+      app()->GetLogger()->LogInfo(
+          "Mapped ranges: <", stats.flush_calls, "> flush calls, <",
+          stats.flushed_ranges, "> ranges, <", stats.flushed_bytes,
+          "> bytes; <", stats.invalidate_calls, "> invalidate calls, <",
+          stats.invalidated_bytes, "> bytes");
+      app()->mapped_range_batcher()->ResetStats();
+    }
+    if (app()->driver_memory_tracker()) {
+      app()->driver_memory_tracker()->EndFrame();
+    }
+    // The next frame, or the sample's teardown, may touch anything that
+    // Update does.
+    if (update_worker_) {
+      update_worker_->Wait();
+    }
+  }
+
   // Will be called to instruct the application to enqueue the necessary
-  // commands for rendering frame <frame_index> into the provided queue
+  // commands for rendering frame <frame_index> into the provided queue.
+  // Mapped ranges deferred here must be flushed, with
+  // app()->mapped_range_batcher()->Flush(), before the work that reads them
+  // is submitted. Those deferred in Update are already flushed.
   virtual void Render(vulkan::VkQueue* queue, size_t frame_index,
                       FrameData* data) = 0;
 
+  // Will be called in every rendered frame for each of the outputs that were
+  // added with SampleOptions::AddOutput, to record the commands that render
+  // to image <image_index> of <output>, whose view is output_view(). The
+  // image is in VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL before and must be
+  // after. This runs on a thread of its own while Render runs for the same
+  // frame, so it must only read the state that they share.
+  virtual void RecordOutput(size_t output, uint32_t image_index,
+                            vulkan::VkCommandBuffer* command_buffer,
+                            FrameData* data) {}
+
   // This initializes the per-frame data for the sample application framework.
   //  This is equivalent to the InitializeFrameData(), except this handles
   //  all of the under-the-hood data that the application itself should not
@@ -631,7 +1107,8 @@ class Sample {
   void InitializeLocalFrameData(SampleFrameData* data,
                                 vulkan::VkCommandBuffer* initialization_buffer,
                                 size_t frame_index) {
-    data->swapchain_image_ = swapchain_images_[frame_index];
+    data->swapchain_image_ =
+        swapchain_images_[front_buffer_bands_ ? 0 : frame_index];
 
     data->ready_semaphore_ = containers::make_unique<vulkan::VkSemaphore>(
         allocator_, vulkan::CreateSemaphore(&application_.device()));
@@ -707,16 +1184,31 @@ class Sample {
     if (options_.enable_multisampling && !options_.enable_mixed_multisampling) {
       image_create_info.format = render_target_format_;
       image_create_info.usage =
-          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+          resolves_in_render_pass()
+              ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT
+              : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
       data->multisampled_target_ =
           application_.CreateAndBindImage(&image_create_info);
     }
 
-    view_create_info.image =
-		(options_.enable_multisampling && !options_.enable_mixed_multisampling)
-                                 ? *data->multisampled_target_
-                                 : data->swapchain_image_;
+    if (resolution_controller_) {
+      image_create_info.format = render_target_format_;
+      image_create_info.usage =
+          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+      data->scaled_target_ =
+          application_.CreateAndBindImage(&image_create_info);
+      data->upscale_command_buffer_ =
+          containers::make_unique<vulkan::VkCommandBuffer>(
+              allocator_, app()->GetCommandBuffer());
+    }
+    data->has_timestamps_ = false;
+    data->inputs_ = {0, 0};
+
+    view_create_info.image = render_target_image(data);
     view_create_info.format = options_.mutable_swapchain_format
                                   ? VK_FORMAT_B8G8R8A8_SRGB
                                   : render_target_format_;
@@ -730,6 +1222,17 @@ class Sample {
         allocator_,
         vulkan::VkImageView(raw_view, nullptr, &application_.device()));
 
+    if (resolves_in_render_pass()) {
+      view_create_info.image = data->swapchain_image_;
+      LOG_ASSERT(
+          ==, data_->logger(), VK_SUCCESS,
+          application_.device()->vkCreateImageView(
+              application_.device(), &view_create_info, nullptr, &raw_view));
+      data->resolve_view_ = containers::make_unique<vulkan::VkImageView>(
+          allocator_,
+          vulkan::VkImageView(raw_view, nullptr, &application_.device()));
+    }
+
     VkImageMemoryBarrier barriers[2] = {
         {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,            // sType
          nullptr,                                           // pNext
@@ -751,17 +1254,22 @@ class Sample {
          VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // newLayout
          VK_QUEUE_FAMILY_IGNORED,                   // srcQueueFamilyIndex
          VK_QUEUE_FAMILY_IGNORED,                   // dstQueueFamilyIndex
-         (options_.enable_multisampling && !options_.enable_mixed_multisampling)
-             ? *data->multisampled_target_
-		     : data->swapchain_image_,  // image
+         render_target_image(data),                 // image
          {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}}};
 
-    (*initialization_buffer)
-        ->vkCmdPipelineBarrier(
-            (*initialization_buffer), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-            VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr,
-            options_.enable_depth_buffer ? 2 : 1,
-            &barriers[options_.enable_depth_buffer ? 0 : 1]);
+    uint32_t num_barriers = options_.enable_depth_buffer ? 2 : 1;
+    if (front_buffer_bands_) {
+      // The shared image is not acquired yet, AcquireFrontBuffer() sets it
+      // up.
+      --num_barriers;
+    }
+    if (num_barriers) {
+      (*initialization_buffer)
+          ->vkCmdPipelineBarrier(
+              (*initialization_buffer), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+              VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr,
+              num_barriers, &barriers[options_.enable_depth_buffer ? 0 : 1]);
+    }
 
     uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
@@ -820,19 +1328,33 @@ class Sample {
           ->vkEndCommandBuffer(*data->setup_command_buffer_);
     }
 
-    VkImageMemoryBarrier barrier = {
-        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,    // sType
-        nullptr,                                   // pNext
-        0,                                         // srcAccessMask
-        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,      // dstAccessMask
-        VK_IMAGE_LAYOUT_UNDEFINED,                 // oldLayout
-        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // newLayout
-        srcQueueFamilyIndex,                       // srcQueueFamilyIndex
-        dstQueueFamilyIndex,                       // dstQueueFamilyIndex
-        (options_.enable_multisampling && !options_.enable_mixed_multisampling)
-            ? *data->multisampled_target_
-		    : data->swapchain_image_,  // image
-        {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+    VkImageMemoryBarrier setup_barriers[2] = {
+        {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,    // sType
+         nullptr,                                   // pNext
+         0,                                         // srcAccessMask
+         VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,      // dstAccessMask
+         VK_IMAGE_LAYOUT_UNDEFINED,                 // oldLayout
+         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // newLayout
+         srcQueueFamilyIndex,                       // srcQueueFamilyIndex
+         dstQueueFamilyIndex,                       // dstQueueFamilyIndex
+         render_target_image(data),                 // image
+         {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}},
+        // The resolve attachment is written by the render pass, so the
+        // swapchain image has to be made ready for it here as well.
+        {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,    // sType
+         nullptr,                                   // pNext
+         0,                                         // srcAccessMask
+         VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,      // dstAccessMask
+         VK_IMAGE_LAYOUT_UNDEFINED,                 // oldLayout
+         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // newLayout
+         srcQueueFamilyIndex,                       // srcQueueFamilyIndex
+         dstQueueFamilyIndex,                       // dstQueueFamilyIndex
+         data->swapchain_image_,                    // image
+         {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}}};
+    if (resolves_in_render_pass() || resolution_controller_) {
+      setup_barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      setup_barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    }
 
     data->setup_command_buffer_ =
         containers::make_unique<vulkan::VkCommandBuffer>(
@@ -841,12 +1363,27 @@ class Sample {
     (*data->setup_command_buffer_)
         ->vkBeginCommandBuffer((*data->setup_command_buffer_),
                                &kBeginCommandBuffer);
+    app()->debug_labels().BeginLabel(data->setup_command_buffer_.get(),
+                                     "Frame setup");
+    if (resolution_controller_) {
+      const uint32_t first_query = static_cast<uint32_t>(2 * frame_index);
+      (*data->setup_command_buffer_)
+          ->vkCmdResetQueryPool((*data->setup_command_buffer_),
+                                *timestamp_pool_, first_query, 2);
+      (*data->setup_command_buffer_)
+          ->vkCmdWriteTimestamp((*data->setup_command_buffer_),
+                                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                *timestamp_pool_, first_query);
+    }
 
     (*data->setup_command_buffer_)
         ->vkCmdPipelineBarrier((*data->setup_command_buffer_),
                                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
                                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
-                               0, nullptr, 0, nullptr, 1, &barrier);
+                               0, nullptr, 0, nullptr,
+                               resolves_in_render_pass() ? 2 : 1,
+                               setup_barriers);
+    app()->debug_labels().EndLabel(data->setup_command_buffer_.get());
     (*data->setup_command_buffer_)
         ->vkEndCommandBuffer(*data->setup_command_buffer_);
 
@@ -857,9 +1394,12 @@ class Sample {
     (*data->resolve_command_buffer_)
         ->vkBeginCommandBuffer((*data->resolve_command_buffer_),
                                &kBeginCommandBuffer);
+    app()->debug_labels().BeginLabel(data->resolve_command_buffer_.get(),
+                                     "Frame resolve");
     VkImageLayout old_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     VkAccessFlags old_access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    if (options_.enable_multisampling && !options_.enable_mixed_multisampling) {
+    if (options_.enable_multisampling && !options_.enable_mixed_multisampling &&
+        !resolves_in_render_pass()) {
       old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
       old_access = VK_ACCESS_TRANSFER_WRITE_BIT;
       VkImageMemoryBarrier resolve_barrier[2] = {
@@ -940,12 +1480,477 @@ class Sample {
                                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
                                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
                                nullptr, 0, nullptr, 1, &present_barrier);
+    app()->debug_labels().EndLabel(data->resolve_command_buffer_.get());
     (*data->resolve_command_buffer_)
         ->vkEndCommandBuffer(*data->resolve_command_buffer_);
 
     InitializeFrameData(&data->child_data_, initialization_buffer, frame_index);
   }
 
+  // The image that the sample renders into through color_view().
+  ::VkImage render_target_image(SampleFrameData* data) const {
+    if (resolution_controller_) {
+      return *data->scaled_target_;
+    }
+    if (options_.enable_multisampling && !options_.enable_mixed_multisampling) {
+      return *data->multisampled_target_;
+    }
+    return data->swapchain_image_;
+  }
+
+  // Turns on dynamic resolution if this device supports it, and creates the
+  // query pool that it measures frames with.
+  void SetupDynamicResolution() {
+    const char* unsupported = nullptr;
+    VkFormatProperties format_properties;
+    app()->instance()->vkGetPhysicalDeviceFormatProperties(
+        app()->device().physical_device(), render_target_format_,
+        &format_properties);
+    auto queue_family_properties = vulkan::GetQueueFamilyProperties(
+        allocator_, app()->instance(), app()->device().physical_device());
+    const uint32_t timestamp_valid_bits =
+        queue_family_properties[app()->render_queue().index()]
+            .timestampValidBits;
+    if (options_.enable_multisampling) {
+      unsupported = "multisampling";
+    } else if (options_.mutable_swapchain_format) {
+      unsupported = "a mutable swapchain format";
+    } else if (application_.HasSeparatePresentQueue()) {
+      unsupported = "a separate present queue";
+    } else if (timestamp_valid_bits == 0) {
+      unsupported = "a render queue without timestamps";
+    } else if (!(format_properties.optimalTilingFeatures &
+                 VK_FORMAT_FEATURE_BLIT_SRC_BIT)) {
+      unsupported = "a render format that cannot be blitted";
+    }
+    if (unsupported) {
+      app()->GetLogger()->LogInfo("Dynamic resolution does not work with ",
+                                  unsupported,
+                                  ", rendering at full resolution");
+      return;
+    }
+
+    timestamp_mask_ = timestamp_valid_bits >= 64
+                          ? ~uint64_t(0)
+                          : (uint64_t(1) << timestamp_valid_bits) - 1;
+    upscale_filter_ = (format_properties.optimalTilingFeatures &
+                       VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+                          ? VK_FILTER_LINEAR
+                          : VK_FILTER_NEAREST;
+    timestamp_pool_ = containers::make_unique<vulkan::VkQueryPool>(
+        allocator_,
+        vulkan::CreateQueryPool(
+            &application_.device(),
+            {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO, nullptr, 0,
+             VK_QUERY_TYPE_TIMESTAMP,
+             static_cast<uint32_t>(2 * swapchain_images_.size()), 0}));
+    resolution_controller_ =
+        containers::make_unique<DynamicResolutionController>(
+            allocator_, options_.dynamic_resolution_target_ms,
+            application_.swapchain().width(),
+            application_.swapchain().height());
+    app()->GetLogger()->LogInfo("Dynamic resolution targets ",
+                                options_.dynamic_resolution_target_ms,
+                                " ms of GPU time per frame");
+  }
+
+  // Gives the GPU time that frame |frame_index| took the last time around to
+  // the controller, and records the upscale for the area to render this
+  // time. The fence of the frame must have been waited for.
+  void UpdateDynamicResolution(uint32_t frame_index) {
+    SampleFrameData& data = frame_data_[frame_index];
+    uint64_t timestamps[2];
+    if (data.has_timestamps_ &&
+        app()->device()->vkGetQueryPoolResults(
+            app()->device(), *timestamp_pool_, 2 * frame_index, 2,
+            sizeof(timestamps), timestamps, sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+      const uint64_t ticks = (timestamps[1] - timestamps[0]) & timestamp_mask_;
+      const float gpu_ms =
+          ticks * app()->physical_device_properties().limits.timestampPeriod /
+          1000000.0f;
+      const VkExtent2D old_extent = default_scissor_.extent;
+      if (resolution_controller_->AddFrameTime(gpu_ms)) {
+        default_scissor_.extent = {resolution_controller_->width(),
+                                   resolution_controller_->height()};
+        default_viewport_.width =
+            static_cast<float>(default_scissor_.extent.width);
+        default_viewport_.height =
+            static_cast<float>(default_scissor_.extent.height);
+        app()->GetLogger()->LogInfo(
+            "Dynamic resolution: frame took ", gpu_ms, " ms on the GPU for a ",
+            resolution_controller_->target_frame_time(), " ms target, ",
+            old_extent.width, "x", old_extent.height, " -> ",
+            default_scissor_.extent.width, "x", default_scissor_.extent.height,
+            " (scale ", resolution_controller_->scale(), ")");
+      }
+    }
+    data.has_timestamps_ = true;
+    RecordUpscale(&data, frame_index);
+  }
+
+  // Records the blit of the area rendered this frame up to the whole
+  // swapchain image, and the timestamp that ends the frame.
+  void RecordUpscale(SampleFrameData* data, size_t frame_index) {
+    vulkan::VkCommandBuffer& command_buffer = *data->upscale_command_buffer_;
+    command_buffer->vkBeginCommandBuffer(command_buffer, &kBeginCommandBuffer);
+    app()->debug_labels().BeginLabel(&command_buffer, "Frame upscale");
+
+    VkImageMemoryBarrier barriers[2] = {
+        {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,    // sType
+         nullptr,                                   // pNext
+         VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,      // srcAccessMask
+         VK_ACCESS_TRANSFER_READ_BIT,               // dstAccessMask
+         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // oldLayout
+         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,      // newLayout
+         VK_QUEUE_FAMILY_IGNORED,                   // srcQueueFamilyIndex
+         VK_QUEUE_FAMILY_IGNORED,                   // dstQueueFamilyIndex
+         *data->scaled_target_,                     // image
+         {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}},
+        {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,  // sType
+         nullptr,                                 // pNext
+         0,                                       // srcAccessMask
+         VK_ACCESS_TRANSFER_WRITE_BIT,            // dstAccessMask
+         VK_IMAGE_LAYOUT_UNDEFINED,               // oldLayout
+         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,    // newLayout
+         VK_QUEUE_FAMILY_IGNORED,                 // srcQueueFamilyIndex
+         VK_QUEUE_FAMILY_IGNORED,                 // dstQueueFamilyIndex
+         data->swapchain_image_,                  // image
+         {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}}};
+    command_buffer->vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+    VkImageBlit region{
+        {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        {{0, 0, 0},
+         {int32_t(default_scissor_.extent.width),
+          int32_t(default_scissor_.extent.height), 1}},
+        {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        {{0, 0, 0},
+         {int32_t(app()->swapchain().width()),
+          int32_t(app()->swapchain().height()), 1}},
+    };
+    command_buffer->vkCmdBlitImage(
+        command_buffer, *data->scaled_target_,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, data->swapchain_image_,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, upscale_filter_);
+
+    VkImageMemoryBarrier present_barrier = {
+        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,  // sType
+        nullptr,                                 // pNext
+        VK_ACCESS_TRANSFER_WRITE_BIT,            // srcAccessMask
+        VK_ACCESS_MEMORY_READ_BIT,               // dstAccessMask
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,    // oldLayout
+        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,         // newLayout
+        VK_QUEUE_FAMILY_IGNORED,                 // srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED,                 // dstQueueFamilyIndex
+        data->swapchain_image_,                  // image
+        {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+    command_buffer->vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1,
+        &present_barrier);
+    command_buffer->vkCmdWriteTimestamp(
+        command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, *timestamp_pool_,
+        static_cast<uint32_t>(2 * frame_index + 1));
+
+    app()->debug_labels().EndLabel(&command_buffer);
+    command_buffer->vkEndCommandBuffer(command_buffer);
+  }
+
+  // Turns on front buffer rendering if it works with the other options and
+  // the swapchain really is shared.
+  void SetupFrontBufferRendering() {
+    const char* unsupported = nullptr;
+    if (application_.swapchain().present_mode() !=
+            VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR ||
+        swapchain_images_.size() != 1) {
+      unsupported = "a swapchain that is not shared";
+    } else if (options_.enable_multisampling) {
+      unsupported = "multisampling";
+    } else if (resolution_controller_) {
+      unsupported = "dynamic resolution";
+    } else if (options_.enable_display_timing) {
+      unsupported = "display timing";
+    } else if (application_.HasSeparatePresentQueue()) {
+      unsupported = "a separate present queue";
+    } else if (data_->output_frame_index() >= 0) {
+      unsupported = "a frame to write out";
+    }
+    if (unsupported) {
+      app()->GetLogger()->LogInfo("Front buffer rendering does not work with ",
+                                  unsupported, ", presenting every frame");
+      return;
+    }
+    front_buffer_bands_ = std::max(
+        1u, std::min(options_.front_buffer_bands,
+                     application_.swapchain().height()));
+    app()->GetLogger()->LogInfo("Rendering to the front buffer in ",
+                                front_buffer_bands_, " bands");
+  }
+
+  // The rows of the image that band |band| covers.
+  VkRect2D FrontBufferBand(uint32_t band) const {
+    const uint32_t height = application_.swapchain().height();
+    const uint32_t top = height * band / front_buffer_bands_;
+    const uint32_t bottom = height * (band + 1) / front_buffer_bands_;
+    return {{0, static_cast<int32_t>(top)},
+            {application_.swapchain().width(), bottom - top}};
+  }
+
+  // Acquires the shared image, clears it, and presents it once. After that
+  // the display keeps showing whatever is in the image, so it is never
+  // acquired or presented again.
+  void AcquireFrontBuffer() {
+    vulkan::VkSemaphore acquired = vulkan::CreateSemaphore(&app()->device());
+    vulkan::VkSemaphore cleared = vulkan::CreateSemaphore(&app()->device());
+    uint32_t image_idx;
+    LOG_ASSERT(==, app()->GetLogger(), VK_SUCCESS,
+               app()->device()->vkAcquireNextImageKHR(
+                   app()->device(), app()->swapchain(), 0xFFFFFFFFFFFFFFFF,
+                   acquired.get_raw_object(),
+                   static_cast<::VkFence>(VK_NULL_HANDLE), &image_idx));
+
+    vulkan::VkCommandBuffer command_buffer = app()->GetCommandBuffer();
+    command_buffer->vkBeginCommandBuffer(command_buffer, &kBeginCommandBuffer);
+    const VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0,
+                                           1};
+    VkImageMemoryBarrier barrier = {
+        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,  // sType
+        nullptr,                                 // pNext
+        0,                                       // srcAccessMask
+        VK_ACCESS_TRANSFER_WRITE_BIT,            // dstAccessMask
+        VK_IMAGE_LAYOUT_UNDEFINED,               // oldLayout
+        VK_IMAGE_LAYOUT_SHARED_PRESENT_KHR,      // newLayout
+        VK_QUEUE_FAMILY_IGNORED,                 // srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED,                 // dstQueueFamilyIndex
+        swapchain_images_[image_idx],            // image
+        range};
+    command_buffer->vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    VkClearColorValue black;
+    vulkan::MemoryClear(&black);
+    command_buffer->vkCmdClearColorImage(command_buffer,
+                                         swapchain_images_[image_idx],
+                                         VK_IMAGE_LAYOUT_SHARED_PRESENT_KHR,
+                                         &black, 1, &range);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_SHARED_PRESENT_KHR;
+    command_buffer->vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0,
+        nullptr, 1, &barrier);
+    command_buffer->vkEndCommandBuffer(command_buffer);
+
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkSubmitInfo submit_info = kEmptySubmitInfo;
+    submit_info.waitSemaphoreCount = 1;
+    submit_info.pWaitSemaphores = &acquired.get_raw_object();
+    submit_info.pWaitDstStageMask = &wait_stage;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer.get_command_buffer();
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &cleared.get_raw_object();
+    app()->render_queue()->vkQueueSubmit(app()->render_queue(), 1,
+                                         &submit_info,
+                                         static_cast<::VkFence>(VK_NULL_HANDLE));
+
+    VkPresentInfoKHR present_info{
+        VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,    // sType
+        nullptr,                               // pNext
+        1,                                     // waitSemaphoreCount
+        &cleared.get_raw_object(),             // pWaitSemaphores
+        1,                                     // swapchainCount
+        &app()->swapchain().get_raw_object(),  // pSwapchains
+        &image_idx,                            // pImageIndices
+        nullptr,                               // pResults
+    };
+    LOG_ASSERT(==, app()->GetLogger(), VK_SUCCESS,
+               app()->present_queue()->vkQueuePresentKHR(
+                   app()->present_queue(), &present_info));
+    app()->render_queue()->vkQueueWaitIdle(app()->render_queue());
+  }
+
+  // Renders one frame into the shared image, a band at a time. Each band
+  // only waits for the same band of the frame before, and nothing is
+  // presented, the display picks up every band as soon as it is written.
+  void RenderFrontBuffer(const LatencyTracker::Inputs& frame_inputs) {
+    for (uint32_t band = 0; band < front_buffer_bands_; ++band) {
+      SampleFrameData& data = frame_data_[band];
+      ::VkFence ready_fence = *data.ready_fence_;
+      LOG_DEBUG_ASSERT(
+          ==, app()->GetLogger(), VK_SUCCESS,
+          app()->device()->vkWaitForFences(app()->device(), 1, &ready_fence,
+                                           VK_FALSE, 0xFFFFFFFFFFFFFFFF));
+      if (latency_tracker_ && band + 1 == front_buffer_bands_) {
+        // The inputs are only shown once the last band is written.
+        CompleteFinishedFrames();
+        data.inputs_ = frame_inputs;
+      }
+      LOG_DEBUG_ASSERT(
+          ==, app()->GetLogger(), VK_SUCCESS,
+          app()->device()->vkResetFences(app()->device(), 1, &ready_fence));
+
+      default_scissor_ = FrontBufferBand(band);
+      {
+        vulkan::ScopedDebugLabel<vulkan::VkQueue> label(
+            app()->debug_labels(), &app()->render_queue(), "Render band");
+        Render(&app()->render_queue(), band, &data.child_data_);
+      }
+      // Has no work of its own, it only signals once the band is done.
+      app()->render_queue()->vkQueueSubmit(app()->render_queue(), 0, nullptr,
+                                           ready_fence);
+    }
+    default_scissor_ = {
+        {0, 0},
+        {application_.swapchain().width(), application_.swapchain().height()}};
+  }
+
+  // Creates the outputs that were asked for besides the main one, along with
+  // what it takes to record their commands on threads of their own.
+  void SetupAdditionalOutputs() {
+    const char* unsupported = nullptr;
+    if (front_buffer_bands_) {
+      unsupported = "front buffer rendering";
+    } else if (options_.enable_display_timing) {
+      unsupported = "display timing";
+    } else if (options_.protected_memory) {
+      unsupported = "protected memory";
+    } else if (application_.HasSeparatePresentQueue()) {
+      unsupported = "a separate present queue";
+    }
+    if (unsupported) {
+      app()->GetLogger()->LogInfo("Additional outputs do not work with ",
+                                  unsupported, ", rendering to one window");
+      return;
+    }
+    for (size_t i = 0; i < options_.num_additional_outputs; ++i) {
+      const VkExtent2D& extent = options_.additional_output_extents[i];
+      vulkan::VulkanApplication::Output* output =
+          application_.AddOutput(extent.width, extent.height);
+      if (!output) {
+        app()->GetLogger()->LogInfo("Leaving out the output of size ",
+                                    extent.width, "x", extent.height);
+        continue;
+      }
+      outputs_.push_back(containers::make_unique<AdditionalOutput>(
+          allocator_, allocator_, output,
+          vulkan::CreateDefaultCommandPool(
+              allocator_, application_.device(), false,
+              application_.render_queue().index())));
+      AdditionalOutput* data = outputs_.back().get();
+
+      VkImageViewCreateInfo view_create_info = {
+          VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,  // sType
+          nullptr,                                   // pNext
+          0,                                         // flags
+          VK_NULL_HANDLE,                            // image
+          VK_IMAGE_VIEW_TYPE_2D,                     // viewType
+          output->swapchain.format(),                // format
+          {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G,
+           VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A},
+          {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+      for (::VkImage image : output->swapchain_images) {
+        view_create_info.image = image;
+        ::VkImageView raw_view;
+        LOG_ASSERT(==, data_->logger(), VK_SUCCESS,
+                   application_.device()->vkCreateImageView(
+                       application_.device(), &view_create_info, nullptr,
+                       &raw_view));
+        data->views.push_back(containers::make_unique<vulkan::VkImageView>(
+            allocator_,
+            vulkan::VkImageView(raw_view, nullptr, &application_.device())));
+      }
+      for (size_t j = 0; j < swapchain_images_.size(); ++j) {
+        data->command_buffers.push_back(
+            containers::make_unique<vulkan::VkCommandBuffer>(
+                allocator_, vulkan::CreateDefaultCommandBuffer(
+                                &data->command_pool, &application_.device())));
+        data->acquired_semaphores.push_back(
+            containers::make_unique<vulkan::VkSemaphore>(
+                allocator_, vulkan::CreateSemaphore(&application_.device())));
+      }
+    }
+    if (!outputs_.empty()) {
+      app()->GetLogger()->LogInfo("Rendering to ", outputs_.size() + 1,
+                                  " windows");
+    }
+  }
+
+  // Acquires the image of every additional output that frame <frame_index>
+  // renders to, and starts recording the commands for it.
+  void StartRecordingOutputs(uint32_t frame_index) {
+    for (size_t i = 0; i < outputs_.size(); ++i) {
+      AdditionalOutput* output = outputs_[i].get();
+      LOG_ASSERT(==, app()->GetLogger(), VK_SUCCESS,
+                 app()->device()->vkAcquireNextImageKHR(
+                     app()->device(), output->output->swapchain,
+                     0xFFFFFFFFFFFFFFFF,
+                     *output->acquired_semaphores[frame_index],
+                     static_cast<::VkFence>(VK_NULL_HANDLE),
+                     &output->image_index));
+      output->worker->Start(
+          [this, i, frame_index]() { RecordAdditionalOutput(i, frame_index); });
+    }
+  }
+
+  // Runs on the worker of the output.
+  void RecordAdditionalOutput(size_t index, uint32_t frame_index) {
+    containers::ScopedAllocationTag tag(containers::AllocationTag::kSampleData);
+    AdditionalOutput* output = outputs_[index].get();
+    vulkan::VkCommandBuffer& command_buffer =
+        *output->command_buffers[frame_index];
+    command_buffer->vkBeginCommandBuffer(command_buffer, &kBeginCommandBuffer);
+
+    VkImageMemoryBarrier barrier = {
+        VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,    // sType
+        nullptr,                                   // pNext
+        0,                                         // srcAccessMask
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,      // dstAccessMask
+        VK_IMAGE_LAYOUT_UNDEFINED,                 // oldLayout
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  // newLayout
+        VK_QUEUE_FAMILY_IGNORED,                   // srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED,                   // dstQueueFamilyIndex
+        output->output->swapchain_images[output->image_index],  // image
+        {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+    command_buffer->vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0,
+        nullptr, 1, &barrier);
+
+    RecordOutput(index, output->image_index, &command_buffer,
+                 &frame_data_[frame_index].child_data_);
+
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    command_buffer->vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1,
+        &barrier);
+    command_buffer->vkEndCommandBuffer(command_buffer);
+  }
+
+  // Waits for the commands of every additional output to be recorded, and
+  // fills in what it takes to submit them.
+  void FinishRecordingOutputs(uint32_t frame_index,
+                              ::VkSemaphore* wait_semaphores,
+                              VkPipelineStageFlags* wait_stages,
+                              ::VkCommandBuffer* command_buffers) {
+    for (size_t i = 0; i < outputs_.size(); ++i) {
+      outputs_[i]->worker->Wait();
+      wait_semaphores[i] = *outputs_[i]->acquired_semaphores[frame_index];
+      wait_stages[i] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+      command_buffers[i] =
+          outputs_[i]->command_buffers[frame_index]->get_command_buffer();
+    }
+  }
+
   SampleOptions options_;
   const entry::EntryData* data_;
   containers::Allocator* allocator_;
@@ -981,6 +1986,66 @@ class Sample {
   float average_frame_time_;
   // If this is set to false, the application cannot be safely run.
   bool is_valid_;
+  // Runs the Update of the next frame, only set with pipelined updates.
+  containers::unique_ptr<UpdateWorker> update_worker_;
+  // True until the first Update has run.
+  bool first_update_;
+  // True if the next frame should be rendered when rendering on demand.
+  bool render_requested_;
+  // Measures input to present latency, only set with -measure-latency.
+  containers::unique_ptr<LatencyTracker> latency_tracker_;
+  // The inputs that Updates have taken, and that no rendered frame has
+  // shown yet.
+  LatencyTracker::Inputs pending_inputs_;
+  // A frame that was presented with display timing, and the inputs it
+  // shows.
+  struct PresentedInputs {
+    uint32_t present_id;
+    LatencyTracker::Inputs inputs;
+  };
+  // Those frames that have no presentation timing yet, oldest first.
+  containers::deque<PresentedInputs> presented_inputs_;
+  // The number of bands that a frame is rendered to the front buffer in,
+  // 0 when going through the swapchain.
+  uint32_t front_buffer_bands_;
+  // An output besides the main one, and what it takes to render to it.
+  struct AdditionalOutput {
+    AdditionalOutput(containers::Allocator* allocator,
+                     vulkan::VulkanApplication::Output* output,
+                     vulkan::VkCommandPool&& command_pool)
+        : output(output),
+          views(allocator),
+          command_pool(std::move(command_pool)),
+          command_buffers(allocator),
+          acquired_semaphores(allocator),
+          worker(containers::make_unique<UpdateWorker>(allocator)),
+          image_index(0) {}
+    vulkan::VulkanApplication::Output* output;
+    // A view of each of its swapchain images.
+    containers::vector<containers::unique_ptr<vulkan::VkImageView>> views;
+    // Its commands are recorded on a thread of their own, so they need a
+    // pool of their own.
+    vulkan::VkCommandPool command_pool;
+    // Like the frame data, these go by frame_index.
+    containers::vector<containers::unique_ptr<vulkan::VkCommandBuffer>>
+        command_buffers;
+    containers::vector<containers::unique_ptr<vulkan::VkSemaphore>>
+        acquired_semaphores;
+    // Records its commands.
+    containers::unique_ptr<UpdateWorker> worker;
+    // The swapchain image that the current frame renders to.
+    uint32_t image_index;
+  };
+  // Only set when outputs were added with SampleOptions::AddOutput.
+  containers::vector<containers::unique_ptr<AdditionalOutput>> outputs_;
+  // Picks the size to render at, only set with dynamic resolution.
+  containers::unique_ptr<DynamicResolutionController> resolution_controller_;
+  // Two timestamps per frame, around all of its work on the render queue.
+  containers::unique_ptr<vulkan::VkQueryPool> timestamp_pool_;
+  // The bits of those timestamps that are valid.
+  uint64_t timestamp_mask_;
+  // The filter that the rendered area is scaled up with.
+  VkFilter upscale_filter_;
 };  // namespace sample_application
 }  // namespace sample_application
 
@@ -16,6 +16,7 @@
 #include "support/entry/entry.h"
 #include "vulkan_helpers/buffer_frame_data.h"
 #include "vulkan_helpers/helper_functions.h"
+#include "vulkan_helpers/shader_layout.h"
 #include "vulkan_helpers/vulkan_application.h"
 #include "vulkan_helpers/vulkan_model.h"
 
@@ -168,8 +169,9 @@ class CubeSample : public sample_application::Sample<CubeFrameData> {
 
     model_data_->data().transform = Mat44::FromTranslationVector(
         mathfu::Vector<float, 3>{0.0f, 0.0f, -3.0f});
-    color_data_->data().color1 = Vector3(1.0, 1.0, 0.0);
-    color_data_->data().color2 = Vector3(1.0, 1.0, 1.0);
+    color1_ = Vector3(1.0, 1.0, 0.0);
+    color_data_->data().set<0>(color1_);
+    color_data_->data().set<1>(Vector3(1.0, 1.0, 1.0));
   }
 
   virtual void InitializeFrameData(
@@ -283,7 +285,8 @@ class CubeSample : public sample_application::Sample<CubeFrameData> {
 	if (zero_to_one_timer >= 1.0f) {
       zero_to_one_timer = 0.0f;
 	}
-    color_data_->data().color1.z = zero_to_one_timer;
+    color1_.z = zero_to_one_timer;
+    color_data_->data().set<0>(color1_);
     model_data_->data().transform =
         model_data_->data().transform *
         Mat44::FromRotationMatrix(
@@ -323,10 +326,11 @@ class CubeSample : public sample_application::Sample<CubeFrameData> {
     Mat44 transform;
   };
 
-  struct ColorData {
-    Vector3 color1;
-    Vector3 color2;
-  };
+  // color_data in the vertex shader.
+  using ColorData = vulkan::ShaderBlock<vulkan::BlockLayout::kScalar,
+                                        vulkan::shader_types::vec3,
+                                        vulkan::shader_types::vec3>;
+  static_assert(ColorData::offset<1>() == 12, "color2 directly follows color1");
 
   const entry::EntryData* data_;
   containers::unique_ptr<vulkan::PipelineLayout> pipeline_layout_;
@@ -338,6 +342,7 @@ class CubeSample : public sample_application::Sample<CubeFrameData> {
   containers::unique_ptr<vulkan::BufferFrameData<CameraData>> camera_data_;
   containers::unique_ptr<vulkan::BufferFrameData<ModelData>> model_data_;
   containers::unique_ptr<vulkan::BufferFrameData<ColorData>> color_data_;
+  Vector3 color1_;
 };
 
 int main_entry(const entry::EntryData* data) {
@@ -118,8 +118,8 @@ int main_entry(const entry::EntryData* data) {
                    &cmd_buf, &app.render_queue()));
 
     // Check the output values
-    containers::vector<uint32_t> output = vulkan::GetHostVisibleBufferData(
-        data->allocator(), &*storage_buffers[kOutputBuffer]);
+    vulkan::MappedSpan<uint32_t> output =
+        vulkan::GetHostVisibleBufferView(&*storage_buffers[kOutputBuffer]);
     std::ostringstream str;
     str << "Output:";
     for (auto& v : output) {
@@ -98,10 +98,8 @@ class TexturedCubeSample
         nullptr                            // pImmutableSamplers
     };
 
-    sampler_ = containers::make_unique<vulkan::VkSampler>(
-        data_->allocator(),
-        vulkan::CreateSampler(&app()->device(), VK_FILTER_LINEAR,
-                              VK_FILTER_LINEAR));
+    sampler_ = app()->GetCachedSampler(
+        vulkan::GetSamplerCreateInfo(VK_FILTER_LINEAR, VK_FILTER_LINEAR));
 
     pipeline_layout_ = containers::make_unique<vulkan::PipelineLayout>(
         data_->allocator(),
@@ -209,7 +207,7 @@ class TexturedCubeSample
         }};
 
     VkDescriptorImageInfo sampler_info = {
-        *sampler_,                 // sampler
+        sampler_,                  // sampler
         VK_NULL_HANDLE,            // imageView
         VK_IMAGE_LAYOUT_UNDEFINED  //  imageLayout
     };
@@ -365,7 +363,7 @@ class TexturedCubeSample
   VkDescriptorSetLayoutBinding cube_descriptor_set_layouts_[4];
   vulkan::VulkanModel cube_;
   vulkan::VulkanTexture texture_;
-  containers::unique_ptr<vulkan::VkSampler> sampler_;
+  vulkan::CachedSampler sampler_;
 
   containers::unique_ptr<vulkan::BufferFrameData<CameraData>> camera_data_;
   containers::unique_ptr<vulkan::BufferFrameData<ModelData>> model_data_;
@@ -129,8 +129,8 @@ int main_entry(const entry::EntryData* data) {
                    &cmd_buf, &app.render_queue()));
 
     // Check the output values
-    containers::vector<uint32_t> output =
-        vulkan::GetHostVisibleBufferData(data->allocator(), &*out_buffer);
+    vulkan::MappedSpan<uint32_t> output =
+        vulkan::GetHostVisibleBufferView(&*out_buffer);
     std::for_each(output.begin(), output.end(),
                   [data](uint32_t w) { LOG_EXPECT(==, data->logger(), 2, w); });
   }
@@ -181,8 +181,8 @@ int main_entry(const entry::EntryData* data) {
                    &cmd_buf, &app.render_queue()));
 
     // Check the output values
-    containers::vector<uint32_t> output =
-        vulkan::GetHostVisibleBufferData(data->allocator(), &*out_buffer);
+    vulkan::MappedSpan<uint32_t> output =
+        vulkan::GetHostVisibleBufferView(&*out_buffer);
     std::for_each(output.begin(), output.end(),
                   [data](uint32_t w) { LOG_EXPECT(==, data->logger(), 2, w); });
   }
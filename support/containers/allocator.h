@@ -18,15 +18,37 @@
 
 #include <assert.h>
 #include <atomic>
+#include <cstdint>
 #include <cstdlib>
 #include <map>
 #include <utility>
 
 namespace containers {
+// The subsystems that host memory can be charged to. Tags that come after a
+// tag with a parent are grouped under that parent in memory reports; see
+// tagged_allocator.h.
+enum class AllocationTag : uint32_t {
+  // Everything that is not claimed by a more specific subsystem.
+  kContainers,
+  kLogging,
+  kVulkan,
+  kArenaMetadata,
+  kPipelines,
+  kDescriptors,
+  kDriverMemory,
+  kSampleData,
+  kCount
+};
+
 struct Allocator {
   virtual void* malloc(size_t val) = 0;
   virtual void free(void* val, size_t size) = 0;
 
+  // Returns an allocator that charges everything it allocates to |tag|, and
+  // that can free memory allocated by this one. Allocators that do not
+  // track tags simply return themselves.
+  virtual Allocator* WithTag(AllocationTag tag) { return this; }
+
   // Constructs one T from this allocator, while passing
   // down args to the constructor. The memory is allocated
   // from this allocator.
@@ -0,0 +1,156 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SUPPORT_CONTAINERS_HUGE_PAGE_ALLOCATOR_H_
+#define SUPPORT_CONTAINERS_HUGE_PAGE_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "support/containers/allocator.h"
+#include "support/containers/unordered_set.h"
+
+#if defined __linux__
+#include <sys/mman.h>
+#endif
+
+namespace containers {
+
+// HugePageAllocator serves allocations of at least |min_size| bytes from
+// their own mappings backed by huge pages, so that walking large arrays
+// does not thrash the TLB with 4 KiB pages. Smaller allocations are passed
+// on to the root allocator.
+// Explicit huge pages (MAP_HUGETLB) are used when the system has reserved
+// some; otherwise the mapping is aligned to a huge page and the kernel is
+// asked to back it with transparent huge pages (MADV_HUGEPAGE). On
+// platforms without either, everything goes to the root allocator. So does
+// a large allocation that cannot be mapped; those are remembered, so that
+// free knows which allocator they came from.
+// Memory in huge page mappings is not seen by the root allocator, so it is
+// counted separately here.
+class HugePageAllocator : public Allocator {
+ public:
+  // The huge page size of x86-64 and arm64 Linux.
+  static const size_t kHugePageSize = 2 * 1024 * 1024;
+
+  explicit HugePageAllocator(Allocator* root, size_t min_size = kHugePageSize)
+      : root_(root), min_size_(min_size), unmapped_blocks_(root) {
+    currently_allocated_bytes_.store(0);
+    explicit_huge_page_allocations_.store(0);
+    transparent_huge_page_allocations_.store(0);
+  }
+  HugePageAllocator(const HugePageAllocator&) = delete;
+  HugePageAllocator& operator=(const HugePageAllocator&) = delete;
+
+  void* malloc(size_t val) override {
+#if defined __linux__
+    if (val >= min_size_) {
+      void* memory = MapHugePages(RoundUp(val));
+      if (memory) {
+        currently_allocated_bytes_ += val;
+        return memory;
+      }
+      memory = root_->malloc(val);
+      if (memory) {
+        std::lock_guard<std::mutex> lock(unmapped_blocks_mutex_);
+        unmapped_blocks_.insert(memory);
+      }
+      return memory;
+    }
+#endif
+    return root_->malloc(val);
+  }
+
+  void free(void* val, size_t bytes) override {
+#if defined __linux__
+    if (bytes >= min_size_) {
+      if (!val) {
+        // A failed allocation; only root_ can have returned it.
+        root_->free(val, bytes);
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(unmapped_blocks_mutex_);
+        if (unmapped_blocks_.erase(val) != 0) {
+          root_->free(val, bytes);
+          return;
+        }
+      }
+      munmap(val, RoundUp(bytes));
+      currently_allocated_bytes_ -= bytes;
+      return;
+    }
+#endif
+    root_->free(val, bytes);
+  }
+
+  // Bytes that are currently allocated in huge page mappings.
+  std::atomic<size_t> currently_allocated_bytes_;
+  std::atomic<uint64_t> explicit_huge_page_allocations_;
+  std::atomic<uint64_t> transparent_huge_page_allocations_;
+
+ private:
+  static size_t RoundUp(size_t val) {
+    return (val + kHugePageSize - 1) & ~(kHugePageSize - 1);
+  }
+
+#if defined __linux__
+  // Returns |size| bytes of memory aligned to kHugePageSize, or nullptr.
+  void* MapHugePages(size_t size) {
+#if defined MAP_HUGETLB
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+      explicit_huge_page_allocations_ += 1;
+      return memory;
+    }
+#endif
+    // No huge pages are reserved, so map an extra page worth, and trim the
+    // mapping down to an aligned |size| bytes. Only aligned ranges can be
+    // backed by transparent huge pages.
+    char* mapping =
+        static_cast<char*>(mmap(nullptr, size + kHugePageSize,
+                                PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (mapping == MAP_FAILED) {
+      return nullptr;
+    }
+    char* aligned = reinterpret_cast<char*>(RoundUp(
+        reinterpret_cast<uintptr_t>(mapping)));
+    if (aligned != mapping) {
+      munmap(mapping, aligned - mapping);
+    }
+    munmap(aligned + size, mapping + kHugePageSize - aligned);
+#if defined MADV_HUGEPAGE
+    if (madvise(aligned, size, MADV_HUGEPAGE) == 0) {
+      transparent_huge_page_allocations_ += 1;
+    }
+#endif
+    return aligned;
+  }
+#endif
+
+  Allocator* root_;
+  size_t min_size_;
+  // The large allocations that went to root_ because they could not be
+  // mapped.
+  std::mutex unmapped_blocks_mutex_;
+  unordered_set<void*> unmapped_blocks_;
+};
+
+}  // namespace containers
+
+#endif  // SUPPORT_CONTAINERS_HUGE_PAGE_ALLOCATOR_H_
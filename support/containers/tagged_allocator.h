@@ -0,0 +1,200 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SUPPORT_CONTAINERS_TAGGED_ALLOCATOR_H_
+#define SUPPORT_CONTAINERS_TAGGED_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "support/containers/allocator.h"
+
+namespace containers {
+
+struct AllocationTagInfo {
+  const char* name;
+  // The tag this one is reported under, or AllocationTag::kCount for the
+  // top level.
+  AllocationTag parent;
+};
+
+inline const AllocationTagInfo& GetAllocationTagInfo(AllocationTag tag) {
+  static const AllocationTagInfo kInfo[] = {
+      {"Containers", AllocationTag::kCount},
+      {"Logging", AllocationTag::kCount},
+      {"Vulkan", AllocationTag::kCount},
+      {"Arena metadata", AllocationTag::kVulkan},
+      {"Pipelines", AllocationTag::kVulkan},
+      {"Descriptors", AllocationTag::kVulkan},
+      {"Driver memory", AllocationTag::kVulkan},
+      {"Sample data", AllocationTag::kCount},
+  };
+  static_assert(sizeof(kInfo) / sizeof(kInfo[0]) ==
+                    static_cast<size_t>(AllocationTag::kCount),
+                "Every allocation tag needs a name");
+  return kInfo[static_cast<size_t>(tag)];
+}
+
+// Returns the tag of the calling thread. A TaggedAllocator charges anything
+// that is not allocated through WithTag to this tag.
+inline AllocationTag& CurrentAllocationTag() {
+  static thread_local AllocationTag tag = AllocationTag::kContainers;
+  return tag;
+}
+
+// Makes |tag| the tag of the calling thread until this goes out of scope.
+// These nest, so together they form a per-thread stack of tags.
+class ScopedAllocationTag {
+ public:
+  explicit ScopedAllocationTag(AllocationTag tag)
+      : previous_(CurrentAllocationTag()) {
+    CurrentAllocationTag() = tag;
+  }
+  ~ScopedAllocationTag() { CurrentAllocationTag() = previous_; }
+  ScopedAllocationTag(const ScopedAllocationTag&) = delete;
+  ScopedAllocationTag& operator=(const ScopedAllocationTag&) = delete;
+
+ private:
+  AllocationTag previous_;
+};
+
+// TaggedAllocator passes every allocation on to another allocator, and
+// charges it to an AllocationTag: either the one it was explicitly
+// allocated with through WithTag, or else the current tag of the allocating
+// thread. Each tag's counters include those of the tags grouped under it.
+// Every allocation is preceded by a 16 byte header that records its tag,
+// so memory is always returned to the tag that it was charged to, no
+// matter which thread frees it or through which allocator.
+// When queried the values are not guaranteed be in sync with each other,
+// although each may be correct.
+class TaggedAllocator : public Allocator {
+ public:
+  struct Counters {
+    size_t current_bytes;
+    size_t peak_bytes;
+    uint64_t total_bytes;
+    uint64_t allocations;
+  };
+
+  explicit TaggedAllocator(Allocator* root) : root_(root) {
+    for (size_t i = 0; i < kNumTags; ++i) {
+      views_[i].owner_ = this;
+      views_[i].tag_ = static_cast<AllocationTag>(i);
+      current_bytes_[i].store(0);
+      peak_bytes_[i].store(0);
+      total_bytes_[i].store(0);
+      allocations_[i].store(0);
+    }
+  }
+  TaggedAllocator(const TaggedAllocator&) = delete;
+  TaggedAllocator& operator=(const TaggedAllocator&) = delete;
+
+  void* malloc(size_t val) override {
+    return Allocate(val, CurrentAllocationTag());
+  }
+
+  void free(void* val, size_t bytes) override {
+    char* header = static_cast<char*>(val) - kHeaderSize;
+    Charge(*reinterpret_cast<AllocationTag*>(header), bytes, false);
+    root_->free(header, bytes + kHeaderSize);
+  }
+
+  Allocator* WithTag(AllocationTag tag) override {
+    return &views_[static_cast<size_t>(tag)];
+  }
+
+  Counters counters(AllocationTag tag) const {
+    const size_t i = static_cast<size_t>(tag);
+    return {current_bytes_[i].load(), peak_bytes_[i].load(),
+            total_bytes_[i].load(), allocations_[i].load()};
+  }
+
+  // Logs the counters of every tag that has allocated memory, with grouped
+  // tags indented under their parent. Logger can be anything with a
+  // LogInfo(...) like logging::Logger.
+  template <typename Logger>
+  void LogReport(Logger* log) const {
+    log->LogInfo("Host memory by subsystem:");
+    for (size_t i = 0; i < kNumTags; ++i) {
+      const AllocationTag tag = static_cast<AllocationTag>(i);
+      const Counters c = counters(tag);
+      if (c.allocations == 0) {
+        continue;
+      }
+      const char* indent = "  ";
+      if (GetAllocationTagInfo(tag).parent != AllocationTag::kCount) {
+        indent = "    ";
+      }
+      log->LogInfo(indent, GetAllocationTagInfo(tag).name, ": current ",
+                   c.current_bytes, " bytes, peak ", c.peak_bytes,
+                   " bytes, total ", c.total_bytes, " bytes in ",
+                   c.allocations, " allocations");
+    }
+  }
+
+ private:
+  static const size_t kNumTags = static_cast<size_t>(AllocationTag::kCount);
+  // Keeps the memory handed out aligned to 16 bytes, see
+  // Allocator::construct.
+  static const size_t kHeaderSize = 16;
+
+  struct View : public Allocator {
+    void* malloc(size_t val) override { return owner_->Allocate(val, tag_); }
+    void free(void* val, size_t bytes) override { owner_->free(val, bytes); }
+    Allocator* WithTag(AllocationTag tag) override {
+      return owner_->WithTag(tag);
+    }
+
+    TaggedAllocator* owner_;
+    AllocationTag tag_;
+  };
+
+  void* Allocate(size_t val, AllocationTag tag) {
+    char* header = static_cast<char*>(root_->malloc(val + kHeaderSize));
+    *reinterpret_cast<AllocationTag*>(header) = tag;
+    Charge(tag, val, true);
+    return header + kHeaderSize;
+  }
+
+  // Charges |bytes| to |tag| and to every tag it is grouped under.
+  void Charge(AllocationTag tag, size_t bytes, bool allocate) {
+    for (; tag != AllocationTag::kCount;
+         tag = GetAllocationTagInfo(tag).parent) {
+      const size_t i = static_cast<size_t>(tag);
+      if (!allocate) {
+        current_bytes_[i] -= bytes;
+        continue;
+      }
+      const size_t current = current_bytes_[i] += bytes;
+      size_t peak = peak_bytes_[i].load();
+      while (current > peak &&
+             !peak_bytes_[i].compare_exchange_weak(peak, current)) {
+      }
+      total_bytes_[i] += bytes;
+      allocations_[i] += 1;
+    }
+  }
+
+  Allocator* root_;
+  View views_[kNumTags];
+  std::atomic<size_t> current_bytes_[kNumTags];
+  std::atomic<size_t> peak_bytes_[kNumTags];
+  std::atomic<uint64_t> total_bytes_[kNumTags];
+  std::atomic<uint64_t> allocations_[kNumTags];
+};
+
+}  // namespace containers
+
+#endif  // SUPPORT_CONTAINERS_TAGGED_ALLOCATOR_H_
@@ -23,6 +23,8 @@
 #include <mutex>
 #include <thread>
 
+#include "support/containers/huge_page_allocator.h"
+#include "support/containers/tagged_allocator.h"
 #include "support/entry/entry_config.h"
 #include "support/log/log.h"
 
@@ -50,7 +52,9 @@ EntryData::EntryData(containers::Allocator* allocator, uint32_t width,
                      bool separate_present, int64_t output_frame_index,
                      const char* output_frame_file, const char* shader_compiler,
                      bool validation, const char* load_pipeline_cache,
-                     const char* write_pipeline_cache
+                     const char* write_pipeline_cache, bool fast_exit,
+                     bool debug_labels, bool measure_latency,
+                     const char* present_mode, bool memory_report
 #if defined __ANDROID__
                      ,
                      android_app* app
@@ -64,10 +68,16 @@ EntryData::EntryData(containers::Allocator* allocator, uint32_t width,
       output_frame_file_(output_frame_file),
       shader_compiler_(shader_compiler),
       validation_(validation),
-      log_(logging::GetLogger(allocator)),
+      log_(logging::GetLogger(
+          allocator->WithTag(containers::AllocationTag::kLogging))),
       allocator_(allocator),
       load_pipeline_cache_(load_pipeline_cache ? load_pipeline_cache : ""),
-      write_pipeline_cache_(write_pipeline_cache ? write_pipeline_cache : "")
+      write_pipeline_cache_(write_pipeline_cache ? write_pipeline_cache : ""),
+      fast_exit_(fast_exit),
+      debug_labels_(debug_labels),
+      measure_latency_(measure_latency),
+      present_mode_(present_mode ? present_mode : ""),
+      memory_report_(memory_report)
 #if defined __ANDROID__
       ,
       native_window_handle_(app->window),
@@ -83,7 +93,9 @@ EntryData::EntryData(containers::Allocator* allocator, uint32_t width,
       ,
       native_window_handle_(0),
       native_connection_(nullptr),
-      delete_window_atom_(nullptr)
+      delete_window_atom_(nullptr),
+      close_requested_(false),
+      stop_event_thread_(false)
 #endif
 {
 #if defined __ANDROID__
@@ -109,24 +121,9 @@ bool EntryData::WindowClosing() const {
 #elif defined __ggp__
   return k_window_closing;
 #elif defined __linux__
-  if (native_connection_ && delete_window_atom_) {
-    // The memory of 'event' is 'new'ed by xcb call, so we cannot track it
-    // in our allocator.
-    auto event = std::unique_ptr<xcb_generic_event_t>(
-        xcb_poll_for_event(native_connection_));
-    while (event) {
-      uint8_t event_code = event->response_type & 0x7f;
-      if (event_code == XCB_CLIENT_MESSAGE) {
-        auto client_msg =
-            reinterpret_cast<xcb_client_message_event_t*>(event.get());
-        if (client_msg->data.data32[0] == delete_window_atom_->atom) {
-          return true;
-        }
-      }
-      event.reset(xcb_poll_for_event(native_connection_));
-    }
-  }
-  return false;
+  // Set by the event thread, so this is called every frame without touching
+  // the connection.
+  return close_requested_.load();
 #elif defined _WIN32
   // TODO: implement this for WIN32
   return false;
@@ -134,6 +131,41 @@ bool EntryData::WindowClosing() const {
   return false;
 #endif
 }
+
+bool EntryData::PollWindowEvent(WindowEvent* event) const {
+#if defined __ggp__ || defined __ANDROID__
+  return false;
+#elif defined __linux__
+  return window_events_.Pop(event);
+#else
+  return false;
+#endif
+}
+
+bool EntryData::CreateAdditionalWindow(uint32_t width, uint32_t height) const {
+#if defined __ggp__ || defined __ANDROID__
+  return false;
+#elif defined __linux__
+  // There is no connection when a frame is written out instead.
+  if (!native_connection_) {
+    return false;
+  }
+  additional_windows_.push_back(CreateXcbWindow(width, height));
+  return true;
+#else
+  return false;
+#endif
+}
+
+size_t EntryData::num_windows() const {
+#if defined __ggp__ || defined __ANDROID__
+  return 1;
+#elif defined __linux__
+  return 1 + additional_windows_.size();
+#else
+  return 1;
+#endif
+}
 };  // namespace entry
 
 #if defined __linux__ || defined _WIN32 || \
@@ -150,6 +182,11 @@ struct CommandLineArgs {
   bool validation;
   const char* load_pipeline_cache;
   const char* write_pipeline_cache;
+  bool memory_report;
+  bool fast_exit;
+  bool debug_labels;
+  bool measure_latency;
+  const char* present_mode;
 };
 
 void print_usage(const char** argv) {
@@ -166,6 +203,11 @@ void print_usage(const char** argv) {
   std::cerr << "  -validation                   Turns on the validation layers if available" << std::endl;
   std::cerr << "  -output-file                  Sets the output file for the output-frame argument" << std::endl;
   std::cerr << "  -wait-for-debugger            Forces the application to pause on starup until a debugger is attached" << std::endl;
+  std::cerr << "  -memory-report                Logs the host memory used by each subsystem, and by the driver, on exit" << std::endl;
+  std::cerr << "  -fast-exit                    Destroys the device in bulk on exit, instead of each of its objects" << std::endl;
+  std::cerr << "  -debug-labels                 Labels the work and names the objects of the framework with VK_EXT_debug_utils" << std::endl;
+  std::cerr << "  -measure-latency              Measures the latency from input to present, and reports it on exit" << std::endl;
+  std::cerr << "  -present-mode=<mode>          Presents with fifo, fifo_relaxed, mailbox or immediate, if the surface supports it" << std::endl;
   std::cerr << "  -help                         Print this help" << std::endl;
 }
 
@@ -181,6 +223,11 @@ void parse_args(CommandLineArgs* args, int argc, const char** argv) {
   args->validation = false;
   args->load_pipeline_cache = nullptr;
   args->write_pipeline_cache = nullptr;
+  args->memory_report = false;
+  args->fast_exit = false;
+  args->debug_labels = false;
+  args->measure_latency = false;
+  args->present_mode = nullptr;
 
   for (int i = 1; i < argc; ++i) {
     if (strncmp(argv[i], "-w=", 3) == 0) {
@@ -205,6 +252,16 @@ void parse_args(CommandLineArgs* args, int argc, const char** argv) {
       args->shader_compiler = argv[i] + 17;
     } else if (strncmp(argv[i], "-wait-for-debugger", 19) == 0) {
       args->wait_for_debugger = true;
+    } else if (strncmp(argv[i], "-memory-report", 14) == 0) {
+      args->memory_report = true;
+    } else if (strncmp(argv[i], "-fast-exit", 10) == 0) {
+      args->fast_exit = true;
+    } else if (strncmp(argv[i], "-debug-labels", 13) == 0) {
+      args->debug_labels = true;
+    } else if (strncmp(argv[i], "-measure-latency", 16) == 0) {
+      args->measure_latency = true;
+    } else if (strncmp(argv[i], "-present-mode=", 14) == 0) {
+      args->present_mode = argv[i] + 14;
     } else if (strncmp(argv[i], "-help", 5) == 0) {
       print_usage(argv);
       std::exit(0);
@@ -215,6 +272,22 @@ void parse_args(CommandLineArgs* args, int argc, const char** argv) {
     }
   }
 }
+
+// Returns the allocator that the application should use. Allocations are
+// only tagged if a memory report was requested.
+containers::Allocator* GetAllocator(const CommandLineArgs& args,
+                                    containers::Allocator* untagged,
+                                    containers::TaggedAllocator* tagged) {
+  return args.memory_report ? tagged : untagged;
+}
+
+// Logs the time from startup until the sample has finished tearing down.
+void LogRunTime(const entry::EntryData& data,
+                std::chrono::high_resolution_clock::time_point start_time) {
+  std::chrono::duration<double, std::milli> run_time =
+      std::chrono::high_resolution_clock::now() - start_time;
+  data.logger()->LogInfo("Total run time: ", run_time.count(), " ms");
+}
 #endif
 
 #if defined __ANDROID__
@@ -272,12 +345,15 @@ void android_main(android_app* app) {
                                        : ANativeWindow_getHeight(app->window);
 
     containers::LeakCheckAllocator root_allocator;
+    containers::HugePageAllocator huge_page_allocator(&root_allocator);
     {
-      entry::EntryData entry_data(&root_allocator, static_cast<uint32_t>(width),
+      entry::EntryData entry_data(&huge_page_allocator,
+                                  static_cast<uint32_t>(width),
                                   static_cast<uint32_t>(height), FIXED_TIMESTEP,
                                   PREFER_SEPARATE_PRESENT, output_frame,
                                   output_file, shader_compiler, false, nullptr,
-                                  nullptr, app);
+                                  nullptr, false, false, false, nullptr,
+                                  false, app);
       data.entry_data = &entry_data;
       int return_value = main_entry(&entry_data);
       // Do not modify this line, scripts may look for it in the output.
@@ -285,6 +361,7 @@ void android_main(android_app* app) {
       ANativeActivity_finish(app->activity);
     }
     assert(root_allocator.currently_allocated_bytes_.load() == 0);
+    assert(huge_page_allocator.currently_allocated_bytes_.load() == 0);
   });
 
   app->userData = &data;
@@ -356,16 +433,21 @@ int main(int argc, const char** argv) {
 
   CommandLineArgs args;
   parse_args(&args, argc, argv);
+  const auto start_time = std::chrono::high_resolution_clock::now();
   while (args.wait_for_debugger)
     ;
   int return_value = 0;
   containers::LeakCheckAllocator root_allocator;
+  containers::HugePageAllocator huge_page_allocator(&root_allocator);
+  containers::TaggedAllocator tagged_allocator(&huge_page_allocator);
   {
     entry::EntryData entry_data(
-        &root_allocator, args.window_width, args.window_height,
-        args.fixed_timestep, args.prefer_separate_present, args.output_frame,
-        args.output_file, args.shader_compiler, args.validation,
-        args.load_pipeline_cache, args.write_pipeline_cache);
+        GetAllocator(args, &huge_page_allocator, &tagged_allocator),
+        args.window_width, args.window_height, args.fixed_timestep,
+        args.prefer_separate_present, args.output_frame, args.output_file,
+        args.shader_compiler, args.validation, args.load_pipeline_cache,
+        args.write_pipeline_cache, args.fast_exit, args.debug_labels,
+        args.measure_latency, args.present_mode, args.memory_report);
     if (args.output_frame == -1) {
       bool window_created = entry_data.CreateWindow();
       if (!window_created) {
@@ -388,6 +470,10 @@ int main(int argc, const char** argv) {
     main_thread.join();
     exited = true;
     ggp_thread.join();
+    LogRunTime(entry_data, start_time);
+    if (args.memory_report) {
+      tagged_allocator.LogReport(entry_data.logger());
+    }
 
     ggp::RemoveStreamStateChangedHandler(stream_state_changed_handler_id);
 
@@ -395,6 +481,7 @@ int main(int argc, const char** argv) {
     ggp::StopStream();
   }
   assert(root_allocator.currently_allocated_bytes_.load() == 0);
+  assert(huge_page_allocator.currently_allocated_bytes_.load() == 0);
   return return_value;
 }
 
@@ -404,35 +491,154 @@ int main(int argc, const char** argv) {
 bool entry::EntryData::CreateWindow() {
   if (output_frame_index_ == -1) {
     native_connection_ = xcb_connect(NULL, NULL);
-
-    const xcb_setup_t* setup = xcb_get_setup(native_connection_);
-    xcb_screen_iterator_t iter = xcb_setup_roots_iterator(setup);
-    xcb_screen_t* screen = iter.data;
-
-    native_window_handle_ = xcb_generate_id(native_connection_);
-    xcb_create_window(native_connection_, XCB_COPY_FROM_PARENT,
-                      native_window_handle_, screen->root, 0, 0, width_,
-                      height_, 1, XCB_WINDOW_CLASS_INPUT_OUTPUT,
-                      screen->root_visual, 0, NULL);
-    /* Magic code that will send notification when window is destroyed */
     xcb_intern_atom_cookie_t cookie =
-        xcb_intern_atom(native_connection_, 1, 12, "WM_PROTOCOLS");
-    auto reply = std::unique_ptr<xcb_intern_atom_reply_t>(
-        xcb_intern_atom_reply(native_connection_, cookie, 0));
-    xcb_intern_atom_cookie_t cookie2 =
         xcb_intern_atom(native_connection_, 0, 16, "WM_DELETE_WINDOW");
-    delete_window_atom_ = xcb_intern_atom_reply(native_connection_, cookie2, 0);
-    xcb_change_property(native_connection_, XCB_PROP_MODE_REPLACE,
-                        native_window_handle_, reply->atom, 4, 32, 1,
-                        &delete_window_atom_->atom);
-
-    xcb_map_window(native_connection_, native_window_handle_);
-    xcb_flush(native_connection_);
+    delete_window_atom_ = xcb_intern_atom_reply(native_connection_, cookie, 0);
+    native_window_handle_ = CreateXcbWindow(width_, height_);
+    event_thread_ = std::thread(&EntryData::RunEventThread, this);
     return true;
   }
   return false;
 }
 
+xcb_window_t entry::EntryData::CreateXcbWindow(uint32_t width,
+                                               uint32_t height) const {
+  const xcb_setup_t* setup = xcb_get_setup(native_connection_);
+  xcb_screen_iterator_t iter = xcb_setup_roots_iterator(setup);
+  xcb_screen_t* screen = iter.data;
+
+  xcb_window_t window = xcb_generate_id(native_connection_);
+  const uint32_t event_mask =
+      XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE |
+      XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE |
+      XCB_EVENT_MASK_POINTER_MOTION | XCB_EVENT_MASK_STRUCTURE_NOTIFY |
+      XCB_EVENT_MASK_EXPOSURE;
+  xcb_create_window(native_connection_, XCB_COPY_FROM_PARENT, window,
+                    screen->root, 0, 0, width, height, 1,
+                    XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+                    XCB_CW_EVENT_MASK, &event_mask);
+  /* Magic code that will send notification when window is destroyed */
+  xcb_intern_atom_cookie_t cookie =
+      xcb_intern_atom(native_connection_, 1, 12, "WM_PROTOCOLS");
+  auto reply = std::unique_ptr<xcb_intern_atom_reply_t>(
+      xcb_intern_atom_reply(native_connection_, cookie, 0));
+  xcb_change_property(native_connection_, XCB_PROP_MODE_REPLACE, window,
+                      reply->atom, 4, 32, 1, &delete_window_atom_->atom);
+
+  xcb_map_window(native_connection_, window);
+  xcb_flush(native_connection_);
+  return window;
+}
+
+void entry::EntryData::RunEventThread() {
+  uint32_t width = width_;
+  uint32_t height = height_;
+  while (true) {
+    // The memory of 'event' is 'new'ed by xcb call, so we cannot track it
+    // in our allocator.
+    auto event = std::unique_ptr<xcb_generic_event_t>(
+        xcb_wait_for_event(native_connection_));
+    if (!event) {
+      // The connection to the X server is gone, so is the window.
+      close_requested_.store(true);
+      return;
+    }
+    if (stop_event_thread_.load()) {
+      return;
+    }
+    WindowEvent window_event = {};
+    window_event.time = std::chrono::steady_clock::now();
+    switch (event->response_type & 0x7f) {
+      case XCB_CLIENT_MESSAGE: {
+        auto client_msg =
+            reinterpret_cast<xcb_client_message_event_t*>(event.get());
+        if (client_msg->data.data32[0] == delete_window_atom_->atom) {
+          close_requested_.store(true);
+        }
+        continue;
+      }
+      case XCB_KEY_PRESS:
+      case XCB_KEY_RELEASE: {
+        auto key = reinterpret_cast<xcb_key_press_event_t*>(event.get());
+        window_event.type = (event->response_type & 0x7f) == XCB_KEY_PRESS
+                                ? WindowEvent::Type::kKeyPress
+                                : WindowEvent::Type::kKeyRelease;
+        window_event.x = key->event_x;
+        window_event.y = key->event_y;
+        window_event.detail = key->detail;
+        break;
+      }
+      case XCB_BUTTON_PRESS:
+      case XCB_BUTTON_RELEASE: {
+        auto button =
+            reinterpret_cast<xcb_button_press_event_t*>(event.get());
+        window_event.type = (event->response_type & 0x7f) == XCB_BUTTON_PRESS
+                                ? WindowEvent::Type::kButtonPress
+                                : WindowEvent::Type::kButtonRelease;
+        window_event.x = button->event_x;
+        window_event.y = button->event_y;
+        window_event.detail = button->detail;
+        break;
+      }
+      case XCB_MOTION_NOTIFY: {
+        auto motion =
+            reinterpret_cast<xcb_motion_notify_event_t*>(event.get());
+        window_event.type = WindowEvent::Type::kPointerMotion;
+        window_event.x = motion->event_x;
+        window_event.y = motion->event_y;
+        break;
+      }
+      case XCB_CONFIGURE_NOTIFY: {
+        // These are also sent when the window only moves.
+        auto configure =
+            reinterpret_cast<xcb_configure_notify_event_t*>(event.get());
+        if (configure->window != native_window_handle_ ||
+            (configure->width == width && configure->height == height)) {
+          continue;
+        }
+        width = configure->width;
+        height = configure->height;
+        window_event.type = WindowEvent::Type::kResize;
+        window_event.x = width;
+        window_event.y = height;
+        break;
+      }
+      case XCB_EXPOSE: {
+        // One event is sent per uncovered rectangle, count says how many
+        // more follow. Only the last one is reported.
+        auto expose = reinterpret_cast<xcb_expose_event_t*>(event.get());
+        if (expose->window != native_window_handle_ || expose->count != 0) {
+          continue;
+        }
+        window_event.type = WindowEvent::Type::kExpose;
+        break;
+      }
+      default:
+        continue;
+    }
+    window_events_.Push(window_event);
+  }
+}
+
+void entry::EntryData::StopEventThread() {
+  if (!event_thread_.joinable()) {
+    return;
+  }
+  stop_event_thread_.store(true);
+  // Wake the thread up from xcb_wait_for_event. With no event mask the
+  // event goes to the creator of the window, which is us.
+  xcb_client_message_event_t wake_up;
+  memset(&wake_up, 0, sizeof(wake_up));
+  wake_up.response_type = XCB_CLIENT_MESSAGE;
+  wake_up.format = 32;
+  wake_up.window = native_window_handle_;
+  xcb_send_event(native_connection_, 0, native_window_handle_,
+                 XCB_EVENT_MASK_NO_EVENT,
+                 reinterpret_cast<const char*>(&wake_up));
+  xcb_flush(native_connection_);
+  event_thread_.join();
+}
+
 static char file_path[1024 * 1024] = {};
 
 // Main for Linux
@@ -443,6 +649,7 @@ static char file_path[1024 * 1024] = {};
 int main(int argc, const char** argv) {
   CommandLineArgs args;
   parse_args(&args, argc, argv);
+  const auto start_time = std::chrono::high_resolution_clock::now();
 
   if (args.output_frame != -1) {
     int path_len = readlink("/proc/self/exe", file_path, 1024 * 1024 - 1);
@@ -470,12 +677,16 @@ int main(int argc, const char** argv) {
 
   int return_value = 0;
   containers::LeakCheckAllocator root_allocator;
+  containers::HugePageAllocator huge_page_allocator(&root_allocator);
+  containers::TaggedAllocator tagged_allocator(&huge_page_allocator);
   {
     entry::EntryData entry_data(
-        &root_allocator, args.window_width, args.window_height,
-        args.fixed_timestep, args.prefer_separate_present, args.output_frame,
-        args.output_file, args.shader_compiler, args.validation,
-        args.load_pipeline_cache, args.write_pipeline_cache);
+        GetAllocator(args, &huge_page_allocator, &tagged_allocator),
+        args.window_width, args.window_height, args.fixed_timestep,
+        args.prefer_separate_present, args.output_frame, args.output_file,
+        args.shader_compiler, args.validation, args.load_pipeline_cache,
+        args.write_pipeline_cache, args.fast_exit, args.debug_labels,
+        args.measure_latency, args.present_mode, args.memory_report);
     if (args.output_frame == -1) {
       bool window_created = entry_data.CreateWindow();
       if (!window_created) {
@@ -487,8 +698,13 @@ int main(int argc, const char** argv) {
       return_value = main_entry(&entry_data);
     });
     main_thread.join();
+    LogRunTime(entry_data, start_time);
+    if (args.memory_report) {
+      tagged_allocator.LogReport(entry_data.logger());
+    }
   }
   assert(root_allocator.currently_allocated_bytes_.load() == 0);
+  assert(huge_page_allocator.currently_allocated_bytes_.load() == 0);
   return return_value;
 }
 
@@ -558,6 +774,7 @@ static char layer_path[1024 * 1024] = {};
 int main(int argc, const char** argv) {
   CommandLineArgs args;
   parse_args(&args, argc, argv);
+  const auto start_time = std::chrono::high_resolution_clock::now();
 
   if (args.output_frame != -1) {
     DWORD path_len = GetModuleFileNameA(NULL, file_path, 1024 * 1024 - 1);
@@ -582,11 +799,15 @@ int main(int argc, const char** argv) {
     }
   }
   containers::LeakCheckAllocator root_allocator;
+  containers::HugePageAllocator huge_page_allocator(&root_allocator);
+  containers::TaggedAllocator tagged_allocator(&huge_page_allocator);
   entry::EntryData entry_data(
-      &root_allocator, args.window_width, args.window_height,
-      args.fixed_timestep, args.prefer_separate_present, args.output_frame,
-      args.output_file, args.shader_compiler, args.validation,
-      args.load_pipeline_cache, args.write_pipeline_cache);
+      GetAllocator(args, &huge_page_allocator, &tagged_allocator),
+      args.window_width, args.window_height, args.fixed_timestep,
+      args.prefer_separate_present, args.output_frame, args.output_file,
+      args.shader_compiler, args.validation, args.load_pipeline_cache,
+      args.write_pipeline_cache, args.fast_exit, args.debug_labels,
+      args.measure_latency, args.present_mode, args.memory_report);
 
   if (args.output_frame == -1) {
     bool window_created = entry_data.CreateWindowWin32();
@@ -608,7 +829,12 @@ int main(int argc, const char** argv) {
   }
 
   main_thread.join();
+  LogRunTime(entry_data, start_time);
+  if (args.memory_report) {
+    tagged_allocator.LogReport(entry_data.logger());
+  }
   assert(root_allocator.currently_allocated_bytes_.load() == 0);
+  assert(huge_page_allocator.currently_allocated_bytes_.load() == 0);
   return return_value;
 }
 #endif
@@ -627,14 +853,19 @@ bool entry::EntryData::CreateWindow() {
 int main(int argc, const char** argv) {
   CommandLineArgs args;
   parse_args(&args, argc, argv);
+  const auto start_time = std::chrono::high_resolution_clock::now();
   while (args.wait_for_debugger)
     ;
   containers::LeakCheckAllocator root_allocator;
+  containers::HugePageAllocator huge_page_allocator(&root_allocator);
+  containers::TaggedAllocator tagged_allocator(&huge_page_allocator);
   entry::EntryData entry_data(
-      &root_allocator, args.window_width, args.window_height,
-      args.fixed_timestep, args.prefer_separate_present, args.output_frame,
-      args.output_file, args.shader_compiler, args.validation,
-      args.load_pipeline_cache, args.write_pipeline_cache);
+      GetAllocator(args, &huge_page_allocator, &tagged_allocator),
+      args.window_width, args.window_height, args.fixed_timestep,
+      args.prefer_separate_present, args.output_frame, args.output_file,
+      args.shader_compiler, args.validation, args.load_pipeline_cache,
+      args.write_pipeline_cache, args.fast_exit, args.debug_labels,
+      args.measure_latency, args.present_mode, args.memory_report);
   if (args.output_frame == -1) {
     bool window_created = entry_data.CreateWindow();
     if (!window_created) {
@@ -649,7 +880,13 @@ int main(int argc, const char** argv) {
   });
   RunMacOS();
 
+  LogRunTime(entry_data, start_time);
+
+  if (args.memory_report) {
+    tagged_allocator.LogReport(entry_data.logger());
+  }
   assert(root_allocator.currently_allocated_bytes_.load() == 0);
+  assert(huge_page_allocator.currently_allocated_bytes_.load() == 0);
   return ret;
 }
 }
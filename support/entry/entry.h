@@ -16,11 +16,15 @@
 #ifndef SUPPORT_ENTRY_ENTRY_H_
 #define SUPPORT_ENTRY_ENTRY_H_
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "support/containers/allocator.h"
 #include "support/containers/unique_ptr.h"
+#include "support/entry/window_events.h"
 #include "support/log/log.h"
 
 #if defined __ANDROID__
@@ -71,7 +75,9 @@ class EntryData {
             int64_t output_frame_index, const char* output_frame_file,
             const char* shader_compiler, bool validation,
             const char* load_pipeline_cache,
-            const char* write_pipeline_cache
+            const char* write_pipeline_cache, bool fast_exit,
+            bool debug_labels, bool measure_latency, const char* present_mode,
+            bool memory_report
 #if defined __ANDROID__
             ,
             android_app* app
@@ -88,6 +94,7 @@ class EntryData {
 #elif defined __ggp__
 // Empty
 #elif defined __linux__
+    StopEventThread();
     free(delete_window_atom_);
     xcb_disconnect(native_connection_);
 #endif
@@ -103,6 +110,17 @@ class EntryData {
   bool CreateWindow();
 #endif
   bool WindowClosing() const;
+  // Takes the oldest input, resize or expose event of the window, if there
+  // is one. Events are only reported for XCB windows so far. This must
+  // always be called from the same thread.
+  bool PollWindowEvent(WindowEvent* event) const;
+  // Opens another window of the given size, for applications that render to
+  // more than one output. Only XCB windows can be added so far, elsewhere
+  // this returns false. Closing any of the windows closes the application,
+  // and events are only reported for the first one.
+  bool CreateAdditionalWindow(uint32_t width, uint32_t height) const;
+  // The number of windows, including the one the application started with.
+  size_t num_windows() const;
 
   void NotifyReady() const;
 
@@ -116,7 +134,12 @@ class EntryData {
 #elif defined __ggp__
 // Empty
 #elif defined __linux__
-  xcb_window_t native_window_handle() const { return native_window_handle_; }
+  // |window| 0 is the window the application started with, the others were
+  // added with CreateAdditionalWindow.
+  xcb_window_t native_window_handle(size_t window = 0) const {
+    return window == 0 ? native_window_handle_
+                       : additional_windows_[window - 1];
+  }
   xcb_connection_t* native_connection() const { return native_connection_; }
 #elif defined __APPLE__
   void* native_window_handle() const { return native_window_handle_; }
@@ -138,6 +161,25 @@ class EntryData {
   const char* write_pipeline_cache() const {
     return write_pipeline_cache_.empty()? nullptr: write_pipeline_cache_.c_str();
   }
+  // If true, the application should tear down the device in bulk rather
+  // than destroying each of its objects. Swapchains and surfaces are still
+  // destroyed one by one.
+  bool fast_exit() const { return fast_exit_; }
+  // If true, the application should label its work and name its objects
+  // with VK_EXT_debug_utils, for external profilers and capture tools.
+  bool debug_labels() const { return debug_labels_; }
+  // If true, the application should measure the latency from input to
+  // present, and report it on exit.
+  bool measure_latency() const { return measure_latency_; }
+  // The present mode that the swapchain should use, if it is supported:
+  // "fifo", "fifo_relaxed", "mailbox" or "immediate". nullptr for the
+  // default.
+  const char* present_mode() const {
+    return present_mode_.empty() ? nullptr : present_mode_.c_str();
+  }
+  // If true, the application should report the host memory it used on exit,
+  // including what the driver allocated through allocation callbacks.
+  bool memory_report() const { return memory_report_; }
 
  private:
   bool fixed_timestep_;
@@ -152,6 +194,11 @@ class EntryData {
   containers::Allocator* allocator_;
   std::string load_pipeline_cache_;
   std::string write_pipeline_cache_;
+  const bool fast_exit_;
+  const bool debug_labels_;
+  const bool measure_latency_;
+  std::string present_mode_;
+  const bool memory_report_;
 
 #if defined __ANDROID__
   ANativeWindow* native_window_handle_;
@@ -163,9 +210,22 @@ class EntryData {
 #elif defined __ggp__
 // Empty
 #elif defined __linux__
+  // Reads the events of the window on event_thread_, so that the thread
+  // rendering never has to ask the X server for them.
+  void RunEventThread();
+  void StopEventThread();
+  // Creates and maps a window on native_connection_, that asks to be
+  // deleted rather than being destroyed when closed.
+  xcb_window_t CreateXcbWindow(uint32_t width, uint32_t height) const;
+
   xcb_window_t native_window_handle_;
   xcb_connection_t* native_connection_;
   xcb_intern_atom_reply_t* delete_window_atom_;
+  std::atomic<bool> close_requested_;
+  std::atomic<bool> stop_event_thread_;
+  mutable WindowEventQueue window_events_;
+  mutable std::vector<xcb_window_t> additional_windows_;
+  std::thread event_thread_;
 #elif defined __APPLE__
   void* native_window_handle_;
 #endif
@@ -0,0 +1,108 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SUPPORT_ENTRY_WINDOW_EVENTS_H_
+#define SUPPORT_ENTRY_WINDOW_EVENTS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace entry {
+
+// An input, resize or expose event of the application window.
+struct WindowEvent {
+  enum class Type {
+    kKeyPress,
+    kKeyRelease,
+    kButtonPress,
+    kButtonRelease,
+    kPointerMotion,
+    kResize,
+    // Some of the window was uncovered, and has to be drawn again.
+    kExpose,
+  };
+  Type type;
+  // When the event thread received the event.
+  std::chrono::steady_clock::time_point time;
+  // The pointer position for input events, or the new size for kResize.
+  int32_t x;
+  int32_t y;
+  // The keycode or button number of key and button events.
+  uint32_t detail;
+};
+
+// WindowEventQueue passes events from the thread that reads them from the
+// window system to the thread that runs the application, without locking.
+// There must only ever be one thread pushing, and one popping. When the
+// application does not keep up, new events are dropped and counted.
+class WindowEventQueue {
+ public:
+  // Must be a power of 2.
+  static const size_t kCapacity = 256;
+
+  WindowEventQueue() {
+    head_.store(0);
+    tail_.store(0);
+    dropped_.store(0);
+  }
+  WindowEventQueue(const WindowEventQueue&) = delete;
+  WindowEventQueue& operator=(const WindowEventQueue&) = delete;
+
+  // Called from the producing thread only.
+  bool Push(const WindowEvent& event) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == kCapacity) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    events_[tail & (kCapacity - 1)] = event;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Called from the consuming thread only. Returns false if there is no
+  // event.
+  bool Pop(WindowEvent* event) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *event = events_[head & (kCapacity - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // The number of events that were dropped because the queue was full.
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  static_assert((kCapacity & (kCapacity - 1)) == 0,
+                "kCapacity must be a power of 2");
+
+  WindowEvent events_[kCapacity];
+  // Padded onto separate cache lines, so the two threads do not keep taking
+  // the line from each other.
+  std::atomic<size_t> head_;
+  char head_padding_[64];
+  std::atomic<size_t> tail_;
+  char tail_padding_[64];
+  std::atomic<uint64_t> dropped_;
+};
+
+}  // namespace entry
+
+#endif  // SUPPORT_ENTRY_WINDOW_EVENTS_H_
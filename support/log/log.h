@@ -24,13 +24,37 @@
 #include "support/containers/vector.h"
 namespace logging {
 
+// Tells the compiler that |cond| is almost never true, so that the code for
+// a failed check is moved out of the way of the code that follows it.
+#if defined(__GNUC__) || defined(__clang__)
+#define LOG_PREDICT_FALSE(cond) (__builtin_expect(!!(cond), 0))
+#else
+#define LOG_PREDICT_FALSE(cond) (cond)
+#endif
+
+// There are two categories of checks:
+//  LOG_EXPECT and LOG_ASSERT are always on. They are for checks that the
+//  program is correct.
+//  LOG_DEBUG_EXPECT and LOG_DEBUG_ASSERT are for checking the results of API
+//  calls on per-frame paths. In builds that define NDEBUG (which CMake does
+//  for Release and MinSizeRel) they only evaluate their arguments, so the
+//  call is still made but its result is not checked. Define
+//  LOG_ENABLE_DEBUG_ASSERTS to keep them on in those builds. Calls whose
+//  outputs are used afterwards, like the image index of
+//  vkAcquireNextImageKHR, must stay on LOG_ASSERT.
+#if defined(NDEBUG) && !defined(LOG_ENABLE_DEBUG_ASSERTS)
+#define LOG_DEBUG_ASSERTS_ENABLED 0
+#else
+#define LOG_DEBUG_ASSERTS_ENABLED 1
+#endif
+
 // Tests the result of "res op exp" and if the result is not "true"
 // then logs an error to LogError of the given log.
 #define LOG_EXPECT(op, log, res, exp)                                          \
   do {                                                                         \
     auto x = exp;                                                              \
     auto r = res;                                                              \
-    if (!(r op x)) {                                                           \
+    if (LOG_PREDICT_FALSE(!(r op x))) {                                        \
       (log)->LogError(__FILE__, ":", __LINE__,                                 \
                       "\n  Expected " #res " " #op " " #exp "\n  but got ", r, \
                       " " #op " ", x);                                         \
@@ -42,7 +66,7 @@ namespace logging {
   do {                                                                         \
     auto x = exp;                                                              \
     auto r = res;                                                              \
-    if (!(r op x)) {                                                           \
+    if (LOG_PREDICT_FALSE(!(r op x))) {                                        \
       (log)->LogError(__FILE__, ":", __LINE__,                                 \
                       "\n  Expected " #res " " #op " " #exp "\n  but got ", r, \
                       " " #op " ", x);                                         \
@@ -50,6 +74,20 @@ namespace logging {
     }                                                                          \
   } while (0);
 
+#if LOG_DEBUG_ASSERTS_ENABLED
+#define LOG_DEBUG_EXPECT(op, log, res, exp) LOG_EXPECT(op, log, res, exp)
+#define LOG_DEBUG_ASSERT(op, log, res, exp) LOG_ASSERT(op, log, res, exp)
+#else
+// Either of |res| and |exp| may be the call being checked, so both have to
+// be evaluated.
+#define LOG_DEBUG_EXPECT(op, log, res, exp) \
+  do {                                      \
+    (void)(res);                            \
+    (void)(exp);                            \
+  } while (0);
+#define LOG_DEBUG_ASSERT(op, log, res, exp) LOG_DEBUG_EXPECT(op, log, res, exp)
+#endif
+
 // Logs a message and then forces the program to crash.
 #define LOG_CRASH(log, message)                        \
   do {                                                 \
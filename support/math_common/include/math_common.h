@@ -16,6 +16,8 @@
 #ifndef _MATH_COMMON_H_
 #define _MATH_COMMON_H_
 
+#include <cstdint>
+
 #include "mathfu/matrix.h"
 #include "mathfu/vector.h"
 
@@ -24,4 +26,9 @@ using Vector4 = mathfu::Vector<float, 4>;
 using Vector3 = mathfu::Vector<float, 3>;
 using Vector2 = mathfu::Vector<float, 2>;
 
+// Converts both components of |v| to half precision, rounding to nearest
+// even, and packs them into one value with x in the low 16 bits. This gives
+// the same result as packHalf2x16 in GLSL.
+uint32_t PackHalf2x16(const Vector2& v);
+
 #endif  // _MATH_COMMON_H_
\ No newline at end of file
@@ -13,4 +13,52 @@
  * limitations under the License.
  */
 
-// Intentionally empty, just used so CMake generates a library.
\ No newline at end of file
+#include "include/math_common.h"
+
+#include <cstring>
+
+namespace {
+uint16_t FloatToHalf(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  const uint32_t float_exponent = (bits >> 23) & 0xff;
+  uint32_t mantissa = bits & 0x7fffff;
+  if (float_exponent == 0xff) {
+    // Infinity stays infinity, and NaN stays NaN.
+    return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+  }
+  const int32_t exponent = static_cast<int32_t>(float_exponent) - 127 + 15;
+  if (exponent >= 0x1f) {
+    return static_cast<uint16_t>(sign | 0x7c00);
+  }
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return static_cast<uint16_t>(sign);
+    }
+    // The result is denormal, shift the implicit 1 into the mantissa.
+    mantissa |= 0x800000;
+    const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+    uint32_t half = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+      ++half;
+    }
+    return static_cast<uint16_t>(sign | half);
+  }
+  uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+  const uint32_t remainder = mantissa & 0x1fff;
+  // A carry out of the mantissa correctly bumps the exponent, up to
+  // infinity.
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+    ++half;
+  }
+  return static_cast<uint16_t>(sign | half);
+}
+}  // anonymous namespace
+
+uint32_t PackHalf2x16(const Vector2& v) {
+  return static_cast<uint32_t>(FloatToHalf(v[0])) |
+         (static_cast<uint32_t>(FloatToHalf(v[1])) << 16);
+}
\ No newline at end of file
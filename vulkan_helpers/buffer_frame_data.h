@@ -35,7 +35,8 @@ class BufferFrameData {
   // when it is appropriate.
   // T can be any type that can be bitwise copied. The data will be mapped
   // byte for byte into a uniform buffer, so it it must have the proper
-  // alignment as defined in SPIR-V.
+  // alignment as defined in SPIR-V. A ShaderBlock from shader_layout.h is
+  // laid out correctly by construction.
  public:
   // |buffered_data_count| is the number of buffered frames the uniform data
   // should produce. Typcially this is one per swapchain image. |usage| is the
@@ -137,19 +138,41 @@ class BufferFrameData {
 
   T& data() { return set_value_; }
 
+  // Copies the data into the host buffer for the given index if it has
+  // changed, and defers the flush to the application's MappedRangeBatcher.
+  // Returns true if update_command_buffer(buffer_index) has to be submitted,
+  // after the batcher has been flushed, for the device buffer to be correct.
+  // This lets several BufferFrameData share one flush and one submit.
+  bool StageBuffer(size_t buffer_index, bool force = false) {
+    const size_t offset = get_offset_for_frame(buffer_index);
+    bool equal =
+        memcmp(&set_value_, host_buffer_->base_address() + offset, size()) == 0;
+    if (!force && equal && !uninitialized_[buffer_index]) {
+      return false;
+    }
+    // If the data for this frame is not what was previously recorded into
+    // the buffer, then copy the data into the buffer.
+    uninitialized_[buffer_index] = false;
+    memcpy(host_buffer_->base_address() + offset, &set_value_, size());
+    host_buffer_->defer_flush(offset, aligned_data_size());
+    return true;
+  }
+
+  // Returns the command buffer that copies the host data for the given
+  // index into the device buffer.
+  const ::VkCommandBuffer& update_command_buffer(size_t buffer_index) {
+    return update_commands_[buffer_index].get_command_buffer();
+  }
+
   // Enqueues an update operation on the queue if needed, to ensure
   // that the buffer is correct for the given index.
+  // The copy is submitted right here, so the batcher has to be flushed
+  // first and the frame's own flush comes too late. To share one flush and
+  // one submit between several buffers, use StageBuffer instead.
   void UpdateBuffer(VkQueue* update_queue, size_t buffer_index,
                     uint32_t kDeviceMask = 0, bool force = false) {
-    const size_t offset = get_offset_for_frame(buffer_index);
-    bool equal =
-        memcmp(&set_value_, host_buffer_->base_address() + offset, size()) == 0;
-    if (force || !equal || uninitialized_[buffer_index]) {
-      // If the data for this frame is not what was previously recorded into
-      // the buffer, then copy the data into the buffer and update it.
-      uninitialized_[buffer_index] = false;
-      memcpy(host_buffer_->base_address() + offset, &set_value_, size());
-      host_buffer_->flush(offset, aligned_data_size());
+    if (StageBuffer(buffer_index, force)) {
+      application_->mapped_range_batcher()->Flush();
 
       VkDeviceGroupSubmitInfo group_submit_info = {
           VK_STRUCTURE_TYPE_DEVICE_GROUP_SUBMIT_INFO,
@@ -0,0 +1,117 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_HELPERS_DEBUG_LABELS_H_
+#define VULKAN_HELPERS_DEBUG_LABELS_H_
+
+#include <cstdint>
+
+#include "vulkan_helpers/vulkan_header_wrapper.h"
+#include "vulkan_wrapper/command_buffer_wrapper.h"
+#include "vulkan_wrapper/device_wrapper.h"
+#include "vulkan_wrapper/queue_wrapper.h"
+
+namespace vulkan {
+
+// DebugLabels labels regions of command buffers and queues, and names
+// objects, with VK_EXT_debug_utils, so that captures in tools like RenderDoc
+// or GAPID show what the framework is doing.
+// When it is disabled every call returns before touching Vulkan, so the
+// extension functions are never even loaded.
+class DebugLabels {
+ public:
+  explicit DebugLabels(bool enabled) : enabled_(enabled) {}
+
+  bool enabled() const { return enabled_; }
+
+  void BeginLabel(VkCommandBuffer* command_buffer, const char* name) const {
+    if (!enabled_) {
+      return;
+    }
+    VkDebugUtilsLabelEXT label = Label(name);
+    (*command_buffer)->vkCmdBeginDebugUtilsLabelEXT(*command_buffer, &label);
+  }
+  void EndLabel(VkCommandBuffer* command_buffer) const {
+    if (!enabled_) {
+      return;
+    }
+    (*command_buffer)->vkCmdEndDebugUtilsLabelEXT(*command_buffer);
+  }
+
+  void BeginLabel(VkQueue* queue, const char* name) const {
+    if (!enabled_) {
+      return;
+    }
+    VkDebugUtilsLabelEXT label = Label(name);
+    (*queue)->vkQueueBeginDebugUtilsLabelEXT(*queue, &label);
+  }
+  void EndLabel(VkQueue* queue) const {
+    if (!enabled_) {
+      return;
+    }
+    (*queue)->vkQueueEndDebugUtilsLabelEXT(*queue);
+  }
+
+  // Names the object |handle| of the given |type|. Handles can be passed
+  // as uint64_t(handle).
+  void SetName(VkDevice* device, VkObjectType type, uint64_t handle,
+               const char* name) const {
+    if (!enabled_) {
+      return;
+    }
+    VkDebugUtilsObjectNameInfoEXT name_info{
+        VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT,  // sType
+        nullptr,                                             // pNext
+        type,                                                // objectType
+        handle,                                              // objectHandle
+        name                                                 // pObjectName
+    };
+    (*device)->vkSetDebugUtilsObjectNameEXT(*device, &name_info);
+  }
+
+ private:
+  static VkDebugUtilsLabelEXT Label(const char* name) {
+    return {
+        VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,  // sType
+        nullptr,                                  // pNext
+        name,                                     // pLabelName
+        {0.0f, 0.0f, 0.0f, 0.0f},                 // color, unused if all 0
+    };
+  }
+
+  bool enabled_;
+};
+
+// Labels the commands recorded into a command buffer, or submitted to a
+// queue, while this is in scope. T is either VkCommandBuffer or VkQueue.
+template <typename T>
+class ScopedDebugLabel {
+ public:
+  ScopedDebugLabel(const DebugLabels& labels, T* target, const char* name)
+      : labels_(labels), target_(target) {
+    labels_.BeginLabel(target_, name);
+  }
+  ~ScopedDebugLabel() { labels_.EndLabel(target_); }
+  ScopedDebugLabel(const ScopedDebugLabel&) = delete;
+  ScopedDebugLabel& operator=(const ScopedDebugLabel&) = delete;
+
+ private:
+  const DebugLabels& labels_;
+  T* target_;
+};
+
+}  // namespace vulkan
+
+#endif  // VULKAN_HELPERS_DEBUG_LABELS_H_
@@ -0,0 +1,82 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_HELPERS_DRAW_CONSTANTS_H_
+#define VULKAN_HELPERS_DRAW_CONSTANTS_H_
+
+#include "support/log/log.h"
+#include "vulkan_helpers/vulkan_application.h"
+
+namespace vulkan {
+
+// DrawConstants sends a small T to the shaders with every draw. T is recorded
+// straight into the command buffer with vkCmdPushConstants, which needs no
+// buffer, no descriptor update and no upload submit. Every device supports at
+// least 128 bytes of push constants, so a Mat44 or a few vectors always fit.
+// The shader has to declare T as a push_constant block.
+//
+// Typical use:
+//   pipeline_layout = app->CreatePipelineLayout({{...}}, {&constants});
+//   ...
+//   for (each draw) {
+//     constants.Push(&cmd_buffer, pipeline_layout, value);
+//     vkCmdDraw(...);
+//   }
+//
+// T can be any type that can be bitwise copied, and its size must be a
+// multiple of 4.
+template <typename T>
+class DrawConstants : public PushConstantSource {
+  static_assert(sizeof(T) % 4 == 0,
+                "Push constant sizes must be a multiple of 4");
+
+ public:
+  // |stages| are the shader stages that read the constants, and |offset| is
+  // where T starts in the push constant block. T must fit in the device's
+  // maxPushConstantsSize.
+  DrawConstants(VulkanApplication* application, VkShaderStageFlags stages,
+                uint32_t offset = 0)
+      : stages_(stages), offset_(offset) {
+    LOG_ASSERT(<=, application->GetLogger(), offset + sizeof(T),
+               size_t(application->physical_device_properties()
+                          .limits.maxPushConstantsSize));
+  }
+
+  // PushConstantSource
+  bool GetPushConstantRange(VkPushConstantRange* range) const override {
+    *range = {
+        stages_,                          // stageFlags
+        offset_,                          // offset
+        static_cast<uint32_t>(sizeof(T))  // size
+    };
+    return true;
+  }
+
+  // Records |value| for the draws that follow in |cmd_buffer|.
+  void Push(VkCommandBuffer* cmd_buffer, ::VkPipelineLayout layout,
+            const T& value) {
+    (*cmd_buffer)
+        ->vkCmdPushConstants(*cmd_buffer, layout, stages_, offset_, sizeof(T),
+                             &value);
+  }
+
+ private:
+  VkShaderStageFlags stages_;
+  uint32_t offset_;
+};
+
+}  // namespace vulkan
+
+#endif  // VULKAN_HELPERS_DRAW_CONSTANTS_H_
@@ -0,0 +1,272 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vulkan_helpers/driver_memory_tracker.h"
+
+#include <cstring>
+
+namespace vulkan {
+namespace {
+// Every allocation is preceded by one of these, so that it can be freed, or
+// reallocated, through any of the callbacks.
+struct AllocationHeader {
+  // The block that was allocated from the containers::Allocator.
+  void* block;
+  size_t block_size;
+  // The size that the driver asked for.
+  size_t size;
+  uint32_t object_type;
+  uint32_t scope;
+};
+
+// The allocator hands out memory aligned for any fundamental type, so this
+// is the smallest alignment that we have to round the header up to.
+const size_t kMinAlignment = 16;
+
+AllocationHeader* GetHeader(void* memory) {
+  return reinterpret_cast<AllocationHeader*>(memory) - 1;
+}
+
+const char* ObjectTypeName(uint32_t object_type) {
+  static const char* kNames[] = {
+      "Unknown",        "Instance",       "PhysicalDevice",
+      "Device",         "Queue",          "Semaphore",
+      "CommandBuffer",  "Fence",          "DeviceMemory",
+      "Buffer",         "Image",          "Event",
+      "QueryPool",      "BufferView",     "ImageView",
+      "ShaderModule",   "PipelineCache",  "PipelineLayout",
+      "RenderPass",     "Pipeline",       "DescriptorSetLayout",
+      "Sampler",        "DescriptorPool", "DescriptorSet",
+      "Framebuffer",    "CommandPool"};
+  return kNames[object_type];
+}
+
+const char* ScopeName(uint32_t scope) {
+  static const char* kNames[] = {"Command", "Object", "Cache", "Device",
+                                 "Instance"};
+  return kNames[scope];
+}
+
+void LogCounters(logging::Logger* log, const char* name,
+                 const DriverMemoryTracker::Counters& c) {
+  if (c.allocations == 0) {
+    return;
+  }
+  log->LogInfo("  ", name, ": current ", c.current_bytes, " bytes, peak ",
+               c.peak_bytes, " bytes, total ", c.total_bytes, " bytes in ",
+               c.allocations, " allocations, at most ", c.peak_frame_bytes,
+               " bytes in ", c.peak_frame_allocations,
+               " allocations in one frame");
+}
+}  // anonymous namespace
+
+DriverMemoryTracker::DriverMemoryTracker(containers::Allocator* allocator,
+                                         logging::Logger* log)
+    : allocator_(allocator), log_(log), frames_(0) {
+  memset(object_type_counters_, 0, sizeof(object_type_counters_));
+  memset(scope_counters_, 0, sizeof(scope_counters_));
+  for (uint32_t i = 0; i < kNumObjectTypes; ++i) {
+    user_data_[i] = {this, i};
+    callbacks_[i] = {
+        &user_data_[i],      // pUserData
+        Allocate,            // pfnAllocation
+        Reallocate,          // pfnReallocation
+        Free,                // pfnFree
+        InternalAllocation,  // pfnInternalAllocation
+        InternalFree,        // pfnInternalFree
+    };
+  }
+}
+
+DriverMemoryTracker::~DriverMemoryTracker() { LogReport(); }
+
+const VkAllocationCallbacks* DriverMemoryTracker::callbacks(
+    VkObjectType type) const {
+  return &callbacks_[type < kNumObjectTypes ? type : VK_OBJECT_TYPE_UNKNOWN];
+}
+
+void DriverMemoryTracker::EndFrame() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto end_frame = [](Counters* c) {
+    if (c->frame_bytes > c->peak_frame_bytes) {
+      c->peak_frame_bytes = c->frame_bytes;
+    }
+    if (c->frame_allocations > c->peak_frame_allocations) {
+      c->peak_frame_allocations = c->frame_allocations;
+    }
+    c->frame_bytes = 0;
+    c->frame_allocations = 0;
+  };
+  for (Counters& c : object_type_counters_) {
+    end_frame(&c);
+  }
+  for (Counters& c : scope_counters_) {
+    end_frame(&c);
+  }
+  ++frames_;
+}
+
+DriverMemoryTracker::Counters DriverMemoryTracker::object_type_counters(
+    VkObjectType type) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return object_type_counters_[type < kNumObjectTypes ? type
+                                                      : VK_OBJECT_TYPE_UNKNOWN];
+}
+
+DriverMemoryTracker::Counters DriverMemoryTracker::scope_counters(
+    VkSystemAllocationScope scope) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return scope_counters_[scope];
+}
+
+void DriverMemoryTracker::LogReport() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  log_->LogInfo("Driver host memory after ", frames_, " frames, by object:");
+  for (uint32_t i = 0; i < kNumObjectTypes; ++i) {
+    LogCounters(log_, ObjectTypeName(i), object_type_counters_[i]);
+  }
+  log_->LogInfo("Driver host memory by allocation scope:");
+  for (uint32_t i = 0; i < kNumScopes; ++i) {
+    LogCounters(log_, ScopeName(i), scope_counters_[i]);
+  }
+}
+
+VKAPI_ATTR void* VKAPI_CALL DriverMemoryTracker::Allocate(
+    void* user_data, size_t size, size_t alignment,
+    VkSystemAllocationScope scope) {
+  ObjectTypeCallbacks* callbacks =
+      reinterpret_cast<ObjectTypeCallbacks*>(user_data);
+  return callbacks->tracker->DoAllocate(callbacks->object_type, size,
+                                        alignment, scope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL DriverMemoryTracker::Reallocate(
+    void* user_data, void* original, size_t size, size_t alignment,
+    VkSystemAllocationScope scope) {
+  ObjectTypeCallbacks* callbacks =
+      reinterpret_cast<ObjectTypeCallbacks*>(user_data);
+  if (!original) {
+    return callbacks->tracker->DoAllocate(callbacks->object_type, size,
+                                          alignment, scope);
+  }
+  if (size == 0) {
+    callbacks->tracker->DoFree(original);
+    return nullptr;
+  }
+  // The memory stays charged to the type it was first allocated for.
+  AllocationHeader* header = GetHeader(original);
+  void* memory =
+      callbacks->tracker->DoAllocate(header->object_type, size, alignment,
+                                     scope);
+  if (memory) {
+    memcpy(memory, original, size < header->size ? size : header->size);
+    callbacks->tracker->DoFree(original);
+  }
+  return memory;
+}
+
+VKAPI_ATTR void VKAPI_CALL DriverMemoryTracker::Free(void* user_data,
+                                                     void* memory) {
+  if (memory) {
+    reinterpret_cast<ObjectTypeCallbacks*>(user_data)->tracker->DoFree(memory);
+  }
+}
+
+VKAPI_ATTR void VKAPI_CALL DriverMemoryTracker::InternalAllocation(
+    void* user_data, size_t size, VkInternalAllocationType,
+    VkSystemAllocationScope scope) {
+  ObjectTypeCallbacks* callbacks =
+      reinterpret_cast<ObjectTypeCallbacks*>(user_data);
+  std::lock_guard<std::mutex> lock(callbacks->tracker->mutex_);
+  callbacks->tracker->Add(callbacks->object_type, scope, size);
+}
+
+VKAPI_ATTR void VKAPI_CALL DriverMemoryTracker::InternalFree(
+    void* user_data, size_t size, VkInternalAllocationType,
+    VkSystemAllocationScope scope) {
+  ObjectTypeCallbacks* callbacks =
+      reinterpret_cast<ObjectTypeCallbacks*>(user_data);
+  std::lock_guard<std::mutex> lock(callbacks->tracker->mutex_);
+  callbacks->tracker->Remove(callbacks->object_type, scope, size);
+}
+
+void* DriverMemoryTracker::DoAllocate(uint32_t object_type, size_t size,
+                                      size_t alignment,
+                                      VkSystemAllocationScope scope) {
+  if (alignment < kMinAlignment) {
+    alignment = kMinAlignment;
+  }
+  // Leave room for the header, and for aligning the memory after it.
+  const size_t block_size = size + sizeof(AllocationHeader) + alignment - 1;
+  void* block = allocator_->malloc(block_size);
+  if (!block) {
+    return nullptr;
+  }
+  uintptr_t address =
+      reinterpret_cast<uintptr_t>(block) + sizeof(AllocationHeader);
+  address = (address + alignment - 1) & ~(uintptr_t(alignment) - 1);
+  void* memory = reinterpret_cast<void*>(address);
+  *GetHeader(memory) = {block, block_size, size, object_type,
+                        static_cast<uint32_t>(scope)};
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  Add(object_type, scope, size);
+  return memory;
+}
+
+void DriverMemoryTracker::DoFree(void* memory) {
+  AllocationHeader header = *GetHeader(memory);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Remove(header.object_type, header.scope, header.size);
+  }
+  allocator_->free(header.block, header.block_size);
+}
+
+void DriverMemoryTracker::Add(uint32_t object_type, uint32_t scope,
+                              size_t size) {
+  Counters* counters[2] = {&object_type_counters_[object_type],
+                           &scope_counters_[scope]};
+  for (Counters* c : counters) {
+    c->current_bytes += size;
+    if (c->current_bytes > c->peak_bytes) {
+      c->peak_bytes = c->current_bytes;
+    }
+    c->total_bytes += size;
+    c->allocations += 1;
+    c->frame_bytes += size;
+    c->frame_allocations += 1;
+  }
+}
+
+void DriverMemoryTracker::Remove(uint32_t object_type, uint32_t scope,
+                                 size_t size) {
+  object_type_counters_[object_type].current_bytes -= size;
+  scope_counters_[scope].current_bytes -= size;
+}
+
+const VkAllocationCallbacks* GetDriverAllocator(VkDevice* device,
+                                                VkObjectType type) {
+  const VkAllocationCallbacks* callbacks = device->allocator();
+  if (!callbacks ||
+      callbacks->pfnAllocation != &DriverMemoryTracker::Allocate) {
+    return callbacks;
+  }
+  return reinterpret_cast<DriverMemoryTracker::ObjectTypeCallbacks*>(
+             callbacks->pUserData)
+      ->tracker->callbacks(type);
+}
+
+}  // namespace vulkan
@@ -0,0 +1,132 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_HELPERS_DRIVER_MEMORY_TRACKER_H_
+#define VULKAN_HELPERS_DRIVER_MEMORY_TRACKER_H_
+
+#include <cstdint>
+#include <mutex>
+
+#include "support/containers/allocator.h"
+#include "support/log/log.h"
+#include "vulkan_helpers/vulkan_header_wrapper.h"
+#include "vulkan_wrapper/device_wrapper.h"
+
+namespace vulkan {
+
+// DriverMemoryTracker implements VkAllocationCallbacks on top of a
+// containers::Allocator, so that the host memory the driver allocates for us
+// is visible to the allocator, and is counted per object type and per
+// VkSystemAllocationScope.
+// There is one set of callbacks per object type, and everything allocated
+// through it, including the driver's internal allocations, is charged to
+// that type. Any of the callbacks can free or reallocate memory allocated by
+// any other, so objects created with the callbacks of one type can be
+// destroyed with those of their device.
+// All of the callbacks are thread-safe.
+class DriverMemoryTracker {
+ public:
+  struct Counters {
+    // Bytes that are currently allocated.
+    size_t current_bytes;
+    // The largest current_bytes has ever been.
+    size_t peak_bytes;
+    // All of the bytes, and allocations, ever made.
+    uint64_t total_bytes;
+    uint64_t allocations;
+    // The bytes and allocations made since the last EndFrame.
+    uint64_t frame_bytes;
+    uint64_t frame_allocations;
+    // The most bytes, and allocations, made in any one frame.
+    uint64_t peak_frame_bytes;
+    uint64_t peak_frame_allocations;
+  };
+
+  DriverMemoryTracker(containers::Allocator* allocator, logging::Logger* log);
+  DriverMemoryTracker(const DriverMemoryTracker&) = delete;
+  DriverMemoryTracker& operator=(const DriverMemoryTracker&) = delete;
+  // Logs the final report.
+  ~DriverMemoryTracker();
+
+  // Returns the callbacks that charge allocations to |type|. Object types
+  // that are not part of core Vulkan 1.0 are counted as
+  // VK_OBJECT_TYPE_UNKNOWN.
+  const VkAllocationCallbacks* callbacks(VkObjectType type) const;
+
+  // Ends the current frame, and starts counting the next.
+  void EndFrame();
+
+  Counters object_type_counters(VkObjectType type) const;
+  Counters scope_counters(VkSystemAllocationScope scope) const;
+
+  // Logs the counters of every object type and scope that allocated memory.
+  void LogReport() const;
+
+ private:
+  static const uint32_t kNumObjectTypes = VK_OBJECT_TYPE_COMMAND_POOL + 1;
+  static const uint32_t kNumScopes = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+  // The pUserData of each set of callbacks.
+  struct ObjectTypeCallbacks {
+    DriverMemoryTracker* tracker;
+    uint32_t object_type;
+  };
+
+  static VKAPI_ATTR void* VKAPI_CALL Allocate(void* user_data, size_t size,
+                                              size_t alignment,
+                                              VkSystemAllocationScope scope);
+  static VKAPI_ATTR void* VKAPI_CALL Reallocate(void* user_data,
+                                                void* original, size_t size,
+                                                size_t alignment,
+                                                VkSystemAllocationScope scope);
+  static VKAPI_ATTR void VKAPI_CALL Free(void* user_data, void* memory);
+  static VKAPI_ATTR void VKAPI_CALL InternalAllocation(
+      void* user_data, size_t size, VkInternalAllocationType type,
+      VkSystemAllocationScope scope);
+  static VKAPI_ATTR void VKAPI_CALL InternalFree(
+      void* user_data, size_t size, VkInternalAllocationType type,
+      VkSystemAllocationScope scope);
+
+  void* DoAllocate(uint32_t object_type, size_t size, size_t alignment,
+                   VkSystemAllocationScope scope);
+  void DoFree(void* memory);
+  // Both must be called with mutex_ held.
+  void Add(uint32_t object_type, uint32_t scope, size_t size);
+  void Remove(uint32_t object_type, uint32_t scope, size_t size);
+
+  containers::Allocator* allocator_;
+  logging::Logger* log_;
+  mutable std::mutex mutex_;
+  ObjectTypeCallbacks user_data_[kNumObjectTypes];
+  VkAllocationCallbacks callbacks_[kNumObjectTypes];
+  Counters object_type_counters_[kNumObjectTypes];
+  Counters scope_counters_[kNumScopes];
+  uint64_t frames_;
+
+  friend const VkAllocationCallbacks* GetDriverAllocator(VkDevice* device,
+                                                         VkObjectType type);
+};
+
+// Returns the callbacks to create an object of |type| from |device| with. If
+// |device| was created with the callbacks of a DriverMemoryTracker, these
+// charge the allocations of the object to |type|; otherwise these are the
+// callbacks of the device, usually nullptr. Either way the object can be
+// destroyed with the callbacks of the device.
+const VkAllocationCallbacks* GetDriverAllocator(VkDevice* device,
+                                                VkObjectType type);
+
+}  // namespace vulkan
+
+#endif  // VULKAN_HELPERS_DRIVER_MEMORY_TRACKER_H_
@@ -103,6 +103,50 @@ VkInstance CreateDefaultInstance(containers::Allocator* allocator,
   return vulkan::VkInstance(allocator, raw_instance, nullptr, wrapper);
 }
 
+namespace {
+// Returns the layer that CreateInstanceForApplication enables for |data|, or
+// nullptr if there is none.
+const char* ApplicationLayer(const entry::EntryData* data) {
+  if (data->output_frame_index() >= 0) {
+    return "CallbackSwapchain";
+  } else if (data->validation()) {
+    return "VK_LAYER_KHRONOS_validation";
+  }
+  return nullptr;
+}
+
+bool LayerHasInstanceExtension(containers::Allocator* allocator,
+                               LibraryWrapper* wrapper, const char* layer,
+                               const char* extension) {
+  uint32_t num_extensions = 0;
+  if (wrapper->vkEnumerateInstanceExtensionProperties(
+          layer, &num_extensions, nullptr) != VK_SUCCESS) {
+    return false;
+  }
+  containers::vector<VkExtensionProperties> available_extensions(allocator);
+  available_extensions.resize(num_extensions);
+  if (wrapper->vkEnumerateInstanceExtensionProperties(
+          layer, &num_extensions, available_extensions.data()) != VK_SUCCESS) {
+    return false;
+  }
+  return std::find_if(available_extensions.begin(),
+                      available_extensions.begin() + num_extensions,
+                      [&](const VkExtensionProperties& dat) {
+                        return strcmp(extension, dat.extensionName) == 0;
+                      }) != available_extensions.begin() + num_extensions;
+}
+}  // namespace
+
+bool InstanceExtensionAvailableForApplication(containers::Allocator* allocator,
+                                              LibraryWrapper* wrapper,
+                                              const entry::EntryData* data,
+                                              const char* extension) {
+  const char* layer = ApplicationLayer(data);
+  return LayerHasInstanceExtension(allocator, wrapper, nullptr, extension) ||
+         (layer &&
+          LayerHasInstanceExtension(allocator, wrapper, layer, extension));
+}
+
 VkInstance CreateVerisonedInstanceForApplicaiton(
     containers::Allocator* allocator, LibraryWrapper* wrapper,
     const entry::EntryData* data, uint32_t version,
@@ -136,15 +180,7 @@ VkInstance CreateVerisonedInstanceForApplicaiton(
   const auto num_default_extensions =
       sizeof(default_extensions) / sizeof(default_extensions[0]);
 
-  const char* validation_layer = "VK_LAYER_KHRONOS_validation";
-  const char* callback_layer = "CallbackSwapchain";
-  const char* layer = nullptr;
-
-  if (data->output_frame_index() >= 0) {
-    layer = callback_layer;
-  } else if (data->validation()) {
-		layer = validation_layer;
-  }
+  const char* layer = ApplicationLayer(data);
 
   std::vector<const char*> extensions;
   extensions.reserve(num_default_extensions + instance_extensions.size());
@@ -152,6 +188,21 @@ VkInstance CreateVerisonedInstanceForApplicaiton(
                     default_extensions + num_default_extensions);
   extensions.insert(extensions.end(), instance_extensions.begin(),
                     instance_extensions.end());
+  if (data->debug_labels() &&
+      std::find_if(extensions.begin(), extensions.end(),
+                   [](const char* extension) {
+                     return strcmp(extension,
+                                   VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0;
+                   }) == extensions.end()) {
+    if (InstanceExtensionAvailableForApplication(
+            allocator, wrapper, data, VK_EXT_DEBUG_UTILS_EXTENSION_NAME)) {
+      extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    } else {
+      wrapper->GetLogger()->LogInfo(VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+                                    " is not available, ignoring "
+                                    "-debug-labels");
+    }
+  }
 
   wrapper->GetLogger()->LogInfo("Enabled Instance Extensions: ");
   for (auto& extension : extensions) {
@@ -468,7 +519,8 @@ VkDevice CreateDeviceForSwapchain(
     const VkPhysicalDeviceFeatures& features,
     bool try_to_find_separate_present_queue,
     uint32_t* async_compute_queue_index, uint32_t* sparse_binding_queue_index,
-    bool use_host_query_reset, void* device_next) {
+    bool use_host_query_reset, void* device_next,
+    const VkAllocationCallbacks* device_allocator) {
   containers::vector<VkPhysicalDevice> physical_devices =
       GetPhysicalDevices(allocator, *instance);
   float priority = 1.f;
@@ -664,8 +716,8 @@ VkDevice CreateDeviceForSwapchain(
 
     ::VkDevice raw_device;
     LOG_ASSERT(==, instance->GetLogger(),
-               (*instance)->vkCreateDevice(physical_device, &info, nullptr,
-                                           &raw_device),
+               (*instance)->vkCreateDevice(physical_device, &info,
+                                           device_allocator, &raw_device),
                VK_SUCCESS);
 
     instance->GetLogger()->LogInfo("Enabled Device Extensions: ");
@@ -675,8 +727,9 @@ VkDevice CreateDeviceForSwapchain(
 
     *present_queue_index = present_queue_family_index;
     *graphics_queue_index = graphics_queue_family_index;
-    return vulkan::VkDevice(allocator, raw_device, nullptr, instance,
-                            &physical_device_properties, physical_device);
+    return vulkan::VkDevice(allocator, raw_device, device_allocator,
+                            instance, &physical_device_properties,
+                            physical_device);
   }
   instance->GetLogger()->LogError(
       "Could not find physical device or queue that can present");
@@ -823,7 +876,7 @@ VkDevice CreateDeviceGroupForSwapchain(
     const VkPhysicalDeviceFeatures& features,
     bool try_to_find_separate_present_queue,
     uint32_t* async_compute_queue_index, uint32_t* sparse_binding_queue_index,
-    void* device_next) {
+    void* device_next, const VkAllocationCallbacks* device_allocator) {
   uint32_t count = 0;
   LOG_ASSERT(
       ==, instance->GetLogger(), VK_SUCCESS,
@@ -924,7 +977,7 @@ VkDevice CreateDeviceGroupForSwapchain(
     ::VkDevice raw_device;
     LOG_ASSERT(==, instance->GetLogger(),
                (*instance)->vkCreateDevice(group.physicalDevices[0], &info,
-                                           nullptr, &raw_device),
+                                           device_allocator, &raw_device),
                VK_SUCCESS);
 
     instance->GetLogger()->LogInfo("Enabled Device Extensions: ");
@@ -941,8 +994,8 @@ VkDevice CreateDeviceGroupForSwapchain(
       *sparse_binding_queue_index = sparse_binding_queue_indices[0];
     }
 
-    return vulkan::VkDevice(allocator, raw_device, nullptr, instance, nullptr,
-                            group.physicalDevices[0],
+    return vulkan::VkDevice(allocator, raw_device, device_allocator,
+                            instance, nullptr, group.physicalDevices[0],
                             group.physicalDeviceCount);
   }
   instance->GetLogger()->LogError(
@@ -968,16 +1021,19 @@ VkCommandPool CreateDefaultCommandPool(containers::Allocator* allocator,
 
   ::VkCommandPool raw_command_pool = VK_NULL_HANDLE;
   if (device.is_valid()) {
-    LOG_ASSERT(
-        ==, device.GetLogger(),
-        device->vkCreateCommandPool(device, &info, nullptr, &raw_command_pool),
-        VK_SUCCESS);
+    LOG_ASSERT(==, device.GetLogger(),
+               device->vkCreateCommandPool(
+                   device, &info,
+                   GetDriverAllocator(&device, VK_OBJECT_TYPE_COMMAND_POOL),
+                   &raw_command_pool),
+               VK_SUCCESS);
   }
-  return vulkan::VkCommandPool(raw_command_pool, nullptr, &device);
+  return vulkan::VkCommandPool(raw_command_pool, device.allocator(), &device);
 }
 
 VkSurfaceKHR CreateDefaultSurface(VkInstance* instance,
-                                  const entry::EntryData* data) {
+                                  const entry::EntryData* data,
+                                  size_t window) {
   ::VkSurfaceKHR surface;
 #if defined __ANDROID__
   VkAndroidSurfaceCreateInfoKHR create_info{
@@ -996,7 +1052,7 @@ VkSurfaceKHR CreateDefaultSurface(VkInstance* instance,
 #elif defined __linux__
   VkXcbSurfaceCreateInfoKHR create_info{
       VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO_KHR, 0, 0,
-      data->native_connection(), data->native_window_handle()};
+      data->native_connection(), data->native_window_handle(window)};
 
   (*instance)->vkCreateXcbSurfaceKHR(*instance, &create_info, nullptr,
                                      &surface);
@@ -1041,17 +1097,38 @@ VkCommandBuffer CreateCommandBuffer(VkCommandPool* pool,
   return vulkan::VkCommandBuffer(raw_command_buffer, pool, device);
 }
 
+namespace {
+// Returns the present mode named by -present-mode, or
+// VK_PRESENT_MODE_MAX_ENUM_KHR for a name that is not known.
+VkPresentModeKHR GetPresentModeFromName(const char* name) {
+  if (strcmp(name, "fifo") == 0) {
+    return VK_PRESENT_MODE_FIFO_KHR;
+  }
+  if (strcmp(name, "fifo_relaxed") == 0) {
+    return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+  }
+  if (strcmp(name, "mailbox") == 0) {
+    return VK_PRESENT_MODE_MAILBOX_KHR;
+  }
+  if (strcmp(name, "immediate") == 0) {
+    return VK_PRESENT_MODE_IMMEDIATE_KHR;
+  }
+  return VK_PRESENT_MODE_MAX_ENUM_KHR;
+}
+}  // namespace
+
 VkSwapchainKHR CreateDefaultSwapchain(
     VkInstance* instance, VkDevice* device, VkSurfaceKHR* surface,
     containers::Allocator* allocator, uint32_t graphics_queue_index,
     uint32_t present_queue_index, const entry::EntryData* data,
     VkColorSpaceKHR swapchain_color_space, bool use_shared_presentation,
     VkSwapchainCreateFlagsKHR flags, bool use_10bit_hdr,
-    const void* extensions) {
+    const void* extensions, const VkExtent2D* extent) {
   ::VkSwapchainKHR swapchain = VK_NULL_HANDLE;
   VkExtent2D image_extent = {0, 0};
   containers::vector<VkSurfaceFormatKHR> surface_formats(allocator);
   surface_formats.resize(1);
+  VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
 
   if (device->is_valid()) {
     const bool has_multiple_queues =
@@ -1138,7 +1215,23 @@ VkSwapchainKHR CreateDefaultSwapchain(
 
     image_extent = surface_caps.currentExtent;
     if (image_extent.width == 0xFFFFFFFF) {
-      image_extent = VkExtent2D{data->width(), data->height()};
+      image_extent =
+          extent ? *extent : VkExtent2D{data->width(), data->height()};
+    }
+
+    present_mode = use_shared_presentation
+                       ? VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR
+                       : present_modes.front();
+    if (!use_shared_presentation && data->present_mode()) {
+      const VkPresentModeKHR requested =
+          GetPresentModeFromName(data->present_mode());
+      if (std::find(present_modes.begin(), present_modes.end(), requested) !=
+          present_modes.end()) {
+        present_mode = requested;
+      } else {
+        instance->GetLogger()->LogError("Present mode ", data->present_mode(),
+                                        " is not supported by the surface");
+      }
     }
 
     uint32_t maxSwapchains =
@@ -1154,8 +1247,11 @@ VkSwapchainKHR CreateDefaultSwapchain(
         extensions,                                   // pNext
         flags,                                        // flags
         *surface,                                     // surface
-        std::min(surface_caps.minImageCount + 1,
-                 maxSwapchains),        // minImageCount
+        // Shared presentable images come one per swapchain.
+        use_shared_presentation
+            ? 1u
+            : std::min(surface_caps.minImageCount + 1,
+                       maxSwapchains),  // minImageCount
         surface_formats[0].format,      // surfaceFormat
         surface_formats[0].colorSpace,  // colorSpace
         image_extent,                   // imageExtent
@@ -1169,10 +1265,9 @@ VkSwapchainKHR CreateDefaultSwapchain(
         surface_caps.currentTransform,           // preTransform,
         static_cast<VkCompositeAlphaFlagBitsKHR>(
             chosenAlpha),  // compositeAlpha
-        use_shared_presentation ? VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR
-                                : present_modes.front(),  // presentModes
-        false,                                            // clipped
-        VK_NULL_HANDLE                                    // oldSwapchain
+        present_mode,      // presentModes
+        false,             // clipped
+        VK_NULL_HANDLE     // oldSwapchain
     };
 
     LOG_ASSERT(==, instance->GetLogger(),
@@ -1182,7 +1277,8 @@ VkSwapchainKHR CreateDefaultSwapchain(
   }
 
   return VkSwapchainKHR(swapchain, nullptr, device, image_extent.width,
-                        image_extent.height, 1u, surface_formats[0].format);
+                        image_extent.height, 1u, surface_formats[0].format,
+                        present_mode);
 }
 
 VkImage CreateDefault2DColorImage(VkDevice* device, uint32_t width,
@@ -1211,9 +1307,11 @@ VkImage CreateDefault2DColorImage(VkDevice* device, uint32_t width,
   };
   ::VkImage raw_image;
   LOG_ASSERT(==, device->GetLogger(),
-             (*device)->vkCreateImage(*device, &info, nullptr, &raw_image),
+             (*device)->vkCreateImage(
+                 *device, &info,
+                 GetDriverAllocator(device, VK_OBJECT_TYPE_IMAGE), &raw_image),
              VK_SUCCESS);
-  return vulkan::VkImage(raw_image, nullptr, device);
+  return vulkan::VkImage(raw_image, device->allocator(), device);
 }
 
 VkSampler CreateDefaultSampler(VkDevice* device) {
@@ -1239,9 +1337,39 @@ VkSampler CreateDefaultSampler(VkDevice* device) {
   };
   ::VkSampler raw_sampler;
   LOG_ASSERT(==, device->GetLogger(),
-             (*device)->vkCreateSampler(*device, &info, nullptr, &raw_sampler),
+             (*device)->vkCreateSampler(
+                 *device, &info,
+                 GetDriverAllocator(device, VK_OBJECT_TYPE_SAMPLER),
+                 &raw_sampler),
              VK_SUCCESS);
-  return vulkan::VkSampler(raw_sampler, nullptr, device);
+  return vulkan::VkSampler(raw_sampler, device->allocator(), device);
+}
+
+VkSamplerCreateInfo GetSamplerCreateInfo(VkFilter minFilter,
+                                         VkFilter magFilter,
+                                         VkSamplerAddressMode addressModeU,
+                                         VkSamplerAddressMode addressModeV,
+                                         VkSamplerAddressMode addressModeW) {
+  return {
+      /* sType = */ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      /* pNext = */ nullptr,
+      /* flags = */ 0,
+      /* magFilter = */ magFilter,
+      /* minFilter = */ minFilter,
+      /* mipmapMode = */ VK_SAMPLER_MIPMAP_MODE_NEAREST,
+      /* addressModeU = */ addressModeU,
+      /* addressModeV = */ addressModeV,
+      /* addressModeW = */ addressModeW,
+      /* mipLodBias = */ 0.f,
+      /* anisotropyEnable = */ false,
+      /* maxAnisotropy = */ 1.f,
+      /* compareEnable = */ false,
+      /* compareOp = */ VK_COMPARE_OP_NEVER,
+      /* minLod = */ 0.f,
+      /* maxLod = */ 0.f,
+      /* borderColor = */ VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK,
+      /* unnormalizedCoordinates = */ false,
+  };
 }
 
 VkSampler CreateSampler(VkDevice* device, VkFilter minFilter,
@@ -1270,9 +1398,12 @@ VkSampler CreateSampler(VkDevice* device, VkFilter minFilter,
   };
   ::VkSampler raw_sampler;
   LOG_ASSERT(==, device->GetLogger(),
-             (*device)->vkCreateSampler(*device, &info, nullptr, &raw_sampler),
+             (*device)->vkCreateSampler(
+                 *device, &info,
+                 GetDriverAllocator(device, VK_OBJECT_TYPE_SAMPLER),
+                 &raw_sampler),
              VK_SUCCESS);
-  return vulkan::VkSampler(raw_sampler, nullptr, device);
+  return vulkan::VkSampler(raw_sampler, device->allocator(), device);
 }
 
 VkDescriptorSetLayout CreateDescriptorSetLayout(
@@ -1296,8 +1427,10 @@ VkDescriptorSetLayout CreateDescriptorSetLayout(
   LOG_ASSERT(
       ==, device->GetLogger(), VK_SUCCESS,
       (*device)->vkCreateDescriptorSetLayout(
-          *device, &descriptor_set_layout_create_info, nullptr, &layout));
-  return VkDescriptorSetLayout(layout, nullptr, device);
+          *device, &descriptor_set_layout_create_info,
+          GetDriverAllocator(device, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
+          &layout));
+  return VkDescriptorSetLayout(layout, device->allocator(), device);
 }
 
 // Creates a default pipeline cache, it does not load anything from disk.
@@ -1328,10 +1461,12 @@ VkPipelineCache CreateDefaultPipelineCache(VkDevice* device, const entry::EntryD
   };
   if (device->is_valid()) {
     LOG_ASSERT(==, device->GetLogger(), VK_SUCCESS,
-               (*device)->vkCreatePipelineCache(*device, &create_info, nullptr,
-                                                &cache));
+               (*device)->vkCreatePipelineCache(
+                   *device, &create_info,
+                   GetDriverAllocator(device, VK_OBJECT_TYPE_PIPELINE_CACHE),
+                   &cache));
   }
-  return VkPipelineCache(cache, nullptr, device);
+  return VkPipelineCache(cache, device->allocator(), device);
 }
 
 // Writes the given pipeline cache to the given location on disk.
@@ -1354,10 +1489,12 @@ VkQueryPool CreateQueryPool(VkDevice* device,
   ::VkQueryPool query_pool = VK_NULL_HANDLE;
   if (device->is_valid()) {
     LOG_ASSERT(==, device->GetLogger(), VK_SUCCESS,
-               (*device)->vkCreateQueryPool(*device, &create_info, nullptr,
-                                            &query_pool));
+               (*device)->vkCreateQueryPool(
+                   *device, &create_info,
+                   GetDriverAllocator(device, VK_OBJECT_TYPE_QUERY_POOL),
+                   &query_pool));
   }
-  return VkQueryPool(query_pool, nullptr, device);
+  return VkQueryPool(query_pool, device->allocator(), device);
 }
 
 VkDescriptorPool CreateDescriptorPool(VkDevice* device, uint32_t num_pool_size,
@@ -1372,11 +1509,13 @@ VkDescriptorPool CreateDescriptorPool(VkDevice* device, uint32_t num_pool_size,
       /* pPoolSizes = */ pool_sizes};
 
   ::VkDescriptorPool raw_pool;
-  LOG_ASSERT(
-      ==, device->GetLogger(),
-      (*device)->vkCreateDescriptorPool(*device, &info, nullptr, &raw_pool),
-      VK_SUCCESS);
-  return vulkan::VkDescriptorPool(raw_pool, nullptr, device);
+  LOG_ASSERT(==, device->GetLogger(),
+             (*device)->vkCreateDescriptorPool(
+                 *device, &info,
+                 GetDriverAllocator(device, VK_OBJECT_TYPE_DESCRIPTOR_POOL),
+                 &raw_pool),
+             VK_SUCCESS);
+  return vulkan::VkDescriptorPool(raw_pool, device->allocator(), device);
 }
 
 VkDescriptorSetLayout CreateDescriptorSetLayout(VkDevice* device,
@@ -1399,10 +1538,14 @@ VkDescriptorSetLayout CreateDescriptorSetLayout(VkDevice* device,
 
   ::VkDescriptorSetLayout raw_layout;
   LOG_ASSERT(==, device->GetLogger(),
-             (*device)->vkCreateDescriptorSetLayout(*device, &info, nullptr,
-                                                    &raw_layout),
+             (*device)->vkCreateDescriptorSetLayout(
+                 *device, &info,
+                 GetDriverAllocator(device,
+                                    VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT),
+                 &raw_layout),
              VK_SUCCESS);
-  return vulkan::VkDescriptorSetLayout(raw_layout, nullptr, device);
+  return vulkan::VkDescriptorSetLayout(raw_layout, device->allocator(),
+                                       device);
 }
 
 VkDescriptorSet AllocateDescriptorSet(VkDevice* device, ::VkDescriptorPool pool,
@@ -1432,11 +1575,13 @@ VkDeviceMemory AllocateDeviceMemory(VkDevice* device,
       /* memoryTypeIndex = */ memory_type_index,
   };
   ::VkDeviceMemory raw_memory;
-  LOG_ASSERT(
-      ==, device->GetLogger(),
-      (*device)->vkAllocateMemory(*device, &alloc_info, nullptr, &raw_memory),
-      VK_SUCCESS);
-  return vulkan::VkDeviceMemory(raw_memory, nullptr, device);
+  LOG_ASSERT(==, device->GetLogger(),
+             (*device)->vkAllocateMemory(
+                 *device, &alloc_info,
+                 GetDriverAllocator(device, VK_OBJECT_TYPE_DEVICE_MEMORY),
+                 &raw_memory),
+             VK_SUCCESS);
+  return vulkan::VkDeviceMemory(raw_memory, device->allocator(), device);
 }
 
 void RecordImageLayoutTransition(
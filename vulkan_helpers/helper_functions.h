@@ -21,6 +21,7 @@
 
 #include "support/containers/vector.h"
 #include "support/entry/entry.h"
+#include "vulkan_helpers/driver_memory_tracker.h"
 #include "vulkan_wrapper/command_buffer_wrapper.h"
 #include "vulkan_wrapper/descriptor_set_wrapper.h"
 #include "vulkan_wrapper/device_wrapper.h"
@@ -68,6 +69,14 @@ VkInstance Create11InstanceForApplication(
     const entry::EntryData* data,
     const std::initializer_list<const char*> extensions);
 
+// Returns true if the instance extension |extension| can be enabled by
+// CreateInstanceForApplication for |data|, either because the loader provides
+// it or because the layer enabled for |data| does.
+bool InstanceExtensionAvailableForApplication(containers::Allocator* allocator,
+                                              LibraryWrapper* wrapper,
+                                              const entry::EntryData* data,
+                                              const char* extension);
+
 containers::vector<VkPhysicalDevice> GetPhysicalDevices(
     containers::Allocator* allocator, VkInstance& instance);
 
@@ -109,9 +118,10 @@ VkCommandPool CreateDefaultCommandPool(containers::Allocator* allocator,
                                        uint32_t queueFamilyIndex = 0);
 
 // Creates a surface to render into the the default window
-// provided in entry_data.
+// provided in entry_data, or into one of the windows added to it.
 VkSurfaceKHR CreateDefaultSurface(VkInstance* instance,
-                                  const entry::EntryData* entry_data);
+                                  const entry::EntryData* entry_data,
+                                  size_t window = 0);
 
 // Creates a device capable of presenting to the given surface.
 // The device is created with the given extensions.
@@ -135,7 +145,8 @@ VkDevice CreateDeviceForSwapchain(
     bool try_to_find_separate_present_queue = false,
     uint32_t* aync_compute_queue_index = nullptr,
     uint32_t* sparse_binding_queue_index = nullptr,
-    bool use_host_query_reset = false, void* device_next = nullptr);
+    bool use_host_query_reset = false, void* device_next = nullptr,
+    const VkAllocationCallbacks* device_allocator = nullptr);
 
 // Creates a device capable of presenting to the given surface.
 // The device is created with the given extensions.
@@ -159,7 +170,8 @@ VkDevice CreateDeviceGroupForSwapchain(
     bool try_to_find_separate_present_queue = false,
     uint32_t* aync_compute_queue_index = nullptr,
     uint32_t* sparse_binding_queue_index = nullptr,
-    void* device_next = nullptr);
+    void* device_next = nullptr,
+    const VkAllocationCallbacks* device_allocator = nullptr);
 
 // Creates a primary level default command buffer from the given command pool
 // and the device.
@@ -175,13 +187,16 @@ VkCommandBuffer CreateCommandBuffer(VkCommandPool* pool,
 // Creates a swapchain with a default layout and number of images.
 // It will be able to be rendered to from graphics_queue_index,
 // and it will be presentable on present_queue_index.
+// If the surface leaves the size of the images to the swapchain, they are
+// |extent|, or the window size in |data| if that is nullptr.
 VkSwapchainKHR CreateDefaultSwapchain(
     VkInstance* instance, VkDevice* device, VkSurfaceKHR* surface,
     containers::Allocator* allocator, uint32_t present_queue_index,
     uint32_t graphics_queue_index, const entry::EntryData* data,
     VkColorSpaceKHR swapchain_color_space = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
     bool use_shared_presentation = false, VkSwapchainCreateFlagsKHR flags = 0,
-    bool use_10bit_hdr = false, const void* extensions = nullptr);
+    bool use_10bit_hdr = false, const void* extensions = nullptr,
+    const VkExtent2D* extent = nullptr);
 
 // Returns a uint32_t with only the lowest bit set.
 uint32_t inline GetLSB(uint32_t val) { return ((val - 1) ^ val) & val; }
@@ -200,6 +215,15 @@ VkImage CreateDefault2DColorImage(VkDevice* device, uint32_t width,
 // anisotropy and compare is disabled.
 VkSampler CreateDefaultSampler(VkDevice* device);
 
+// Returns the create info for a sampler as above, but with the specified
+// minFilter, magFilter and addressModes. This is suitable for
+// VulkanApplication::GetCachedSampler.
+VkSamplerCreateInfo GetSamplerCreateInfo(
+    VkFilter minFilter, VkFilter magFilter,
+    VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+    VkSamplerAddressMode addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+    VkSamplerAddressMode addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+
 // Creates a default sampler as above, but with the specified minFilter,
 // magFilter, addressModes, and extension.
 VkSampler CreateSampler(
@@ -251,9 +275,11 @@ VkShaderModule CreateShaderModule(VkDevice* device,
   };
   ::VkShaderModule raw_shader_module;
   LOG_ASSERT(==, device->GetLogger(), VK_SUCCESS,
-             (*device)->vkCreateShaderModule(*device, &create_info, nullptr,
-                                             &raw_shader_module));
-  return VkShaderModule(raw_shader_module, nullptr, device);
+             (*device)->vkCreateShaderModule(
+                 *device, &create_info,
+                 GetDriverAllocator(device, VK_OBJECT_TYPE_SHADER_MODULE),
+                 &raw_shader_module));
+  return VkShaderModule(raw_shader_module, device->allocator(), device);
 }
 
 // Returns the "index" queue from the given queue_family.
@@ -333,10 +359,11 @@ inline VkFence CreateFence(VkDevice* device, bool signaled = false) {
       nullptr,                                                         // pNext
       signaled ? VkFenceCreateFlags(VK_FENCE_CREATE_SIGNALED_BIT) : 0  // flags
   };
-  LOG_ASSERT(
-      ==, device->GetLogger(), VK_SUCCESS,
-      (*device)->vkCreateFence(*device, &create_info, nullptr, &raw_fence));
-  return VkFence(raw_fence, nullptr, device);
+  LOG_ASSERT(==, device->GetLogger(), VK_SUCCESS,
+             (*device)->vkCreateFence(
+                 *device, &create_info,
+                 GetDriverAllocator(device, VK_OBJECT_TYPE_FENCE), &raw_fence));
+  return VkFence(raw_fence, device->allocator(), device);
 }
 
 inline VkSemaphore CreateSemaphore(VkDevice* device) {
@@ -347,9 +374,11 @@ inline VkSemaphore CreateSemaphore(VkDevice* device) {
       0,                                        // flags
   };
   LOG_ASSERT(==, device->GetLogger(), VK_SUCCESS,
-             (*device)->vkCreateSemaphore(*device, &create_info, nullptr,
-                                          &raw_semaphore));
-  return VkSemaphore(raw_semaphore, nullptr, device);
+             (*device)->vkCreateSemaphore(
+                 *device, &create_info,
+                 GetDriverAllocator(device, VK_OBJECT_TYPE_SEMAPHORE),
+                 &raw_semaphore));
+  return VkSemaphore(raw_semaphore, device->allocator(), device);
 }
 
 inline VkSemaphore CreateTimelineSemaphore(VkDevice* device, uint64_t initial_value) {
@@ -368,9 +397,11 @@ inline VkSemaphore CreateTimelineSemaphore(VkDevice* device, uint64_t initial_va
       0,                                        // flags
   };
   LOG_ASSERT(==, device->GetLogger(), VK_SUCCESS,
-             (*device)->vkCreateSemaphore(*device, &create_info, nullptr,
-                                          &raw_semaphore));
-  return VkSemaphore(raw_semaphore, nullptr, device);
+             (*device)->vkCreateSemaphore(
+                 *device, &create_info,
+                 GetDriverAllocator(device, VK_OBJECT_TYPE_SEMAPHORE),
+                 &raw_semaphore));
+  return VkSemaphore(raw_semaphore, device->allocator(), device);
 }
 
 inline VkEvent CreateEvent(VkDevice* device) {
@@ -380,10 +411,11 @@ inline VkEvent CreateEvent(VkDevice* device) {
       nullptr,                              // pNext
       0,                                    // flags
   };
-  LOG_ASSERT(
-      ==, device->GetLogger(), VK_SUCCESS,
-      (*device)->vkCreateEvent(*device, &create_info, nullptr, &raw_event));
-  return VkEvent(raw_event, nullptr, device);
+  LOG_ASSERT(==, device->GetLogger(), VK_SUCCESS,
+             (*device)->vkCreateEvent(
+                 *device, &create_info,
+                 GetDriverAllocator(device, VK_OBJECT_TYPE_EVENT), &raw_event));
+  return VkEvent(raw_event, device->allocator(), device);
 }
 
 // Returns the size of the given image extent specified through width, height,
@@ -0,0 +1,202 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vulkan_helpers/image_layout_tracker.h"
+
+namespace vulkan {
+namespace {
+const VkAccessFlags kWriteAccessBits =
+    VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+bool SameState(const ImageSubresourceState& a,
+               const ImageSubresourceState& b) {
+  return a.layout == b.layout && a.access == b.access &&
+         a.stages == b.stages && a.visible_access == b.visible_access &&
+         a.visible_stages == b.visible_stages;
+}
+
+// Returns true if moving from |state| to the given layout, access and stages
+// needs a barrier.
+bool NeedsBarrier(const ImageSubresourceState& state, VkImageLayout layout,
+                  VkAccessFlags access, VkPipelineStageFlags stages) {
+  if (state.layout != layout) {
+    return true;
+  }
+  if ((state.access & kWriteAccessBits) || (access & kWriteAccessBits)) {
+    return true;
+  }
+  // Read after read is only hazard-free if the last write is already
+  // visible to the new read.
+  return (access & ~state.visible_access) || (stages & ~state.visible_stages);
+}
+}  // anonymous namespace
+
+ImageLayoutTracker::ImageLayoutTracker(containers::Allocator* allocator,
+                                       logging::Logger* log,
+                                       uint32_t mip_levels,
+                                       uint32_t array_layers,
+                                       VkImageLayout initial_layout)
+    : allocator_(allocator),
+      log_(log),
+      mip_levels_(mip_levels),
+      array_layers_(array_layers),
+      validate_(false),
+      // Nothing has been written yet, so there is nothing to make visible.
+      states_(mip_levels * array_layers,
+              ImageSubresourceState{initial_layout, 0, 0, ~VkAccessFlags(0),
+                                    ~VkPipelineStageFlags(0)},
+              allocator) {}
+
+uint32_t ImageLayoutTracker::level_count(
+    const VkImageSubresourceRange& range) const {
+  return range.levelCount == VK_REMAINING_MIP_LEVELS
+             ? mip_levels_ - range.baseMipLevel
+             : range.levelCount;
+}
+
+uint32_t ImageLayoutTracker::layer_count(
+    const VkImageSubresourceRange& range) const {
+  return range.layerCount == VK_REMAINING_ARRAY_LAYERS
+             ? array_layers_ - range.baseArrayLayer
+             : range.layerCount;
+}
+
+void ImageLayoutTracker::Transition(
+    ::VkImage image, const VkImageSubresourceRange& range,
+    VkImageLayout new_layout, VkAccessFlags dst_access,
+    VkPipelineStageFlags dst_stages,
+    containers::vector<VkImageMemoryBarrier>* barriers,
+    VkPipelineStageFlags* src_stages) {
+  const uint32_t levels = level_count(range);
+  const uint32_t layers = layer_count(range);
+  LOG_ASSERT(<=, log_, range.baseMipLevel + levels, mip_levels_);
+  LOG_ASSERT(<=, log_, range.baseArrayLayer + layers, array_layers_);
+
+  for (uint32_t mip = range.baseMipLevel; mip < range.baseMipLevel + levels;
+       ++mip) {
+    uint32_t layer = range.baseArrayLayer;
+    const uint32_t end_layer = range.baseArrayLayer + layers;
+    while (layer < end_layer) {
+      ImageSubresourceState& first = states_[mip * array_layers_ + layer];
+      if (!NeedsBarrier(first, new_layout, dst_access, dst_stages)) {
+        first.access |= dst_access;
+        first.stages |= dst_stages;
+        ++layer;
+        continue;
+      }
+      // Gather the run of layers that share the same state, so they can go
+      // in a single barrier.
+      const ImageSubresourceState old_state = first;
+      uint32_t run_end = layer + 1;
+      while (run_end < end_layer &&
+             SameState(states_[mip * array_layers_ + run_end], old_state)) {
+        ++run_end;
+      }
+      barriers->push_back(VkImageMemoryBarrier{
+          VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,  // sType
+          nullptr,                                 // pNext
+          old_state.access & kWriteAccessBits,     // srcAccessMask
+          dst_access,                              // dstAccessMask
+          old_state.layout,                        // oldLayout
+          new_layout,                              // newLayout
+          VK_QUEUE_FAMILY_IGNORED,                 // srcQueueFamilyIndex
+          VK_QUEUE_FAMILY_IGNORED,                 // dstQueueFamilyIndex
+          image,                                   // image
+          {range.aspectMask, mip, 1, layer, run_end - layer}});
+      *src_stages |= old_state.stages;
+      // A barrier between reads chains onto the one that made the last write
+      // visible, and makes it visible to the new reader as well.
+      const bool read_after_read = old_state.layout == new_layout &&
+                                   !(old_state.access & kWriteAccessBits) &&
+                                   !(dst_access & kWriteAccessBits);
+      const ImageSubresourceState new_state = {
+          new_layout, dst_access, dst_stages,
+          read_after_read ? old_state.visible_access | dst_access
+                          : dst_access,
+          read_after_read ? old_state.visible_stages | dst_stages
+                          : dst_stages};
+      for (; layer < run_end; ++layer) {
+        states_[mip * array_layers_ + layer] = new_state;
+      }
+    }
+  }
+}
+
+void ImageLayoutTracker::Record(VkCommandBuffer* command_buffer,
+                                ::VkImage image,
+                                const VkImageSubresourceRange& range,
+                                VkImageLayout new_layout,
+                                VkAccessFlags dst_access,
+                                VkPipelineStageFlags dst_stages) {
+  containers::vector<VkImageMemoryBarrier> barriers(allocator_);
+  VkPipelineStageFlags src_stages = 0;
+  Transition(image, range, new_layout, dst_access, dst_stages, &barriers,
+             &src_stages);
+  if (barriers.empty()) {
+    return;
+  }
+  (*command_buffer)
+      ->vkCmdPipelineBarrier(
+          *command_buffer,
+          src_stages ? src_stages
+                     : VkPipelineStageFlags(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+          dst_stages, 0, 0, nullptr, 0, nullptr,
+          static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+void ImageLayoutTracker::Assume(const VkImageSubresourceRange& range,
+                                VkImageLayout layout, VkAccessFlags access,
+                                VkPipelineStageFlags stages) {
+  const uint32_t levels = level_count(range);
+  const uint32_t layers = layer_count(range);
+  for (uint32_t mip = range.baseMipLevel; mip < range.baseMipLevel + levels;
+       ++mip) {
+    for (uint32_t layer = range.baseArrayLayer;
+         layer < range.baseArrayLayer + layers; ++layer) {
+      states_[mip * array_layers_ + layer] = {layout, access, stages, access,
+                                              stages};
+    }
+  }
+}
+
+void ImageLayoutTracker::Expect(const VkImageSubresourceRange& range,
+                                VkImageLayout layout) {
+  const uint32_t levels = level_count(range);
+  const uint32_t layers = layer_count(range);
+  for (uint32_t mip = range.baseMipLevel; mip < range.baseMipLevel + levels;
+       ++mip) {
+    for (uint32_t layer = range.baseArrayLayer;
+         layer < range.baseArrayLayer + layers; ++layer) {
+      ImageSubresourceState& state = states_[mip * array_layers_ + layer];
+      // Subresources the tracker has never seen used were most likely
+      // transitioned by a render pass, which is not an error.
+      if (validate_ && state.layout != layout &&
+          state.layout != VK_IMAGE_LAYOUT_UNDEFINED) {
+        log_->LogError("Image layout tracking mismatch at mip <", mip,
+                       "> layer <", layer, ">: tracked <", state.layout,
+                       "> but the caller expected <", layout, ">");
+      }
+      // Even with a matching layout, something the tracker did not see may
+      // have written to the subresource since.
+      state = {layout, kWriteAccessBits,
+               VkPipelineStageFlags(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT), 0, 0};
+    }
+  }
+}
+
+}  // namespace vulkan
@@ -0,0 +1,105 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_HELPERS_IMAGE_LAYOUT_TRACKER_H_
+#define VULKAN_HELPERS_IMAGE_LAYOUT_TRACKER_H_
+
+#include "support/containers/allocator.h"
+#include "support/containers/vector.h"
+#include "support/log/log.h"
+#include "vulkan_wrapper/command_buffer_wrapper.h"
+
+namespace vulkan {
+
+// The last known layout of an image subresource, along with the accesses and
+// pipeline stages that have used it since it was last synchronized, and the
+// accesses and stages that the last write has been made visible to.
+struct ImageSubresourceState {
+  VkImageLayout layout;
+  VkAccessFlags access;
+  VkPipelineStageFlags stages;
+  VkAccessFlags visible_access;
+  VkPipelineStageFlags visible_stages;
+};
+
+// Tracks the layout and access state of every mip level and array layer of a
+// single image, and generates the barriers needed to move subresources to a
+// new state.
+// The state follows the order in which commands are recorded, so command
+// buffers touching the image must be submitted in the order they were
+// recorded.
+class ImageLayoutTracker {
+ public:
+  ImageLayoutTracker(containers::Allocator* allocator, logging::Logger* log,
+                     uint32_t mip_levels, uint32_t array_layers,
+                     VkImageLayout initial_layout);
+
+  // If set, every Expect() call checks the caller's idea of the layout
+  // against the tracked one and logs any mismatch.
+  void set_validate(bool validate) { validate_ = validate; }
+
+  const ImageSubresourceState& state(uint32_t mip_level,
+                                     uint32_t array_layer) const {
+    return states_[mip_level * array_layers_ + array_layer];
+  }
+
+  // Appends the barriers needed for the subresources of |image| in |range| to
+  // be used in |new_layout| with |dst_access| in |dst_stages| to |barriers|,
+  // and ORs the stages they have to wait for into |src_stages|. Subresources
+  // that are already in |new_layout|, where neither the previous nor the new
+  // access writes, and where the last write has already been made visible to
+  // |dst_access| in |dst_stages|, get no barrier at all. The tracked state is
+  // updated.
+  void Transition(::VkImage image, const VkImageSubresourceRange& range,
+                  VkImageLayout new_layout, VkAccessFlags dst_access,
+                  VkPipelineStageFlags dst_stages,
+                  containers::vector<VkImageMemoryBarrier>* barriers,
+                  VkPipelineStageFlags* src_stages);
+
+  // Same as Transition, but records the barriers into |command_buffer|.
+  void Record(VkCommandBuffer* command_buffer, ::VkImage image,
+              const VkImageSubresourceRange& range, VkImageLayout new_layout,
+              VkAccessFlags dst_access, VkPipelineStageFlags dst_stages);
+
+  // Tells the tracker that the subresources in |range| were moved to the
+  // given state without going through it, e.g. by a render pass. If |access|
+  // does not write, it is taken to already see the last write.
+  void Assume(const VkImageSubresourceRange& range, VkImageLayout layout,
+              VkAccessFlags access, VkPipelineStageFlags stages);
+
+  // Tells the tracker that the caller believes the subresources in |range|
+  // to be in |layout|, after writes the tracker may not have seen, e.g. from
+  // a render pass or from a barrier recorded on the raw image. The tracked
+  // state is reset to |layout| with every write access at
+  // VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, so the next use always gets a
+  // barrier. Subresources that were tracked in another layout are reported
+  // if validation is enabled.
+  void Expect(const VkImageSubresourceRange& range, VkImageLayout layout);
+
+ private:
+  uint32_t level_count(const VkImageSubresourceRange& range) const;
+  uint32_t layer_count(const VkImageSubresourceRange& range) const;
+
+  containers::Allocator* allocator_;
+  logging::Logger* log_;
+  uint32_t mip_levels_;
+  uint32_t array_layers_;
+  bool validate_;
+  containers::vector<ImageSubresourceState> states_;
+};
+
+}  // namespace vulkan
+
+#endif  // VULKAN_HELPERS_IMAGE_LAYOUT_TRACKER_H_
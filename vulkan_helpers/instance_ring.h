@@ -0,0 +1,178 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_HELPERS_INSTANCE_RING_H_
+#define VULKAN_HELPERS_INSTANCE_RING_H_
+
+#include <cstring>
+#include <initializer_list>
+
+#include "support/containers/vector.h"
+#include "support/log/log.h"
+#include "vulkan_helpers/vulkan_application.h"
+
+namespace vulkan {
+
+// InstanceRing streams per-instance vertex attributes to the device. It owns
+// one persistently mapped, host-visible vertex buffer that is split into one
+// slot per buffered frame, typically one per swapchain image. Instances are
+// written straight into the slot for the frame, so there is no staging copy,
+// and the written range is handed to the application's MappedRangeBatcher
+// to be flushed together with everything else for the frame.
+// T can be any type that can be bitwise copied; it is read by the vertex
+// input stage as described by the InputStreams given to AddInputStream.
+//
+// Typical use:
+//   pipeline->SetInputStreams(&model);
+//   ring.AddInputStream(pipeline, {{3, VK_FORMAT_R32G32B32A32_SFLOAT, 0}});
+//   ...
+//   auto writer = ring.Begin(frame_index);
+//   writer.Append(instances.data(), instances.size());
+//   ring.End(writer);
+//   application->mapped_range_batcher()->Flush();
+//   ring.Bind(&cmd_buffer, frame_index);
+//   model.DrawInstanced(&cmd_buffer, ring.count(frame_index));
+//
+// The slot for a frame must not be written while the device may still be
+// reading it; the sample framework's per-frame fences take care of this.
+template <typename T>
+class InstanceRing {
+ public:
+  // Writes instances into one slot of the ring.
+  class Writer {
+   public:
+    // Appends one instance.
+    void push_back(const T& instance) {
+      LOG_ASSERT(<, log_, size_, capacity_);
+      data_[size_++] = instance;
+    }
+    // Reserves |count| instances at the end of the slot, and returns them so
+    // they can be written in place.
+    T* Append(size_t count) {
+      LOG_ASSERT(<=, log_, size_ + count, capacity_);
+      T* instances = data_ + size_;
+      size_ += count;
+      return instances;
+    }
+    // Copies |count| instances to the end of the slot with a single memcpy.
+    void Append(const T* instances, size_t count) {
+      memcpy(Append(count), instances, count * sizeof(T));
+    }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+
+   private:
+    friend class InstanceRing<T>;
+    Writer(logging::Logger* log, T* data, size_t capacity, size_t buffer_index)
+        : log_(log),
+          data_(data),
+          size_(0),
+          capacity_(capacity),
+          buffer_index_(buffer_index) {}
+
+    logging::Logger* log_;
+    T* data_;
+    size_t size_;
+    size_t capacity_;
+    size_t buffer_index_;
+  };
+
+  // |buffered_data_count| is the number of slots in the ring, and
+  // |max_instances| is the number of instances each slot can hold.
+  InstanceRing(VulkanApplication* application, size_t buffered_data_count,
+               size_t max_instances)
+      : application_(application),
+        max_instances_(max_instances),
+        slot_size_(AlignSlot(max_instances * sizeof(T))),
+        counts_(application->GetAllocator()),
+        binding_(0) {
+    counts_.insert(counts_.begin(), buffered_data_count, 0);
+    buffer_ = application_->CreateAndBindDefaultExclusiveHostBuffer(
+        slot_size_ * buffered_data_count, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+  }
+
+  // Adds the per-instance vertex input stream for T to |pipeline|, and
+  // remembers the binding it was given so that Bind uses the same one.
+  // Models always use the bindings from 0 up, so this must be called after
+  // the pipeline's SetInputStreams; SetInputStreams asserts this.
+  void AddInputStream(
+      VulkanGraphicsPipeline* pipeline,
+      std::initializer_list<VulkanGraphicsPipeline::InputStream> inputs) {
+    binding_ = pipeline->AddInputStream(
+        sizeof(T), VK_VERTEX_INPUT_RATE_INSTANCE, inputs);
+  }
+
+  // Starts writing the instances for the given slot. Whatever was written
+  // to it before is discarded.
+  Writer Begin(size_t buffer_index) {
+    counts_[buffer_index] = 0;
+    return Writer(application_->GetLogger(),
+                  reinterpret_cast<T*>(buffer_->base_address() +
+                                       buffer_index * slot_size_),
+                  max_instances_, buffer_index);
+  }
+
+  // Finishes writing a slot. The written instances are flushed the next
+  // time the application's MappedRangeBatcher is flushed.
+  void End(const Writer& writer) {
+    counts_[writer.buffer_index_] = writer.size_;
+    if (writer.size_ != 0) {
+      buffer_->defer_flush(writer.buffer_index_ * slot_size_,
+                           writer.size_ * sizeof(T));
+    }
+  }
+
+  // Replaces the contents of the given slot with |count| instances.
+  void Write(size_t buffer_index, const T* instances, size_t count) {
+    Writer writer = Begin(buffer_index);
+    writer.Append(instances, count);
+    End(writer);
+  }
+
+  // Binds the given slot as the per-instance vertex buffer.
+  void Bind(VkCommandBuffer* cmdBuffer, size_t buffer_index) const {
+    ::VkBuffer buffer = *buffer_;
+    ::VkDeviceSize offset = buffer_index * slot_size_;
+    (*cmdBuffer)->vkCmdBindVertexBuffers(*cmdBuffer, binding_, 1, &buffer,
+                                         &offset);
+  }
+
+  // The number of instances written to the given slot.
+  uint32_t count(size_t buffer_index) const {
+    return static_cast<uint32_t>(counts_[buffer_index]);
+  }
+  size_t max_instances() const { return max_instances_; }
+  uint32_t binding() const { return binding_; }
+
+ private:
+  // Keeps every slot aligned for any vertex attribute format, and to the
+  // largest nonCoherentAtomSize in practice, so that flushing one slot
+  // never touches the next.
+  static size_t AlignSlot(size_t size) {
+    const size_t kSlotAlignment = 256;
+    return (size + kSlotAlignment - 1) & ~(kSlotAlignment - 1);
+  }
+
+  VulkanApplication* application_;
+  size_t max_instances_;
+  size_t slot_size_;
+  containers::vector<size_t> counts_;
+  uint32_t binding_;
+  containers::unique_ptr<VulkanApplication::Buffer> buffer_;
+};
+
+}  // namespace vulkan
+
+#endif  // VULKAN_HELPERS_INSTANCE_RING_H_
@@ -0,0 +1,142 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vulkan_helpers/mapped_range_batcher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace vulkan {
+
+MappedRangeBatcher::MappedRangeBatcher(containers::Allocator* allocator,
+                                       VkDevice* device,
+                                       ::VkDeviceSize non_coherent_atom_size)
+    : device_(device),
+      non_coherent_atom_size_(non_coherent_atom_size),
+      pending_flushes_(allocator) {
+  ResetStats();
+}
+
+void MappedRangeBatcher::AddFlushRange(::VkDeviceMemory memory,
+                                       ::VkDeviceSize memory_size,
+                                       ::VkDeviceSize offset,
+                                       ::VkDeviceSize size) {
+  VkMappedMemoryRange range = {VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, nullptr,
+                               memory, offset, size};
+  Align(&range, memory_size);
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_flushes_.push_back(range);
+}
+
+void MappedRangeBatcher::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pending_flushes_.empty()) {
+    return;
+  }
+  stats_.flushed_bytes += Merge(&pending_flushes_);
+  stats_.flushed_ranges += pending_flushes_.size();
+  stats_.flush_calls += 1;
+  (*device_)->vkFlushMappedMemoryRanges(
+      *device_, static_cast<uint32_t>(pending_flushes_.size()),
+      pending_flushes_.data());
+  pending_flushes_.clear();
+}
+
+void MappedRangeBatcher::Invalidate(::VkDeviceMemory memory,
+                                    ::VkDeviceSize memory_size,
+                                    ::VkDeviceSize offset,
+                                    ::VkDeviceSize size) {
+  VkMappedMemoryRange range = {VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, nullptr,
+                               memory, offset, size};
+  Align(&range, memory_size);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.invalidate_calls += 1;
+    if (range.size != VK_WHOLE_SIZE) {
+      stats_.invalidated_bytes += range.size;
+    }
+  }
+  (*device_)->vkInvalidateMappedMemoryRanges(*device_, 1, &range);
+}
+
+MappedRangeBatcher::Stats MappedRangeBatcher::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void MappedRangeBatcher::ResetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+void MappedRangeBatcher::Align(VkMappedMemoryRange* range,
+                               ::VkDeviceSize memory_size) const {
+  const ::VkDeviceSize atom = non_coherent_atom_size_;
+  const ::VkDeviceSize offset = range->offset / atom * atom;
+  if (range->size != VK_WHOLE_SIZE) {
+    // A range may end in the middle of an atom only if it ends with the
+    // memory.
+    const ::VkDeviceSize end = std::min(
+        (range->offset + range->size + atom - 1) / atom * atom, memory_size);
+    range->size = end - offset;
+  }
+  range->offset = offset;
+}
+
+::VkDeviceSize MappedRangeBatcher::Merge(
+    containers::vector<VkMappedMemoryRange>* ranges) {
+  // Store the ranges, already aligned when they were added, as
+  // [offset, end) in the size field until they are merged.
+  for (auto& range : *ranges) {
+    if (range.size != VK_WHOLE_SIZE) {
+      range.size += range.offset;
+    }
+  }
+
+  std::sort(ranges->begin(), ranges->end(),
+            [](const VkMappedMemoryRange& a, const VkMappedMemoryRange& b) {
+              if (a.memory != b.memory) {
+                return std::less<::VkDeviceMemory>()(a.memory, b.memory);
+              }
+              return a.offset < b.offset;
+            });
+
+  ::VkDeviceSize bytes = 0;
+  size_t out = 0;
+  for (size_t i = 0; i < ranges->size(); ++i) {
+    VkMappedMemoryRange& range = (*ranges)[i];
+    if (i != 0) {
+      VkMappedMemoryRange& last = (*ranges)[out - 1];
+      if (last.memory == range.memory && range.offset <= last.size) {
+        last.size = std::max(last.size, range.size);
+        continue;
+      }
+    }
+    (*ranges)[out++] = range;
+  }
+  ranges->resize(out);
+
+  // Convert back from [offset, end) to offset and size.
+  for (auto& range : *ranges) {
+    if (range.size != VK_WHOLE_SIZE) {
+      range.size -= range.offset;
+      bytes += range.size;
+    }
+  }
+  return bytes;
+}
+
+}  // namespace vulkan
@@ -0,0 +1,88 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_HELPERS_MAPPED_RANGE_BATCHER_H_
+#define VULKAN_HELPERS_MAPPED_RANGE_BATCHER_H_
+
+#include <mutex>
+
+#include "support/containers/allocator.h"
+#include "support/containers/vector.h"
+#include "vulkan_wrapper/device_wrapper.h"
+
+namespace vulkan {
+
+// Collects ranges of mapped memory that need to be flushed, and hands them
+// to the driver in as few calls as possible. Ranges are expanded to
+// nonCoherentAtomSize, but never past the end of their VkDeviceMemory, then
+// adjacent and overlapping ranges in the same VkDeviceMemory are merged. Invalidations are not deferred, as only the
+// reader knows when the device is done writing; they are expanded and
+// counted the same way.
+// The sample framework flushes once per frame after Update, and again
+// before its last submission of the frame. Ranges added while recording
+// work that is submitted in between, e.g. in Sample::Render, must be
+// flushed by whoever submits it.
+// All of the methods may be called from any thread, e.g. from the worker
+// that runs a pipelined Update.
+class MappedRangeBatcher {
+ public:
+  struct Stats {
+    uint64_t flush_calls;
+    uint64_t flushed_ranges;
+    uint64_t flushed_bytes;
+    uint64_t invalidate_calls;
+    uint64_t invalidated_bytes;
+  };
+
+  MappedRangeBatcher(containers::Allocator* allocator, VkDevice* device,
+                     ::VkDeviceSize non_coherent_atom_size);
+
+  // Records that host writes to the given range must be flushed before the
+  // device reads them. |memory_size| is the allocation size of |memory|.
+  // |size| may be VK_WHOLE_SIZE.
+  void AddFlushRange(::VkDeviceMemory memory, ::VkDeviceSize memory_size,
+                     ::VkDeviceSize offset, ::VkDeviceSize size);
+
+  // Flushes all of the pending flush ranges with a single
+  // vkFlushMappedMemoryRanges call. Does nothing if none are pending.
+  void Flush();
+  // Invalidates the given range right away, so that device writes to it
+  // are visible to the host. |size| may be VK_WHOLE_SIZE.
+  void Invalidate(::VkDeviceMemory memory, ::VkDeviceSize memory_size,
+                  ::VkDeviceSize offset, ::VkDeviceSize size);
+
+  // Returns the statistics gathered since the last ResetStats().
+  Stats stats();
+  void ResetStats();
+
+ private:
+  // Expands |range| to whole nonCoherentAtomSize atoms, except that it ends
+  // at |memory_size| at the latest.
+  void Align(VkMappedMemoryRange* range, ::VkDeviceSize memory_size) const;
+  // Sorts and merges the aligned |ranges| in place. Returns the number of bytes
+  // covered by the merged ranges, not counting VK_WHOLE_SIZE ranges.
+  ::VkDeviceSize Merge(containers::vector<VkMappedMemoryRange>* ranges);
+
+  VkDevice* device_;
+  ::VkDeviceSize non_coherent_atom_size_;
+  // Guards everything below.
+  std::mutex mutex_;
+  containers::vector<VkMappedMemoryRange> pending_flushes_;
+  Stats stats_;
+};
+
+}  // namespace vulkan
+
+#endif  // VULKAN_HELPERS_MAPPED_RANGE_BATCHER_H_
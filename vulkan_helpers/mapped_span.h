@@ -0,0 +1,62 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_HELPERS_MAPPED_SPAN_H_
+#define VULKAN_HELPERS_MAPPED_SPAN_H_
+
+#include <cstddef>
+
+#include "support/log/log.h"
+
+namespace vulkan {
+
+// A typed, bounds-checked view of a contiguous range of mapped memory.
+// It does not own the memory, and must not outlive the buffer it was
+// created from.
+template <typename T>
+class MappedSpan {
+ public:
+  MappedSpan(logging::Logger* log, T* data, size_t size)
+      : log_(log), data_(data), size_(size) {}
+
+  T* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t size_bytes() const { return size_ * sizeof(T); }
+
+  T* begin() const { return data_; }
+  T* end() const { return data_ + size_; }
+
+  T& operator[](size_t index) const {
+    LOG_ASSERT(<, log_, index, size_);
+    return data_[index];
+  }
+
+  // Returns the view of |count| elements starting at |offset|.
+  MappedSpan<T> subspan(size_t offset, size_t count) const {
+    LOG_ASSERT(<=, log_, offset, size_);
+    LOG_ASSERT(<=, log_, count, size_ - offset);
+    return MappedSpan<T>(log_, data_ + offset, count);
+  }
+
+ private:
+  logging::Logger* log_;
+  T* data_;
+  size_t size_;
+};
+
+}  // namespace vulkan
+
+#endif  // VULKAN_HELPERS_MAPPED_SPAN_H_
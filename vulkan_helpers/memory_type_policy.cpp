@@ -0,0 +1,140 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vulkan_helpers/memory_type_policy.h"
+
+namespace vulkan {
+namespace {
+uint32_t CountBits(uint32_t val) {
+  uint32_t count = 0;
+  for (; val; val &= val - 1) {
+    ++count;
+  }
+  return count;
+}
+
+// The ranking key for a single memory type. Larger is better, compared
+// field by field.
+struct MemoryTypeRank {
+  bool fits;
+  uint32_t num_preferred;
+  uint32_t num_avoided;
+  ::VkDeviceSize heap_size;
+
+  bool operator>(const MemoryTypeRank& other) const {
+    if (fits != other.fits) return fits;
+    if (num_preferred != other.num_preferred)
+      return num_preferred > other.num_preferred;
+    if (num_avoided != other.num_avoided)
+      return num_avoided < other.num_avoided;
+    return heap_size > other.heap_size;
+  }
+};
+}  // anonymous namespace
+
+MemoryTypePolicy GetMemoryTypePolicy(MemoryUsage usage) {
+  switch (usage) {
+    case MemoryUsage::kStaging:
+      // Keep small host-visible device-local heaps (ReBAR) free for data that
+      // the GPU actually reads from the host mapping.
+      return {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1.0f};
+    case MemoryUsage::kReadback:
+      return {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+              VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 1.0f};
+    case MemoryUsage::kDynamicUniform:
+      // Host writes go straight into device-local memory where the device
+      // allows it, but never take more than half of such a heap.
+      return {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+              VK_MEMORY_PROPERTY_HOST_CACHED_BIT, 0.5f};
+    case MemoryUsage::kStaticDevice:
+      return {0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, 1.0f};
+    case MemoryUsage::kTransientAttachment:
+      return {VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, 1.0f};
+  }
+  return {0, 0, 0, 1.0f};
+}
+
+const char* GetMemoryUsageName(MemoryUsage usage) {
+  switch (usage) {
+    case MemoryUsage::kStaging:
+      return "staging";
+    case MemoryUsage::kReadback:
+      return "readback";
+    case MemoryUsage::kDynamicUniform:
+      return "dynamic uniform";
+    case MemoryUsage::kStaticDevice:
+      return "static device";
+    case MemoryUsage::kTransientAttachment:
+      return "transient attachment";
+  }
+  return "unknown";
+}
+
+uint32_t SelectMemoryType(VkDevice* device, logging::Logger* log,
+                          uint32_t memory_type_bits,
+                          const MemoryTypePolicy& policy, ::VkDeviceSize size,
+                          const char* name) {
+  const VkPhysicalDeviceMemoryProperties& properties =
+      device->physical_device_memory_properties();
+
+  uint32_t best_index = kInvalidMemoryTypeIndex;
+  MemoryTypeRank best_rank = {false, 0, 0, 0};
+  for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
+    if (!(memory_type_bits & (1 << i))) {
+      continue;
+    }
+    const VkMemoryPropertyFlags flags = properties.memoryTypes[i].propertyFlags;
+    if ((flags & policy.required) != policy.required) {
+      continue;
+    }
+    const ::VkDeviceSize heap_size =
+        properties.memoryHeaps[properties.memoryTypes[i].heapIndex].size;
+    MemoryTypeRank rank = {
+        static_cast<float>(size) <=
+            static_cast<float>(heap_size) * policy.max_heap_fraction,
+        CountBits(flags & policy.preferred), CountBits(flags & policy.avoided),
+        heap_size};
+    if (best_index == kInvalidMemoryTypeIndex || rank > best_rank) {
+      best_index = i;
+      best_rank = rank;
+    }
+  }
+
+  if (log) {
+    if (best_index == kInvalidMemoryTypeIndex) {
+      log->LogInfo("Memory policy <", name ? name : "custom",
+                   ">: no memory type has required flags <", policy.required,
+                   ">");
+    } else {
+      log->LogInfo(
+          "Memory policy <", name ? name : "custom", ">: selected type <",
+          best_index, "> flags <",
+          properties.memoryTypes[best_index].propertyFlags, "> heap <",
+          properties.memoryTypes[best_index].heapIndex, "> of <",
+          best_rank.heap_size, "> bytes",
+          best_rank.fits ? "" : " (allocation exceeds the heap budget)");
+    }
+  }
+  return best_index;
+}
+
+}  // namespace vulkan
@@ -0,0 +1,81 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_HELPERS_MEMORY_TYPE_POLICY_H_
+#define VULKAN_HELPERS_MEMORY_TYPE_POLICY_H_
+
+#include "support/log/log.h"
+#include "vulkan_wrapper/device_wrapper.h"
+
+namespace vulkan {
+
+// The broad classes of memory that the framework allocates arenas for.
+enum class MemoryUsage {
+  // Written once by the host and copied to device memory.
+  kStaging,
+  // Written by the device and read back by the host.
+  kReadback,
+  // Rewritten by the host every frame and read directly by shaders.
+  kDynamicUniform,
+  // Only ever touched by the device.
+  kStaticDevice,
+  // Render targets whose contents never leave the render pass.
+  kTransientAttachment,
+};
+
+// Describes how to rank memory types for a given MemoryUsage.
+// A memory type is only considered if it has all of the |required| flags.
+// Types whose heap can hold the allocation within |max_heap_fraction| of the
+// heap size are ranked first. After that, types with more |preferred| flags
+// win, then types with fewer |avoided| flags, then types on larger heaps.
+struct MemoryTypePolicy {
+  VkMemoryPropertyFlags required;
+  VkMemoryPropertyFlags preferred;
+  VkMemoryPropertyFlags avoided;
+  float max_heap_fraction;
+};
+
+const uint32_t kInvalidMemoryTypeIndex = 0xFFFFFFFF;
+
+// Returns the default policy for the given usage.
+MemoryTypePolicy GetMemoryTypePolicy(MemoryUsage usage);
+
+// Returns a human readable name for the given usage.
+const char* GetMemoryUsageName(MemoryUsage usage);
+
+// Returns the best memory type from |memory_type_bits| for an allocation of
+// |size| bytes according to |policy|, or kInvalidMemoryTypeIndex if no memory
+// type has the required flags. The selection is logged to |log|, if given.
+uint32_t SelectMemoryType(VkDevice* device, logging::Logger* log,
+                          uint32_t memory_type_bits,
+                          const MemoryTypePolicy& policy,
+                          ::VkDeviceSize size = 0,
+                          const char* name = nullptr);
+
+// Same as above, but uses the default policy for |usage|, with
+// |extra_required| added to the required flags.
+inline uint32_t SelectMemoryType(VkDevice* device, logging::Logger* log,
+                                 uint32_t memory_type_bits, MemoryUsage usage,
+                                 ::VkDeviceSize size = 0,
+                                 VkMemoryPropertyFlags extra_required = 0) {
+  MemoryTypePolicy policy = GetMemoryTypePolicy(usage);
+  policy.required |= extra_required;
+  return SelectMemoryType(device, log, memory_type_bits, policy, size,
+                          GetMemoryUsageName(usage));
+}
+
+}  // namespace vulkan
+
+#endif  // VULKAN_HELPERS_MEMORY_TYPE_POLICY_H_
@@ -0,0 +1,247 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_HELPERS_MESH_POOL_H_
+#define VULKAN_HELPERS_MESH_POOL_H_
+
+#include <cstring>
+
+#include "support/containers/allocator.h"
+#include "support/containers/vector.h"
+#include "support/log/log.h"
+#include "vulkan_helpers/vulkan_application.h"
+#include "vulkan_helpers/vulkan_model.h"
+
+namespace vulkan {
+
+// A MeshPool packs many models into one shared vertex buffer and one shared
+// index buffer, so that a whole scene can be drawn with a single set of
+// buffer bindings. The vertex buffer holds all of the positions, then all of
+// the texture coordinates, then all of the normals, which gives the same
+// vertex layout as VulkanModel; pipelines set up for one work with the
+// other.
+// Each mesh is described by its (firstIndex, vertexOffset, indexCount), which
+// is exactly what a VkDrawIndexedIndirectCommand needs.
+class MeshPool {
+ public:
+  struct Mesh {
+    uint32_t first_index;
+    int32_t vertex_offset;
+    uint32_t index_count;
+  };
+
+  MeshPool(containers::Allocator* allocator, logging::Logger* logger)
+      : allocator_(allocator),
+        logger_(logger),
+        meshes_(allocator),
+        positions_(allocator),
+        texture_coords_(allocator),
+        normals_(allocator),
+        indices_(allocator),
+        num_vertices_(0) {}
+
+  // Adds a mesh from the output of the convert_obj_to_c.py script, and
+  // returns its index in the pool.
+  template <typename T>
+  size_t AddMesh(const T& t) {
+    return AddMesh(t.num_vertices, t.positions, t.uv, t.normals,
+                   t.num_indices, t.indices);
+  }
+
+  // Adds a mesh to the pool and returns its index. The data is copied, so it
+  // does not have to outlive this call. Meshes added after InitializeData
+  // only reach the GPU on the next call to InitializeData.
+  size_t AddMesh(size_t num_vertices, const float* positions,
+                 const float* texture_coords, const float* normals,
+                 size_t num_indices, const uint32_t* indices) {
+    Mesh mesh = {static_cast<uint32_t>(indices_.size()),
+                 static_cast<int32_t>(num_vertices_),
+                 static_cast<uint32_t>(num_indices)};
+    meshes_.push_back(mesh);
+    positions_.insert(positions_.end(), positions,
+                      positions + num_vertices * 3);
+    texture_coords_.insert(texture_coords_.end(), texture_coords,
+                           texture_coords + num_vertices * 2);
+    normals_.insert(normals_.end(), normals, normals + num_vertices * 3);
+    indices_.insert(indices_.end(), indices, indices + num_indices);
+    num_vertices_ += num_vertices;
+    return meshes_.size() - 1;
+  }
+
+  // Creates the shared vertex and index buffers, and adds the commands to
+  // |cmdBuffer| that upload every mesh added so far through a single staging
+  // buffer. The staging buffer is kept until ReleaseStagingData is called,
+  // which may only happen once |cmdBuffer| has finished executing.
+  // If the pool has already been initialized, then this re-initializes it.
+  void InitializeData(vulkan::VulkanApplication* application,
+                      vulkan::VkCommandBuffer* cmdBuffer) {
+    LOG_ASSERT(!=, logger_, size_t(0), meshes_.size());
+    const size_t positions_size = positions_.size() * sizeof(float);
+    const size_t texture_coords_size = texture_coords_.size() * sizeof(float);
+    const size_t normals_size = normals_.size() * sizeof(float);
+    const size_t vertex_data_size =
+        positions_size + texture_coords_size + normals_size;
+    const size_t index_data_size = indices_.size() * INDEX_SIZE;
+
+    vertexBuffer_ = application->CreateAndBindDefaultExclusiveDeviceBuffer(
+        vertex_data_size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    indexBuffer_ = application->CreateAndBindDefaultExclusiveDeviceBuffer(
+        index_data_size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    stagingBuffer_ = application->CreateAndBindDefaultExclusiveHostBuffer(
+        vertex_data_size + index_data_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
+    char* staging = stagingBuffer_->base_address();
+    memcpy(staging, positions_.data(), positions_size);
+    staging += positions_size;
+    memcpy(staging, texture_coords_.data(), texture_coords_size);
+    staging += texture_coords_size;
+    memcpy(staging, normals_.data(), normals_size);
+    staging += normals_size;
+    memcpy(staging, indices_.data(), index_data_size);
+    stagingBuffer_->flush();
+
+    VkBufferCopy vertex_copy = {0, 0, vertex_data_size};
+    VkBufferCopy index_copy = {vertex_data_size, 0, index_data_size};
+    (*cmdBuffer)->vkCmdCopyBuffer(*cmdBuffer, *stagingBuffer_, *vertexBuffer_,
+                                  1, &vertex_copy);
+    (*cmdBuffer)->vkCmdCopyBuffer(*cmdBuffer, *stagingBuffer_, *indexBuffer_,
+                                  1, &index_copy);
+
+    VkBufferMemoryBarrier barriers[2] = {
+        {
+            VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,  // sType
+            nullptr,                                  // pNext
+            VK_ACCESS_TRANSFER_WRITE_BIT,             // srcAccessMask
+            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,      // dstAccessMask
+            VK_QUEUE_FAMILY_IGNORED,                  // srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,                  // dstQueueFamilyIndex
+            *vertexBuffer_,                           // buffer
+            0,                                        // offset
+            VK_WHOLE_SIZE,                            // size
+        },
+        {
+            VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,  // sType
+            nullptr,                                  // pNext
+            VK_ACCESS_TRANSFER_WRITE_BIT,             // srcAccessMask
+            VK_ACCESS_INDEX_READ_BIT,                 // dstAccessMask
+            VK_QUEUE_FAMILY_IGNORED,                  // srcQueueFamilyIndex
+            VK_QUEUE_FAMILY_IGNORED,                  // dstQueueFamilyIndex
+            *indexBuffer_,                            // buffer
+            0,                                        // offset
+            VK_WHOLE_SIZE,                            // size
+        }};
+    (*cmdBuffer)->vkCmdPipelineBarrier(
+        *cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 2, barriers, 0,
+        nullptr);
+
+    position_offset_ = 0;
+    texture_coord_offset_ = positions_size;
+    normal_offset_ = positions_size + texture_coords_size;
+  }
+
+  // Releases the staging buffer used by the last InitializeData.
+  void ReleaseStagingData() { stagingBuffer_.reset(); }
+
+  // Releases all GPU resources held by this pool.
+  void ReleaseData() {
+    stagingBuffer_.reset();
+    vertexBuffer_.reset();
+    indexBuffer_.reset();
+  }
+
+  // Adds the vertex assembly state for the pool to the given vectors, this
+  // is identical to the state used by VulkanModel.
+  void GetAssemblyInfo(
+      containers::vector<VkVertexInputBindingDescription>* input_bindings,
+      containers::vector<VkVertexInputAttributeDescription>*
+          vertex_attribute_descriptions) {
+    VulkanModel::GetAssemblyInfo(input_bindings,
+                                 vertex_attribute_descriptions);
+  }
+
+  // Binds the shared vertex and index buffers. Every mesh in the pool can be
+  // drawn after this without rebinding anything.
+  void BindVertexAndIndexBuffers(vulkan::VkCommandBuffer* cmdBuffer) {
+    ::VkBuffer buffers[3] = {*vertexBuffer_, *vertexBuffer_, *vertexBuffer_};
+    ::VkDeviceSize offsets[3] = {position_offset_, texture_coord_offset_,
+                                 normal_offset_};
+    (*cmdBuffer)->vkCmdBindVertexBuffers(*cmdBuffer, 0, 3, buffers, offsets);
+    (*cmdBuffer)
+        ->vkCmdBindIndexBuffer(*cmdBuffer, *indexBuffer_, 0,
+                               VK_INDEX_TYPE_UINT32);
+  }
+
+  // Draws one mesh of the pool. BindVertexAndIndexBuffers must have been
+  // called on |cmdBuffer| first.
+  void Draw(vulkan::VkCommandBuffer* cmdBuffer, size_t mesh_index,
+            uint32_t instance_count = 1, uint32_t first_instance = 0) {
+    const Mesh& m = meshes_[mesh_index];
+    (*cmdBuffer)
+        ->vkCmdDrawIndexed(*cmdBuffer, m.index_count, instance_count,
+                           m.first_index, m.vertex_offset, first_instance);
+  }
+
+  // Returns the indirect draw command for one mesh of the pool.
+  VkDrawIndexedIndirectCommand GetDrawCommand(
+      size_t mesh_index, uint32_t instance_count = 1,
+      uint32_t first_instance = 0) const {
+    const Mesh& m = meshes_[mesh_index];
+    return {
+        m.index_count,    // indexCount
+        instance_count,   // instanceCount
+        m.first_index,    // firstIndex
+        m.vertex_offset,  // vertexOffset
+        first_instance,   // firstInstance
+    };
+  }
+
+  // Appends one indirect draw command per mesh to |commands|. The
+  // firstInstance of each command is the index of its mesh, so that shaders
+  // can use gl_InstanceIndex to find per-mesh data.
+  void GetDrawCommands(
+      containers::vector<VkDrawIndexedIndirectCommand>* commands) const {
+    for (size_t i = 0; i < meshes_.size(); ++i) {
+      commands->push_back(GetDrawCommand(i, 1, static_cast<uint32_t>(i)));
+    }
+  }
+
+  const Mesh& mesh(size_t mesh_index) const { return meshes_[mesh_index]; }
+  size_t NumMeshes() const { return meshes_.size(); }
+  size_t NumVertices() const { return num_vertices_; }
+  size_t NumIndices() const { return indices_.size(); }
+
+ private:
+  containers::Allocator* allocator_;
+  logging::Logger* logger_;
+  containers::vector<Mesh> meshes_;
+  containers::vector<float> positions_;
+  containers::vector<float> texture_coords_;
+  containers::vector<float> normals_;
+  containers::vector<uint32_t> indices_;
+  size_t num_vertices_;
+  ::VkDeviceSize position_offset_;
+  ::VkDeviceSize texture_coord_offset_;
+  ::VkDeviceSize normal_offset_;
+
+  containers::unique_ptr<vulkan::VulkanApplication::Buffer> vertexBuffer_;
+  containers::unique_ptr<vulkan::VulkanApplication::Buffer> indexBuffer_;
+  containers::unique_ptr<vulkan::VulkanApplication::Buffer> stagingBuffer_;
+};
+
+}  // namespace vulkan
+#endif  // VULKAN_HELPERS_MESH_POOL_H_
@@ -0,0 +1,148 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vulkan_helpers/object_cache.h"
+
+#include <functional>
+
+#include "vulkan_helpers/driver_memory_tracker.h"
+
+namespace vulkan {
+namespace {
+template <typename T>
+void HashCombine(size_t* seed, const T& value) {
+  *seed ^= std::hash<T>()(value) + 0x9e3779b9 + (*seed << 6) + (*seed >> 2);
+}
+
+VkComponentSwizzle ResolveSwizzle(VkComponentSwizzle swizzle,
+                                  VkComponentSwizzle identity) {
+  return swizzle == VK_COMPONENT_SWIZZLE_IDENTITY ? identity : swizzle;
+}
+}  // anonymous namespace
+
+bool SamplerKey::operator==(const SamplerKey& other) const {
+  const VkSamplerCreateInfo& o = other.info;
+  return info.flags == o.flags && info.magFilter == o.magFilter &&
+         info.minFilter == o.minFilter && info.mipmapMode == o.mipmapMode &&
+         info.addressModeU == o.addressModeU &&
+         info.addressModeV == o.addressModeV &&
+         info.addressModeW == o.addressModeW &&
+         info.mipLodBias == o.mipLodBias &&
+         info.anisotropyEnable == o.anisotropyEnable &&
+         info.maxAnisotropy == o.maxAnisotropy &&
+         info.compareEnable == o.compareEnable &&
+         info.compareOp == o.compareOp && info.minLod == o.minLod &&
+         info.maxLod == o.maxLod && info.borderColor == o.borderColor &&
+         info.unnormalizedCoordinates == o.unnormalizedCoordinates;
+}
+
+size_t SamplerKey::hash() const {
+  size_t seed = 0;
+  HashCombine(&seed, uint32_t(info.flags));
+  HashCombine(&seed, uint32_t(info.magFilter));
+  HashCombine(&seed, uint32_t(info.minFilter));
+  HashCombine(&seed, uint32_t(info.mipmapMode));
+  HashCombine(&seed, uint32_t(info.addressModeU));
+  HashCombine(&seed, uint32_t(info.addressModeV));
+  HashCombine(&seed, uint32_t(info.addressModeW));
+  HashCombine(&seed, info.mipLodBias);
+  HashCombine(&seed, uint32_t(info.anisotropyEnable));
+  HashCombine(&seed, info.maxAnisotropy);
+  HashCombine(&seed, uint32_t(info.compareEnable));
+  HashCombine(&seed, uint32_t(info.compareOp));
+  HashCombine(&seed, info.minLod);
+  HashCombine(&seed, info.maxLod);
+  HashCombine(&seed, uint32_t(info.borderColor));
+  HashCombine(&seed, uint32_t(info.unnormalizedCoordinates));
+  return seed;
+}
+
+::VkResult SamplerCacheTraits::Create(VkDevice* device, const key_type& key,
+                                      type* object) {
+  return (*device)->vkCreateSampler(
+      *device, &key.info, GetDriverAllocator(device, VK_OBJECT_TYPE_SAMPLER),
+      object);
+}
+
+void SamplerCacheTraits::Destroy(VkDevice* device, type object) {
+  (*device)->vkDestroySampler(*device, object, device->allocator());
+}
+
+ImageViewKey::ImageViewKey(::VkImage image, VkImageViewType view_type,
+                           VkFormat format,
+                           const VkImageSubresourceRange& range,
+                           const VkComponentMapping& components)
+    : image(image),
+      view_type(view_type),
+      format(format),
+      range(range),
+      components{ResolveSwizzle(components.r, VK_COMPONENT_SWIZZLE_R),
+                 ResolveSwizzle(components.g, VK_COMPONENT_SWIZZLE_G),
+                 ResolveSwizzle(components.b, VK_COMPONENT_SWIZZLE_B),
+                 ResolveSwizzle(components.a, VK_COMPONENT_SWIZZLE_A)} {}
+
+bool ImageViewKey::operator==(const ImageViewKey& other) const {
+  return image == other.image && view_type == other.view_type &&
+         format == other.format &&
+         range.aspectMask == other.range.aspectMask &&
+         range.baseMipLevel == other.range.baseMipLevel &&
+         range.levelCount == other.range.levelCount &&
+         range.baseArrayLayer == other.range.baseArrayLayer &&
+         range.layerCount == other.range.layerCount &&
+         components.r == other.components.r &&
+         components.g == other.components.g &&
+         components.b == other.components.b &&
+         components.a == other.components.a;
+}
+
+size_t ImageViewKey::hash() const {
+  size_t seed = 0;
+  HashCombine(&seed, image);
+  HashCombine(&seed, uint32_t(view_type));
+  HashCombine(&seed, uint32_t(format));
+  HashCombine(&seed, uint32_t(range.aspectMask));
+  HashCombine(&seed, range.baseMipLevel);
+  HashCombine(&seed, range.levelCount);
+  HashCombine(&seed, range.baseArrayLayer);
+  HashCombine(&seed, range.layerCount);
+  HashCombine(&seed, uint32_t(components.r));
+  HashCombine(&seed, uint32_t(components.g));
+  HashCombine(&seed, uint32_t(components.b));
+  HashCombine(&seed, uint32_t(components.a));
+  return seed;
+}
+
+::VkResult ImageViewCacheTraits::Create(VkDevice* device, const key_type& key,
+                                        type* object) {
+  VkImageViewCreateInfo create_info{
+      VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,  // sType
+      nullptr,                                   // pNext
+      0,                                         // flags
+      key.image,                                 // image
+      key.view_type,                             // viewType
+      key.format,                                // format
+      key.components,                            // components
+      key.range,                                 // subresourceRange
+  };
+  return (*device)->vkCreateImageView(
+      *device, &create_info,
+      GetDriverAllocator(device, VK_OBJECT_TYPE_IMAGE_VIEW), object);
+}
+
+void ImageViewCacheTraits::Destroy(VkDevice* device, type object) {
+  (*device)->vkDestroyImageView(*device, object, device->allocator());
+}
+
+}  // namespace vulkan
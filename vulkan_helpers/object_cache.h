@@ -0,0 +1,268 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_HELPERS_OBJECT_CACHE_H_
+#define VULKAN_HELPERS_OBJECT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "support/containers/allocator.h"
+#include "support/containers/unordered_map.h"
+#include "support/log/log.h"
+#include "vulkan_wrapper/device_wrapper.h"
+
+namespace vulkan {
+
+// A counted reference to an object that is owned by an ObjectCache. The
+// reference is released when this goes out of scope. A reference must not
+// outlive the cache it came from. If the cache evicts the object early (for
+// example because the image a view was created from was destroyed), the
+// reference simply becomes a dangling handle and releasing it does nothing.
+template <typename Cache>
+class CachedObject {
+ public:
+  using type = typename Cache::type;
+
+  CachedObject() : cache_(nullptr), object_(VK_NULL_HANDLE), serial_(0) {}
+  CachedObject(Cache* cache, type object, uint64_t serial)
+      : cache_(cache), object_(object), serial_(serial) {}
+  CachedObject(const CachedObject& other)
+      : cache_(other.cache_), object_(other.object_), serial_(other.serial_) {
+    if (cache_) {
+      cache_->AddRef(object_, serial_);
+    }
+  }
+  CachedObject(CachedObject&& other)
+      : cache_(other.cache_), object_(other.object_), serial_(other.serial_) {
+    other.cache_ = nullptr;
+    other.object_ = VK_NULL_HANDLE;
+  }
+  CachedObject& operator=(CachedObject other) {
+    std::swap(cache_, other.cache_);
+    std::swap(object_, other.object_);
+    std::swap(serial_, other.serial_);
+    return *this;
+  }
+  ~CachedObject() { reset(); }
+
+  void reset() {
+    if (cache_) {
+      cache_->Release(object_, serial_);
+    }
+    cache_ = nullptr;
+    object_ = VK_NULL_HANDLE;
+  }
+
+  operator type() const { return object_; }
+  const type& get_raw_object() const { return object_; }
+
+ private:
+  Cache* cache_;
+  type object_;
+  uint64_t serial_;
+};
+
+// Caches Vulkan objects by the parameters they were created with, so that
+// identical requests share one object. Objects are reference counted, and
+// destroyed when the last reference is released or when they are evicted.
+// Traits is expected to be of the form
+// struct FooCacheTraits {
+//   using type = ::VkFoo;
+//   using key_type = FooKey; // Has operator== and size_t hash() const.
+//   static ::VkResult Create(VkDevice* device, const key_type& key,
+//                            type* object);
+//   static void Destroy(VkDevice* device, type object);
+// };
+// This is not thread-safe.
+template <typename Traits>
+class ObjectCache {
+ public:
+  using type = typename Traits::type;
+  using key_type = typename Traits::key_type;
+  using reference = CachedObject<ObjectCache<Traits>>;
+
+  ObjectCache(containers::Allocator* allocator, VkDevice* device)
+      : device_(device),
+        entries_(allocator),
+        keys_(allocator),
+        next_serial_(1),
+        hits_(0),
+        misses_(0) {}
+  ~ObjectCache() {
+    if (device_->functions()->in_bulk_teardown()) {
+      return;
+    }
+    for (auto& entry : entries_) {
+      Traits::Destroy(device_, entry.second.object);
+    }
+  }
+
+  // Returns a reference to the object for |key|, creating the object if
+  // there is none yet.
+  reference Get(const key_type& key) {
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      ++hits_;
+      it->second.refs++;
+      return reference(this, it->second.object, it->second.serial);
+    }
+    ++misses_;
+    type object;
+    LOG_ASSERT(==, device_->GetLogger(),
+               Traits::Create(device_, key, &object), VK_SUCCESS);
+    Entry entry{object, 1, next_serial_++};
+    entries_.insert(std::make_pair(key, entry));
+    keys_.insert(std::make_pair(object, key));
+    return reference(this, object, entry.serial);
+  }
+
+  // Destroys every object whose key satisfies |predicate|, whether or not
+  // there are still references to it.
+  template <typename Predicate>
+  void Evict(Predicate predicate) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (predicate(it->first)) {
+        Traits::Destroy(device_, it->second.object);
+        keys_.erase(it->second.object);
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // The number of live objects owned by the cache.
+  size_t size() const { return entries_.size(); }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+ private:
+  friend class CachedObject<ObjectCache<Traits>>;
+
+  struct Entry {
+    type object;
+    uint32_t refs;
+    // Distinguishes this entry from any later entry that gets the same
+    // handle back from the driver after this one is destroyed.
+    uint64_t serial;
+  };
+  struct KeyHash {
+    size_t operator()(const key_type& key) const { return key.hash(); }
+  };
+
+  Entry* Find(type object, uint64_t serial) {
+    auto key = keys_.find(object);
+    if (key == keys_.end()) {
+      return nullptr;
+    }
+    auto it = entries_.find(key->second);
+    if (it == entries_.end() || it->second.serial != serial) {
+      return nullptr;
+    }
+    return &it->second;
+  }
+
+  void AddRef(type object, uint64_t serial) {
+    if (Entry* entry = Find(object, serial)) {
+      entry->refs++;
+    }
+  }
+
+  void Release(type object, uint64_t serial) {
+    Entry* entry = Find(object, serial);
+    if (!entry || --entry->refs != 0) {
+      return;
+    }
+    if (!device_->functions()->in_bulk_teardown()) {
+      Traits::Destroy(device_, object);
+    }
+    auto key = keys_.find(object);
+    entries_.erase(key->second);
+    keys_.erase(key);
+  }
+
+  VkDevice* device_;
+  containers::unordered_map<key_type, Entry, KeyHash> entries_;
+  containers::unordered_map<type, key_type> keys_;
+  uint64_t next_serial_;
+  uint64_t hits_;
+  uint64_t misses_;
+};
+
+// The key for a cached sampler. This is everything in VkSamplerCreateInfo
+// except the pNext chain, which cached samplers may not have.
+struct SamplerKey {
+  explicit SamplerKey(const VkSamplerCreateInfo& create_info)
+      : info(create_info) {
+    info.pNext = nullptr;
+  }
+  bool operator==(const SamplerKey& other) const;
+  size_t hash() const;
+
+  VkSamplerCreateInfo info;
+};
+
+struct SamplerCacheTraits {
+  using type = ::VkSampler;
+  using key_type = SamplerKey;
+  static ::VkResult Create(VkDevice* device, const key_type& key,
+                           type* object);
+  static void Destroy(VkDevice* device, type object);
+};
+
+// The key for a cached image view. Identity swizzles are stored as the
+// explicit component they stand for, so both spellings share a view.
+struct ImageViewKey {
+  ImageViewKey(::VkImage image, VkImageViewType view_type, VkFormat format,
+               const VkImageSubresourceRange& range,
+               const VkComponentMapping& components);
+  bool operator==(const ImageViewKey& other) const;
+  size_t hash() const;
+
+  ::VkImage image;
+  VkImageViewType view_type;
+  VkFormat format;
+  VkImageSubresourceRange range;
+  VkComponentMapping components;
+};
+
+struct ImageViewCacheTraits {
+  using type = ::VkImageView;
+  using key_type = ImageViewKey;
+  static ::VkResult Create(VkDevice* device, const key_type& key,
+                           type* object);
+  static void Destroy(VkDevice* device, type object);
+};
+
+using SamplerCache = ObjectCache<SamplerCacheTraits>;
+using CachedSampler = SamplerCache::reference;
+
+class ImageViewCache : public ObjectCache<ImageViewCacheTraits> {
+ public:
+  ImageViewCache(containers::Allocator* allocator, VkDevice* device)
+      : ObjectCache<ImageViewCacheTraits>(allocator, device) {}
+  // Destroys all of the cached views of |image|. This must be called before
+  // the image itself is destroyed.
+  void EvictImage(::VkImage image) {
+    Evict([image](const ImageViewKey& key) { return key.image == image; });
+  }
+};
+using CachedImageView = ImageViewCache::reference;
+
+}  // namespace vulkan
+
+#endif  // VULKAN_HELPERS_OBJECT_CACHE_H_
@@ -0,0 +1,291 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_HELPERS_SHADER_LAYOUT_H_
+#define VULKAN_HELPERS_SHADER_LAYOUT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+// This describes shader interface blocks (uniform and storage buffers) at
+// compile time, and lays out their members according to the std140, std430
+// or scalar rules of the Vulkan spec, "Offset and Stride Assignment".
+// A block is described once, with the members in the order they appear in
+// the shader:
+//
+//   // layout (std430) uniform color_data { vec3 color1; float scale; };
+//   using ColorData = vulkan::ShaderBlock<vulkan::BlockLayout::kStd430,
+//                                         vulkan::shader_types::vec3,
+//                                         vulkan::shader_types::float_>;
+//   static_assert(ColorData::offset<1>() == 12, "scale packs after color1");
+//
+// ColorData is a correctly padded C++ type that can be handed to
+// BufferFrameData. Members are written with set<I>(value), where value is
+// anything laid out like the member would be in plain C++, for example a
+// mathfu vector or matrix. Its components must have the type and the number
+// of the member's, which is checked at compile time. Padded C++ types (such
+// as SIMD vec3s) are handled by splitting the source evenly between the
+// columns or array elements.
+namespace vulkan {
+
+enum class BlockLayout { kStd140, kStd430, kScalar };
+
+namespace shader_types {
+// A vector of N 32-bit components.
+template <typename Component, uint32_t N>
+struct Vec {};
+// A column-major matrix.
+template <typename Component, uint32_t Columns, uint32_t Rows>
+struct Mat {};
+// An array of N elements.
+template <typename Element, uint32_t N>
+struct Array {};
+
+using float_ = float;
+using int_ = int32_t;
+using uint_ = uint32_t;
+using vec2 = Vec<float, 2>;
+using vec3 = Vec<float, 3>;
+using vec4 = Vec<float, 4>;
+using ivec2 = Vec<int32_t, 2>;
+using ivec3 = Vec<int32_t, 3>;
+using ivec4 = Vec<int32_t, 4>;
+using uvec2 = Vec<uint32_t, 2>;
+using uvec3 = Vec<uint32_t, 3>;
+using uvec4 = Vec<uint32_t, 4>;
+using mat2 = Mat<float, 2, 2>;
+using mat3 = Mat<float, 3, 3>;
+using mat4 = Mat<float, 4, 4>;
+}  // namespace shader_types
+
+namespace shader_layout_internal {
+constexpr size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+constexpr size_t Max(size_t a, size_t b) { return a > b ? a : b; }
+
+// LayoutOf<L, T> gives the size and alignment of T in layout L, the number
+// of bytes T takes when tightly packed in C++, the type and number of its
+// components, and a function that copies a C++ value of T into its laid out
+// position.
+template <BlockLayout L, typename T>
+struct LayoutOf;
+
+template <BlockLayout L, typename T>
+struct ScalarLayout {
+  static_assert(sizeof(T) == 4, "Only 32-bit components are supported");
+  static constexpr size_t kSize = 4;
+  static constexpr size_t kAlign = 4;
+  static constexpr size_t kPackedSize = 4;
+  using Component = T;
+  static constexpr size_t kComponents = 1;
+  static void Store(uint8_t* dst, const uint8_t* src, size_t) {
+    memcpy(dst, src, kSize);
+  }
+};
+template <BlockLayout L>
+struct LayoutOf<L, float> : ScalarLayout<L, float> {};
+template <BlockLayout L>
+struct LayoutOf<L, int32_t> : ScalarLayout<L, int32_t> {};
+template <BlockLayout L>
+struct LayoutOf<L, uint32_t> : ScalarLayout<L, uint32_t> {};
+
+template <BlockLayout L, typename C, uint32_t N>
+struct LayoutOf<L, shader_types::Vec<C, N>> {
+  static_assert(N >= 2 && N <= 4, "Vectors have 2 to 4 components");
+  static constexpr size_t kSize = N * LayoutOf<L, C>::kSize;
+  // A three-component vector is aligned like a four-component one.
+  static constexpr size_t kAlign =
+      L == BlockLayout::kScalar ? LayoutOf<L, C>::kAlign
+                                : (N == 2 ? 2 : 4) * LayoutOf<L, C>::kAlign;
+  static constexpr size_t kPackedSize = kSize;
+  using Component = C;
+  static constexpr size_t kComponents = N;
+  static void Store(uint8_t* dst, const uint8_t* src, size_t) {
+    memcpy(dst, src, kSize);
+  }
+};
+
+// Arrays and matrix columns share the same stride rules.
+template <BlockLayout L, typename E, uint32_t N>
+struct StridedLayout {
+  using element = LayoutOf<L, E>;
+  // std140 rounds the alignment, and so the stride, of array elements up to
+  // that of a vec4.
+  static constexpr size_t kAlign = L == BlockLayout::kStd140
+                                       ? AlignUp(element::kAlign, 16)
+                                       : element::kAlign;
+  static constexpr size_t kStride =
+      L == BlockLayout::kScalar ? element::kSize
+                                : AlignUp(element::kSize, kAlign);
+  static constexpr size_t kSize = N * kStride;
+  static constexpr size_t kPackedSize = N * element::kPackedSize;
+  using Component = typename element::Component;
+  static constexpr size_t kComponents = N * element::kComponents;
+  static void Store(uint8_t* dst, const uint8_t* src, size_t src_size) {
+    const size_t src_stride = src_size / N;
+    for (uint32_t i = 0; i < N; ++i) {
+      element::Store(dst + i * kStride, src + i * src_stride, src_stride);
+    }
+  }
+};
+
+template <BlockLayout L, typename E, uint32_t N>
+struct LayoutOf<L, shader_types::Array<E, N>> : StridedLayout<L, E, N> {};
+
+template <BlockLayout L, typename C, uint32_t Columns, uint32_t Rows>
+struct LayoutOf<L, shader_types::Mat<C, Columns, Rows>>
+    : StridedLayout<L, shader_types::Vec<C, Rows>, Columns> {};
+
+// ValueShape<U> gives the type and number of the components of a C++ value
+// that is written to a block member: scalars, C arrays, and vector and
+// matrix templates of the form V<T, N> and M<T, Rows, Columns> such as
+// mathfu's.
+template <typename U>
+struct ValueShape {
+  using Component = U;
+  static constexpr size_t kComponents = 1;
+};
+template <typename T, size_t N>
+struct ValueShape<T[N]> {
+  using Component = typename ValueShape<T>::Component;
+  static constexpr size_t kComponents = N * ValueShape<T>::kComponents;
+};
+template <template <class, int> class V, typename T, int N>
+struct ValueShape<V<T, N>> {
+  using Component = T;
+  static constexpr size_t kComponents = N;
+};
+template <template <class, int, int> class M, typename T, int Rows,
+          int Columns>
+struct ValueShape<M<T, Rows, Columns>> {
+  using Component = T;
+  static constexpr size_t kComponents = Rows * Columns;
+};
+
+template <size_t I, typename... Fields>
+using FieldType = typename std::tuple_element<I, std::tuple<Fields...>>::type;
+
+// The offset of field I in a block of Fields.
+template <BlockLayout L, size_t I, typename... Fields>
+struct FieldOffset {
+  static constexpr size_t value =
+      AlignUp(FieldOffset<L, I - 1, Fields...>::value +
+                  LayoutOf<L, FieldType<I - 1, Fields...>>::kSize,
+              LayoutOf<L, FieldType<I, Fields...>>::kAlign);
+};
+template <BlockLayout L, typename... Fields>
+struct FieldOffset<L, 0, Fields...> {
+  static constexpr size_t value = 0;
+};
+
+// The largest alignment, and the sum of the packed sizes, of Fields.
+template <BlockLayout L, typename... Fields>
+struct FieldTotals;
+template <BlockLayout L, typename Field>
+struct FieldTotals<L, Field> {
+  static constexpr size_t kAlign = LayoutOf<L, Field>::kAlign;
+  static constexpr size_t kPackedSize = LayoutOf<L, Field>::kPackedSize;
+};
+template <BlockLayout L, typename Field, typename... Rest>
+struct FieldTotals<L, Field, Rest...> {
+  static constexpr size_t kAlign =
+      Max(LayoutOf<L, Field>::kAlign, FieldTotals<L, Rest...>::kAlign);
+  static constexpr size_t kPackedSize =
+      LayoutOf<L, Field>::kPackedSize + FieldTotals<L, Rest...>::kPackedSize;
+};
+}  // namespace shader_layout_internal
+
+// A block with the given members, laid out according to L. See the comment
+// at the top of this file.
+template <BlockLayout L, typename... Fields>
+class ShaderBlock {
+  static_assert(sizeof...(Fields) > 0, "A block needs at least one member");
+  static constexpr size_t kLast = sizeof...(Fields) - 1;
+  template <size_t I>
+  using FieldLayout = shader_layout_internal::LayoutOf<
+      L, shader_layout_internal::FieldType<I, Fields...>>;
+  using Totals = shader_layout_internal::FieldTotals<L, Fields...>;
+
+ public:
+  // Structures are aligned like their largest member, which std140 rounds
+  // up to the alignment of a vec4.
+  static constexpr size_t kAlign =
+      L == BlockLayout::kStd140
+          ? shader_layout_internal::AlignUp(Totals::kAlign, 16)
+          : Totals::kAlign;
+  static constexpr size_t kSize = shader_layout_internal::AlignUp(
+      shader_layout_internal::FieldOffset<L, kLast, Fields...>::value +
+          FieldLayout<kLast>::kSize,
+      kAlign);
+  // The bytes of the block that are padding. Reordering the members, in the
+  // shader as well, so that this is smaller saves memory and bandwidth.
+  static constexpr size_t kPaddingBytes = kSize - Totals::kPackedSize;
+
+  ShaderBlock() { memset(data_, 0, sizeof(data_)); }
+
+  // The offset of member I, as the shader sees it.
+  template <size_t I>
+  static constexpr size_t offset() {
+    return shader_layout_internal::FieldOffset<L, I, Fields...>::value;
+  }
+
+  // Copies |value| into member I. |value| must have as many components as
+  // the member, of the same type, and be at least as large as the member is
+  // when tightly packed.
+  template <size_t I, typename U>
+  void set(const U& value) {
+    using Shape = shader_layout_internal::ValueShape<U>;
+    static_assert(std::is_same<typename Shape::Component,
+                               typename FieldLayout<I>::Component>::value,
+                  "The value has other components than the block member");
+    static_assert(Shape::kComponents == FieldLayout<I>::kComponents,
+                  "The value has a different number of components than the "
+                  "block member");
+    static_assert(sizeof(U) >= FieldLayout<I>::kPackedSize,
+                  "The value is smaller than the block member");
+    FieldLayout<I>::Store(data_ + offset<I>(),
+                          reinterpret_cast<const uint8_t*>(&value),
+                          sizeof(U));
+  }
+
+  const uint8_t* data() const { return data_; }
+
+ private:
+  alignas(16) uint8_t data_[kSize];
+};
+
+namespace shader_layout_internal {
+// Blocks can be nested inside other blocks with the same layout.
+template <BlockLayout L, typename... Fields>
+struct LayoutOf<L, ShaderBlock<L, Fields...>> {
+  static constexpr size_t kSize = ShaderBlock<L, Fields...>::kSize;
+  static constexpr size_t kAlign = ShaderBlock<L, Fields...>::kAlign;
+  static constexpr size_t kPackedSize = kSize;
+  using Component = ShaderBlock<L, Fields...>;
+  static constexpr size_t kComponents = 1;
+  static void Store(uint8_t* dst, const uint8_t* src, size_t) {
+    memcpy(dst, reinterpret_cast<const ShaderBlock<L, Fields...>*>(src)->data(),
+           kSize);
+  }
+};
+}  // namespace shader_layout_internal
+
+}  // namespace vulkan
+
+#endif  // VULKAN_HELPERS_SHADER_LAYOUT_H_
@@ -21,6 +21,8 @@
 
 #include "support/containers/unordered_map.h"
 #include "vulkan_helpers/helper_functions.h"
+#include "vulkan_helpers/memory_type_policy.h"
+#include "vulkan_helpers/mesh_pool.h"
 #include "vulkan_helpers/vulkan_model.h"
 
 typedef void(VKAPI_PTR* PFN_vkSetSwapchainCallback)(
@@ -67,16 +69,26 @@ VulkanApplication::VulkanApplication(
     bool use_host_query_reset, VkColorSpaceKHR swapchain_color_space,
     bool use_shared_presentation, bool use_mutable_swapchain_format,
     const void* swapchain_extensions, bool use_vulkan_1_1, bool use_10bit_hdr,
-    void* device_next)
+    void* device_next, bool track_driver_memory)
     : allocator_(allocator),
       log_(log),
       entry_data_(entry_data),
       swapchain_images_(allocator_),
+      additional_outputs_(allocator_),
       render_queue_(nullptr),
       present_queue_(nullptr),
       render_queue_index_(0u),
       present_queue_index_(0u),
       use_protected_memory_(use_protected_memory),
+      debug_labels_(entry_data->debug_labels()),
+      driver_memory_tracker_(
+          track_driver_memory || entry_data->memory_report()
+              ? containers::make_unique<DriverMemoryTracker>(
+                    allocator_,
+                    allocator_->WithTag(
+                        containers::AllocationTag::kDriverMemory),
+                    log_)
+              : nullptr),
       library_wrapper_(allocator_, log_),
       instance_(!use_vulkan_1_1 ? CreateInstanceForApplication(
                                       allocator_, &library_wrapper_,
@@ -106,6 +118,14 @@ VulkanApplication::VulkanApplication(
       coherent_heap_(allocator_),
       device_peer_memory_heaps_(allocator_),
       should_exit_(false) {
+  // The instance was created without VK_EXT_debug_utils if it is missing,
+  // so none of its functions can be called.
+  if (debug_labels_.enabled() &&
+      !InstanceExtensionAvailableForApplication(
+          allocator_, &library_wrapper_, entry_data_,
+          VK_EXT_DEBUG_UTILS_EXTENSION_NAME)) {
+    debug_labels_ = DebugLabels(false);
+  }
   if (!device_.is_valid()) {
     return;
   }
@@ -154,6 +174,16 @@ VulkanApplication::VulkanApplication(
 
   vulkan::LoadContainer(log_, device_->vkGetSwapchainImagesKHR,
                         &swapchain_images_, device_, swapchain_);
+
+  instance_->vkGetPhysicalDeviceProperties(device_.physical_device(),
+                                           &physical_device_properties_);
+  mapped_range_batcher_ = containers::make_unique<MappedRangeBatcher>(
+      allocator_, allocator_, &device_,
+      physical_device_properties_.limits.nonCoherentAtomSize);
+  sampler_cache_ = containers::make_unique<SamplerCache>(allocator_,
+                                                         allocator_, &device_);
+  image_view_cache_ = containers::make_unique<ImageViewCache>(
+      allocator_, allocator_, &device_);
   // Relevant spec sections for determining what memory we will be allowed
   // to use for our buffer allocations.
   //  The memoryTypeBits member is identical for all VkBuffer objects created
@@ -175,6 +205,10 @@ VulkanApplication::VulkanApplication(
   // Furthermore for both types, we will have ZERO flags
   // set (we do not want to do sparse binding.)
 
+  // The bookkeeping of every arena is charged to the same tag.
+  containers::Allocator* arena_allocator =
+      allocator_->WithTag(containers::AllocationTag::kArenaMetadata);
+
   // containers::unique_ptr<VulkanArena>* device_memories[3] = {
   //&host_accessible_heap_, &device_only_buffer_heap_, &coherent_heap_};
   containers::vector<containers::unique_ptr<VulkanArena>*> device_memories[3] =
@@ -199,19 +233,19 @@ VulkanApplication::VulkanApplication(
   VkBufferUsageFlags usages[3] = {
       VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
       kAllBufferBits, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
-  VkMemoryPropertyFlags property_flags[3] = {
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
-          (use_protected_memory_ ? VK_MEMORY_PROPERTY_PROTECTED_BIT : 0u),
-      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+  const char* arena_names[3] = {"Host buffer memory", "Device buffer memory",
+                                "Coherent buffer memory"};
+  MemoryUsage memory_usages[3] = {MemoryUsage::kStaging,
+                                  MemoryUsage::kStaticDevice,
+                                  MemoryUsage::kDynamicUniform};
+  VkMemoryPropertyFlags extra_required_flags[3] = {
+      0, use_protected_memory_ ? VK_MEMORY_PROPERTY_PROTECTED_BIT : 0u, 0};
   bool m_gpu = device_.num_devices() > 1;
   for (size_t j = 0; j < device_.num_devices(); ++j) {
     for (size_t i = 0; i < 3; ++i) {
       // 1) Create a tiny buffer so that we can determine what memory flags are
       // required.
-      bool host_mapped =
-          (property_flags[i] & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) != 0;
+      bool host_mapped = memory_usages[i] != MemoryUsage::kStaticDevice;
       if (j > 0 && !host_mapped) {
         continue;
       }
@@ -243,11 +277,14 @@ VulkanApplication::VulkanApplication(
       device_->vkGetBufferMemoryRequirements(device_, buffer, &requirements);
       device_->vkDestroyBuffer(device_, buffer, nullptr);
 
-      uint32_t memory_index = GetMemoryIndex(
-          &device_, log_, requirements.memoryTypeBits, property_flags[i]);
+      uint32_t memory_index = SelectMemoryType(
+          &device_, log_, requirements.memoryTypeBits, memory_usages[i],
+          device_memory_sizes[i], extra_required_flags[i]);
+      LOG_ASSERT(!=, log_, memory_index, kInvalidMemoryTypeIndex);
       *device_memories[i][j] = containers::make_unique<VulkanArena>(
-          allocator_, allocator_, log_, device_memory_sizes[i], memory_index,
-          &device_, host_mapped, m_gpu ? device_mask : 0);
+          allocator_, arena_allocator, log_, device_memory_sizes[i],
+          memory_index, &device_, host_mapped, m_gpu ? device_mask : 0);
+      NameArena(device_memories[i][j]->get(), arena_names[i]);
     }
   }
 
@@ -315,12 +352,15 @@ VulkanApplication::VulkanApplication(
     // For now we only handle 2 devices.
 
     device_peer_memory_heaps_.push_back(containers::make_unique<VulkanArena>(
-        allocator_, allocator_, log_, device_peer_memory_size, memory_index0,
-        &device_, false));
+        allocator_, arena_allocator, log_, device_peer_memory_size,
+        memory_index0, &device_, false));
 
     device_peer_memory_heaps_.push_back(containers::make_unique<VulkanArena>(
-        allocator_, allocator_, log_, device_peer_memory_size, memory_index1,
-        &device_, false));
+        allocator_, arena_allocator, log_, device_peer_memory_size,
+        memory_index1, &device_, false));
+    for (auto& heap : device_peer_memory_heaps_) {
+      NameArena(heap.get(), "Peer buffer memory");
+    }
   }
 
   // Same idea as above, but for image memory.
@@ -363,11 +403,36 @@ VulkanApplication::VulkanApplication(
     device_->vkDestroyImage(device_, image, nullptr);
 
     uint32_t memory_index =
-        GetMemoryIndex(&device_, log_, requirements.memoryTypeBits,
-                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        SelectMemoryType(&device_, log_, requirements.memoryTypeBits,
+                         MemoryUsage::kStaticDevice, device_image_size);
+    LOG_ASSERT(!=, log_, memory_index, kInvalidMemoryTypeIndex);
     device_only_image_heap_ = containers::make_unique<VulkanArena>(
-        allocator_, allocator_, log_, device_image_size, memory_index, &device_,
-        false);
+        allocator_, arena_allocator, log_, device_image_size, memory_index,
+        &device_, false);
+    NameArena(device_only_image_heap_.get(), "Device image memory");
+
+    // Transient attachments (multisampled color, depth) never need to be
+    // backed by real memory on tiled GPUs. If the device exposes a lazily
+    // allocated memory type that transient images can use, give them their
+    // own arena from that type. Otherwise they share the device-only arena.
+    image_create_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                              VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    LOG_ASSERT(
+        ==, log_,
+        device_->vkCreateImage(device_, &image_create_info, nullptr, &image),
+        VK_SUCCESS);
+    device_->vkGetImageMemoryRequirements(device_, image, &requirements);
+    device_->vkDestroyImage(device_, image, nullptr);
+
+    memory_index =
+        SelectMemoryType(&device_, log_, requirements.memoryTypeBits,
+                         MemoryUsage::kTransientAttachment, device_image_size);
+    if (memory_index != kInvalidMemoryTypeIndex) {
+      transient_image_heap_ = containers::make_unique<VulkanArena>(
+          allocator_, arena_allocator, log_, device_image_size, memory_index,
+          &device_, false);
+      NameArena(transient_image_heap_.get(), "Transient image memory");
+    }
   }
 }
 
@@ -424,7 +489,10 @@ VkDevice VulkanApplication::CreateDeviceGroup(
       entry_data_->prefer_separate_present(),
       create_async_compute_queue ? &compute_queue_index_ : nullptr,
       use_sparse_binding ? &sparse_binding_queue_index_ : nullptr,
-      device_next));
+      device_next,
+      driver_memory_tracker_
+          ? driver_memory_tracker_->callbacks(VK_OBJECT_TYPE_DEVICE)
+          : nullptr));
   return SetupDevice(std::move(device), create_async_compute_queue,
                      use_sparse_binding);
 }
@@ -435,8 +503,8 @@ VkDevice VulkanApplication::CreateDevice(
     bool use_sparse_binding, bool use_host_query_reset, void* device_next) {
   // Since this is called by the constructor be careful not to
   // use any data other than what has already been initialized.
-  // allocator_, log_, entry_data_, library_wrapper_, instance_,
-  // surface_
+  // allocator_, log_, entry_data_, driver_memory_tracker_, library_wrapper_,
+  // instance_, surface_
 
   vulkan::VkDevice device(vulkan::CreateDeviceForSwapchain(
       allocator_, &instance_, &surface_, &render_queue_index_,
@@ -444,24 +512,69 @@ VkDevice VulkanApplication::CreateDevice(
       entry_data_->prefer_separate_present(),
       create_async_compute_queue ? &compute_queue_index_ : nullptr,
       use_sparse_binding ? &sparse_binding_queue_index_ : nullptr,
-      use_host_query_reset, device_next));
+      use_host_query_reset, device_next,
+      driver_memory_tracker_
+          ? driver_memory_tracker_->callbacks(VK_OBJECT_TYPE_DEVICE)
+          : nullptr));
 
   return SetupDevice(std::move(device), create_async_compute_queue,
                      use_sparse_binding);
 }
 
+VulkanApplication::Output* VulkanApplication::AddOutput(uint32_t width,
+                                                       uint32_t height) {
+  if (!entry_data_->CreateAdditionalWindow(width, height)) {
+    log_->LogError("Could not open a window for another output");
+    return nullptr;
+  }
+  VkSurfaceKHR surface = CreateDefaultSurface(
+      &instance_, entry_data_, entry_data_->num_windows() - 1);
+  VkBool32 supported = VK_FALSE;
+  LOG_ASSERT(==, log_, VK_SUCCESS,
+             instance_->vkGetPhysicalDeviceSurfaceSupportKHR(
+                 device_.physical_device(), present_queue_index_, surface,
+                 &supported));
+  if (!supported) {
+    log_->LogError("The present queue cannot present to the new output");
+    return nullptr;
+  }
+  const VkExtent2D extent = {width, height};
+  VkSwapchainKHR swapchain = CreateDefaultSwapchain(
+      &instance_, &device_, &surface, allocator_, render_queue_index_,
+      present_queue_index_, entry_data_, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
+      false, 0, false, nullptr, &extent);
+  additional_outputs_.push_back(containers::make_unique<Output>(
+      allocator_, allocator_, std::move(surface), std::move(swapchain)));
+  Output* output = additional_outputs_.back().get();
+  vulkan::LoadContainer(log_, device_->vkGetSwapchainImagesKHR,
+                        &output->swapchain_images, device_,
+                        output->swapchain);
+  return output;
+}
+
 void VulkanApplication::InitializationComplete() {
   if (entry_data_->write_pipeline_cache()) {
     WritePipelineCache(&device_, &pipeline_cache_, entry_data_->write_pipeline_cache());
   }
 }
 
+ImageLayoutTracker VulkanApplication::CreateLayoutTracker(
+    const VkImageCreateInfo* create_info) {
+  ImageLayoutTracker tracker(allocator_, log_, create_info->mipLevels,
+                             create_info->arrayLayers,
+                             create_info->initialLayout);
+  tracker.set_validate(entry_data_->validation());
+  return tracker;
+}
+
 containers::unique_ptr<VulkanApplication::Image>
 VulkanApplication::CreateAndBindImage(const VkImageCreateInfo* create_info,
                                       const uint32_t* device_indices) {
   ::VkImage image;
   LOG_ASSERT(==, log_,
-             device_->vkCreateImage(device_, create_info, nullptr, &image),
+             device_->vkCreateImage(
+                 device_, create_info,
+                 GetDriverAllocator(&device_, VK_OBJECT_TYPE_IMAGE), &image),
              VK_SUCCESS);
   VkMemoryRequirements requirements;
   device_->vkGetImageMemoryRequirements(device_, image, &requirements);
@@ -469,7 +582,13 @@ VulkanApplication::CreateAndBindImage(const VkImageCreateInfo* create_info,
   ::VkDeviceMemory memory;
   ::VkDeviceSize offset;
 
-  AllocationToken* token = device_only_image_heap_->AllocateMemory(
+  VulkanArena* heap = device_only_image_heap_.get();
+  if (transient_image_heap_ &&
+      (create_info->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)) {
+    heap = transient_image_heap_.get();
+  }
+
+  AllocationToken* token = heap->AllocateMemory(
       requirements.size, requirements.alignment, &memory, &offset, nullptr);
 
   if (device_.num_devices() > 1) {
@@ -499,8 +618,9 @@ VulkanApplication::CreateAndBindImage(const VkImageCreateInfo* create_info,
   // We have to do it this way because Image is private and friended,
   // so we cannot go through make_unique.
   Image* img = new (allocator_->malloc(sizeof(Image)))
-      Image(device_only_image_heap_.get(), token,
-            VkImage(image, nullptr, &device_), create_info->format);
+      Image(heap, token, VkImage(image, device_.allocator(), &device_),
+            create_info->format, CreateLayoutTracker(create_info),
+            image_view_cache_.get());
 
   return containers::unique_ptr<Image>(
       img, containers::UniqueDeleter(allocator_, sizeof(Image)));
@@ -515,7 +635,9 @@ VulkanApplication::CreateAndBindSparseImage(
   LOG_ASSERT(==, log_, sparse_binding_queue_ != nullptr, true);
   ::VkImage image;
   LOG_ASSERT(==, log_,
-             device_->vkCreateImage(device_, create_info, nullptr, &image),
+             device_->vkCreateImage(
+                 device_, create_info,
+                 GetDriverAllocator(&device_, VK_OBJECT_TYPE_IMAGE), &image),
              VK_SUCCESS);
   VkMemoryRequirements requirements;
   device_->vkGetImageMemoryRequirements(device_, image, &requirements);
@@ -562,7 +684,8 @@ VulkanApplication::CreateAndBindSparseImage(
   // so we cannot go through make_unique.
   SparseImage* img = new (allocator_->malloc(sizeof(SparseImage)))
       SparseImage(device_only_image_heap_.get(), std::move(tokens),
-                  VkImage(image, nullptr, &device_), create_info->format);
+                  VkImage(image, device_.allocator(), &device_),
+                  create_info->format);
 
   return containers::unique_ptr<SparseImage>(
       img, containers::UniqueDeleter(allocator_, sizeof(SparseImage)));
@@ -573,7 +696,9 @@ VulkanApplication::CreateAndBindMultiPlanarImage(
     const VkImageCreateInfo* create_info, const uint32_t* device_indices) {
   ::VkImage image;
   LOG_ASSERT(==, log_,
-             device_->vkCreateImage(device_, create_info, nullptr, &image),
+             device_->vkCreateImage(
+                 device_, create_info,
+                 GetDriverAllocator(&device_, VK_OBJECT_TYPE_IMAGE), &image),
              VK_SUCCESS);
 
   AllocationToken* token;
@@ -643,9 +768,10 @@ VulkanApplication::CreateAndBindMultiPlanarImage(
 
   // We have to do it this way because Image is private and friended,
   // so we cannot go through make_unique.
-  Image* img = new (allocator_->malloc(sizeof(Image)))
-      Image(device_only_image_heap_.get(), token,
-            VkImage(image, nullptr, &device_), create_info->format);
+  Image* img = new (allocator_->malloc(sizeof(Image))) Image(
+      device_only_image_heap_.get(), token,
+      VkImage(image, device_.allocator(), &device_), create_info->format,
+      CreateLayoutTracker(create_info), image_view_cache_.get());
 
   return containers::unique_ptr<Image>(
       img, containers::UniqueDeleter(allocator_, sizeof(Image)));
@@ -666,12 +792,30 @@ containers::unique_ptr<VkImageView> VulkanApplication::CreateImageView(
       subresource_range,
   };
   ::VkImageView raw_view;
-  LOG_ASSERT(
-      ==, log_,
-      device_->vkCreateImageView(device_, &create_info, nullptr, &raw_view),
-      VK_SUCCESS);
+  LOG_ASSERT(==, log_,
+             device_->vkCreateImageView(
+                 device_, &create_info,
+                 GetDriverAllocator(&device_, VK_OBJECT_TYPE_IMAGE_VIEW),
+                 &raw_view),
+             VK_SUCCESS);
   return containers::make_unique<vulkan::VkImageView>(
-      allocator_, VkImageView(raw_view, nullptr, &device_));
+      allocator_, VkImageView(raw_view, device_.allocator(), &device_));
+}
+
+CachedImageView VulkanApplication::GetCachedImageView(
+    const Image* image, VkImageViewType view_type,
+    const VkImageSubresourceRange& subresource_range, VkFormat format,
+    const VkComponentMapping& components) {
+  return image_view_cache_->Get(ImageViewKey(
+      image->get_raw_image(), view_type,
+      format == VK_FORMAT_UNDEFINED ? image->format() : format,
+      subresource_range, components));
+}
+
+CachedSampler VulkanApplication::GetCachedSampler(
+    const VkSamplerCreateInfo& create_info) {
+  LOG_ASSERT(==, log_, true, create_info.pNext == nullptr);
+  return sampler_cache_->Get(SamplerKey(create_info));
 }
 
 containers::unique_ptr<VulkanApplication::Buffer>
@@ -680,7 +824,9 @@ VulkanApplication::CreateAndBindBuffer(VulkanArena* heap,
                                        const uint32_t* device_indices) {
   ::VkBuffer buffer;
   LOG_ASSERT(==, log_,
-             device_->vkCreateBuffer(device_, create_info, nullptr, &buffer),
+             device_->vkCreateBuffer(
+                 device_, create_info,
+                 GetDriverAllocator(&device_, VK_OBJECT_TYPE_BUFFER), &buffer),
              VK_SUCCESS);
   // Get the memory requirements for this buffer.
   VkMemoryRequirements requirements;
@@ -713,14 +859,27 @@ VulkanApplication::CreateAndBindBuffer(VulkanArena* heap,
     device_->vkBindBufferMemory(device_, buffer, memory, offset);
   }
 
+  if (heap->debug_name()) {
+    debug_labels_.SetName(&device_, VK_OBJECT_TYPE_BUFFER, uint64_t(buffer),
+                          heap->debug_name());
+  }
+
   Buffer* buff = new (allocator_->malloc(sizeof(Buffer))) Buffer(
-      heap, token, VkBuffer(buffer, nullptr, &device_), base_address, device_,
-      memory, offset, requirements.size, &(device_->vkFlushMappedMemoryRanges),
-      &(device_->vkInvalidateMappedMemoryRanges));
+      heap, token, VkBuffer(buffer, device_.allocator(), &device_),
+      base_address, device_, memory, offset, requirements.size,
+      &(device_->vkFlushMappedMemoryRanges),
+      &(device_->vkInvalidateMappedMemoryRanges), mapped_range_batcher_.get(),
+      log_);
   return containers::unique_ptr<Buffer>(
       buff, containers::UniqueDeleter(allocator_, sizeof(Buffer)));
 }
 
+void VulkanApplication::NameArena(VulkanArena* arena, const char* name) {
+  arena->set_debug_name(name);
+  debug_labels_.SetName(&device_, VK_OBJECT_TYPE_DEVICE_MEMORY,
+                        uint64_t(arena->memory()), name);
+}
+
 containers::unique_ptr<VulkanApplication::Buffer>
 VulkanApplication::CreateAndBindHostBuffer(
     const VkBufferCreateInfo* create_info, const uint32_t* device_indices) {
@@ -841,13 +1000,23 @@ containers::unique_ptr<VkBufferView> VulkanApplication::CreateBufferView(
       range,                                      // range
   };
   ::VkBufferView raw_view;
-  LOG_ASSERT(
-      ==, log_,
-      device_->vkCreateBufferView(device_, &create_info, nullptr, &raw_view),
-      VK_SUCCESS);
+  LOG_ASSERT(==, log_,
+             device_->vkCreateBufferView(
+                 device_, &create_info,
+                 GetDriverAllocator(&device_, VK_OBJECT_TYPE_BUFFER_VIEW),
+                 &raw_view),
+             VK_SUCCESS);
   return containers::make_unique<vulkan::VkBufferView>(
-      allocator_, VkBufferView(raw_view, nullptr, &device_));
+      allocator_, VkBufferView(raw_view, device_.allocator(), &device_));
+}
+
+namespace {
+// Returns the subresource range covering the given layers of one mip level.
+VkImageSubresourceRange LayersToRange(const VkImageSubresourceLayers& layers) {
+  return {layers.aspectMask, layers.mipLevel, 1, layers.baseArrayLayer,
+          layers.layerCount};
 }
+}  // anonymous namespace
 
 std::tuple<bool, VkCommandBuffer, BufferPointer>
 VulkanApplication::FillImageLayersData(
@@ -856,6 +1025,22 @@ VulkanApplication::FillImageLayersData(
     VkImageLayout initial_img_layout, const containers::vector<uint8_t>& data,
     std::initializer_list<::VkSemaphore> wait_semaphores,
     std::initializer_list<::VkSemaphore> signal_semaphores, ::VkFence fence) {
+  if (img) {
+    img->layout_tracker()->Expect(LayersToRange(image_subresource),
+                                  initial_img_layout);
+  }
+  return FillImageLayersData(img, image_subresource, image_offset,
+                             image_extent, data, wait_semaphores,
+                             signal_semaphores, fence);
+}
+
+std::tuple<bool, VkCommandBuffer, BufferPointer>
+VulkanApplication::FillImageLayersData(
+    Image* img, const VkImageSubresourceLayers& image_subresource,
+    const VkOffset3D& image_offset, const VkExtent3D& image_extent,
+    const containers::vector<uint8_t>& data,
+    std::initializer_list<::VkSemaphore> wait_semaphores,
+    std::initializer_list<::VkSemaphore> signal_semaphores, ::VkFence fence) {
   auto failure_return = std::make_tuple(
       false,
       VkCommandBuffer(static_cast<::VkCommandBuffer>(VK_NULL_HANDLE),
@@ -898,6 +1083,7 @@ VulkanApplication::FillImageLayersData(
   VkCommandBufferBeginInfo cmd_begin_info{
       VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, nullptr, 0, nullptr};
   command_buffer->vkBeginCommandBuffer(command_buffer, &cmd_begin_info);
+  debug_labels_.BeginLabel(&command_buffer, "Image upload");
   // Add a buffer barrier so that the flushed memory becomes visible to the
   // device.
   VkBufferMemoryBarrier buffer_barrier{
@@ -911,30 +1097,18 @@ VulkanApplication::FillImageLayersData(
       0,
       data.size(),
   };
-  // Add an image barrier to change the layout set its access bit to transfer
-  // write.
-  VkImageMemoryBarrier image_barrier{
-      VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-      nullptr,
-      0,  // Change to write access, no read-after-write risk.
-      VK_ACCESS_TRANSFER_WRITE_BIT,
-      initial_img_layout,
-      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      VK_QUEUE_FAMILY_IGNORED,
-      VK_QUEUE_FAMILY_IGNORED,
-      *img,
-      // subresource range, only deal one mip level
-      {
-          image_subresource.aspectMask,
-          image_subresource.mipLevel,
-          1,
-          image_subresource.baseArrayLayer,
-          image_subresource.layerCount,
-      }};
+  // Add the image barriers that the tracker asks for to change the layout
+  // and set the access bits to transfer write.
+  containers::vector<VkImageMemoryBarrier> image_barriers(allocator_);
+  VkPipelineStageFlags src_stages = VK_PIPELINE_STAGE_HOST_BIT;
+  img->layout_tracker()->Transition(
+      *img, LayersToRange(image_subresource),
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, &image_barriers, &src_stages);
   command_buffer->vkCmdPipelineBarrier(
-      command_buffer, VK_PIPELINE_STAGE_HOST_BIT,
-      VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &buffer_barrier, 1,
-      &image_barrier);
+      command_buffer, src_stages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+      nullptr, 1, &buffer_barrier, uint32_t(image_barriers.size()),
+      image_barriers.data());
   // Copy data to the image.
   VkBufferImageCopy copy_info{
       0, 0, 0, image_subresource, image_offset, image_extent};
@@ -955,6 +1129,7 @@ VulkanApplication::FillImageLayersData(
                                           // commands.
       0, 1, &end_barrier, 0, nullptr, 0, nullptr);
 
+  debug_labels_.EndLabel(&command_buffer);
   command_buffer->vkEndCommandBuffer(command_buffer);
   // Submit the command buffer.
   ::VkCommandBuffer raw_cmd_buf = command_buffer.get_command_buffer();
@@ -987,6 +1162,8 @@ void VulkanApplication::FillSmallBuffer(Buffer* buffer, const void* data,
     command_buffer->set_device_mask(device_mask);
   }
   LOG_ASSERT(==, log_, 0, data_size % 4);
+  ScopedDebugLabel<VkCommandBuffer> label(debug_labels_, command_buffer,
+                                          "Buffer upload");
   size_t upload_offset = 0;
   while (upload_offset != data_size) {
     size_t upload_left = (data_size - upload_offset);
@@ -1036,7 +1213,8 @@ void VulkanApplication::FillHostVisibleBuffer(Buffer* buffer, const void* data,
   const char* d = reinterpret_cast<const char*>(data);
   size_t size = buffer->size() < data_size ? buffer->size() : data_size;
   memcpy(p + buffer_offset, d, size);
-  buffer->flush();
+  buffer->defer_flush(buffer_offset, size);
+  mapped_range_batcher_->Flush();
   if (command_buffer) {
     VkBufferMemoryBarrier buf_barrier{
         VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
@@ -1062,6 +1240,19 @@ bool VulkanApplication::DumpImageLayersData(
     const VkOffset3D& image_offset, const VkExtent3D& image_extent,
     VkImageLayout initial_img_layout, containers::vector<uint8_t>* data,
     std::initializer_list<::VkSemaphore> wait_semaphores) {
+  if (img) {
+    img->layout_tracker()->Expect(LayersToRange(image_subresource),
+                                  initial_img_layout);
+  }
+  return DumpImageLayersData(img, image_subresource, image_offset,
+                             image_extent, data, wait_semaphores);
+}
+
+bool VulkanApplication::DumpImageLayersData(
+    Image* img, const VkImageSubresourceLayers& image_subresource,
+    const VkOffset3D& image_offset, const VkExtent3D& image_extent,
+    containers::vector<uint8_t>* data,
+    std::initializer_list<::VkSemaphore> wait_semaphores) {
   if (!img) {
     log_->LogError("DumpImageLayersData(): The given *img is nullptr");
     return false;
@@ -1113,30 +1304,21 @@ bool VulkanApplication::DumpImageLayersData(
       0,
       data->size(),
   };
-  // Add an image barrier to change the layout and set its access bit to
-  // transfer read.
-  VkImageMemoryBarrier image_barrier{
-      VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-      nullptr,
-      kAllWriteBits,
-      VK_ACCESS_TRANSFER_READ_BIT,
-      initial_img_layout,
-      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-      VK_QUEUE_FAMILY_IGNORED,
-      VK_QUEUE_FAMILY_IGNORED,
-      *img,
-      // subresource range, only deal with one mip level
-      {
-          image_subresource.aspectMask,
-          image_subresource.mipLevel,
-          1,
-          image_subresource.baseArrayLayer,
-          image_subresource.layerCount,
-      }};
+  // Add the image barriers that the tracker asks for to change the layout
+  // and set the access bits to transfer read. These only wait on the writes
+  // and stages that actually touched the image.
+  containers::vector<VkImageMemoryBarrier> image_barriers(allocator_);
+  VkPipelineStageFlags src_stages = 0;
+  img->layout_tracker()->Transition(
+      *img, LayersToRange(image_subresource),
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, &image_barriers, &src_stages);
   command_buffer->vkCmdPipelineBarrier(
-      command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
-      VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &buffer_barrier, 1,
-      &image_barrier);
+      command_buffer,
+      src_stages ? src_stages
+                 : VkPipelineStageFlags(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+      VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &buffer_barrier,
+      uint32_t(image_barriers.size()), image_barriers.data());
   // Copy data from the image.
   VkBufferImageCopy copy_info{
       0, 0, 0, image_subresource, image_offset, image_extent};
@@ -1201,9 +1383,12 @@ VulkanArena::VulkanArena(containers::Allocator* allocator, logging::Logger* log,
       first_block_(nullptr),
       base_address_(nullptr),
       device_(*device),
+      functions_(device->functions()),
       unmap_memory_function_(nullptr),
-      memory_(VK_NULL_HANDLE, nullptr, device),
-      log_(log) {
+      memory_(VK_NULL_HANDLE, device->allocator(), device),
+      memory_size_(0),
+      log_(log),
+      debug_name_(nullptr) {
   void* pNext = nullptr;
   VkMemoryAllocateFlagsInfo flags = {
       VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO, nullptr,
@@ -1263,8 +1448,10 @@ VulkanArena::VulkanArena(containers::Allocator* allocator, logging::Logger* log,
       allocate_info.allocationSize = buffer_size;
     }
 
-    res = (*device)->vkAllocateMemory(*device, &allocate_info, nullptr,
-                                      &device_memory);
+    res = (*device)->vkAllocateMemory(
+        *device, &allocate_info,
+        GetDriverAllocator(device, VK_OBJECT_TYPE_DEVICE_MEMORY),
+        &device_memory);
     // If we cannot even allocate 1/4 of the requested memory, it is time to
     // fail.
   } while ((res == VK_ERROR_OUT_OF_DEVICE_MEMORY ||
@@ -1272,6 +1459,7 @@ VulkanArena::VulkanArena(containers::Allocator* allocator, logging::Logger* log,
            buffer_size > original_size / 4);
   LOG_ASSERT(==, log, VK_SUCCESS, res);
   memory_.initialize(device_memory);
+  memory_size_ = buffer_size;
 
   // Create a new pointer that is the first block of memory. It contains
   // all of the memory in the arena.
@@ -1297,6 +1485,26 @@ VulkanArena::VulkanArena(containers::Allocator* allocator, logging::Logger* log,
 }
 
 VulkanArena::~VulkanArena() {
+  if (functions_->in_bulk_teardown()) {
+    // The memory goes away with the device, so skip the unmap, and release
+    // every block in one pass instead of checking that they were merged.
+    size_t leaked_blocks = 0;
+    ::VkDeviceSize leaked_bytes = 0;
+    while (first_block_) {
+      AllocationToken* next = first_block_->next;
+      if (first_block_->in_use) {
+        leaked_blocks += 1;
+        leaked_bytes += first_block_->allocationSize;
+      }
+      allocator_->destroy(first_block_);
+      first_block_ = next;
+    }
+    if (leaked_blocks) {
+      log_->LogInfo("Arena torn down with ", leaked_blocks,
+                    " blocks still in use, ", leaked_bytes, " bytes");
+    }
+    return;
+  }
   // Make sure that there is only one block left, and that is is not in use.
   // This will trigger if someone has not freed all the memory before the
   // heap has been destroyed.
@@ -1420,6 +1628,10 @@ AllocationToken* VulkanArena::AllocateMemory(::VkDeviceSize size,
 }
 
 void VulkanArena::FreeMemory(AllocationToken* token) {
+  if (functions_->in_bulk_teardown()) {
+    token->in_use = false;
+    return;
+  }
   bool atAll = false;
   // First try to coalesce this with its previous block.
   while (token->prev && !token->prev->in_use) {
@@ -1475,7 +1687,8 @@ VulkanGraphicsPipeline::VulkanGraphicsPipeline(containers::Allocator* allocator,
       shader_modules_(allocator),
       attachments_(allocator),
       layout_(*layout),
-      pipeline_(VK_NULL_HANDLE, nullptr, &application->device()),
+      pipeline_(VK_NULL_HANDLE, application->device().allocator(),
+                &application->device()),
       contained_stages_(0),
       pipeline_extensions_(nullptr) {
   MemoryClear(&vertex_input_state_);
@@ -1578,9 +1791,12 @@ void VulkanGraphicsPipeline::AddShader(VkShaderStageFlagBits stage,
   ::VkShaderModule module;
   LOG_ASSERT(==, application_->GetLogger(), VK_SUCCESS,
              application_->device()->vkCreateShaderModule(
-                 application_->device(), &create_info, nullptr, &module));
-  shader_modules_.push_back(
-      VkShaderModule(module, nullptr, &application_->device()));
+                 application_->device(), &create_info,
+                 GetDriverAllocator(&application_->device(),
+                                    VK_OBJECT_TYPE_SHADER_MODULE),
+                 &module));
+  shader_modules_.push_back(VkShaderModule(
+      module, application_->device().allocator(), &application_->device()));
 
   stages_.push_back({
       VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,  // sType
@@ -1665,25 +1881,33 @@ void VulkanGraphicsPipeline::AddDynamicState(VkDynamicState dynamic_state) {
   dynamic_states_.push_back(dynamic_state);
 }
 
-void VulkanGraphicsPipeline::AddInputStream(
+uint32_t VulkanGraphicsPipeline::AddInputStream(
     uint32_t stride, VkVertexInputRate input_rate,
     std::initializer_list<InputStream> inputs) {
-  vertex_binding_descriptions_.push_back(
-      {static_cast<uint32_t>(vertex_binding_descriptions_.size()), stride,
-       input_rate});
+  const uint32_t binding =
+      static_cast<uint32_t>(vertex_binding_descriptions_.size());
+  vertex_binding_descriptions_.push_back({binding, stride, input_rate});
   for (auto input : inputs) {
     vertex_attribute_descriptions_.push_back(
-        {input.binding,
-         static_cast<uint32_t>(vertex_binding_descriptions_.size() - 1),
-         input.format, input.offset});
+        {input.binding, binding, input.format, input.offset});
   }
+  return binding;
 }
 
 void VulkanGraphicsPipeline::SetInputStreams(VulkanModel* model) {
+  LOG_ASSERT(==, application_->GetLogger(), true,
+             vertex_binding_descriptions_.empty());
   model->GetAssemblyInfo(&vertex_binding_descriptions_,
                          &vertex_attribute_descriptions_);
 }
 
+void VulkanGraphicsPipeline::SetInputStreams(MeshPool* pool) {
+  LOG_ASSERT(==, application_->GetLogger(), true,
+             vertex_binding_descriptions_.empty());
+  pool->GetAssemblyInfo(&vertex_binding_descriptions_,
+                        &vertex_attribute_descriptions_);
+}
+
 void VulkanGraphicsPipeline::SetPipelineExtensions(
     const void* pipeline_extensions) {
   pipeline_extensions_ = pipeline_extensions;
@@ -1742,8 +1966,14 @@ void VulkanGraphicsPipeline::Commit() {
   LOG_ASSERT(==, application_->GetLogger(), VK_SUCCESS,
              application_->device()->vkCreateGraphicsPipelines(
                  application_->device(), application_->pipeline_cache(), 1,
-                 &create_info, nullptr, &pipeline));
+                 &create_info,
+                 GetDriverAllocator(&application_->device(),
+                                    VK_OBJECT_TYPE_PIPELINE),
+                 &pipeline));
   pipeline_.initialize(pipeline);
+  application_->debug_labels().SetName(&application_->device(),
+                                       VK_OBJECT_TYPE_PIPELINE,
+                                       uint64_t(pipeline), "Graphics pipeline");
 }
 
 VulkanComputePipeline::VulkanComputePipeline(
@@ -1752,13 +1982,17 @@ VulkanComputePipeline::VulkanComputePipeline(
     const VkShaderModuleCreateInfo& shader_module_create_info,
     const char* shader_entry, const VkSpecializationInfo* specialization_info)
     : application_(application),
-      pipeline_(VK_NULL_HANDLE, nullptr, &application->device()),
-      shader_module_(VK_NULL_HANDLE, nullptr, &application->device()),
+      pipeline_(VK_NULL_HANDLE, application->device().allocator(),
+                &application->device()),
+      shader_module_(VK_NULL_HANDLE, application->device().allocator(),
+                     &application->device()),
       layout_(*layout) {
   ::VkShaderModule raw_module;
   LOG_ASSERT(==, application_->GetLogger(), VK_SUCCESS,
              application_->device()->vkCreateShaderModule(
-                 application_->device(), &shader_module_create_info, nullptr,
+                 application_->device(), &shader_module_create_info,
+                 GetDriverAllocator(&application_->device(),
+                                    VK_OBJECT_TYPE_SHADER_MODULE),
                  &raw_module));
   shader_module_.initialize(raw_module);
   VkPipelineShaderStageCreateInfo shader_stage_create_info{
@@ -1785,8 +2019,14 @@ VulkanComputePipeline::VulkanComputePipeline(
   LOG_ASSERT(==, application_->GetLogger(), VK_SUCCESS,
              application_->device()->vkCreateComputePipelines(
                  application_->device(), application_->pipeline_cache(), 1,
-                 &pipeline_create_info, nullptr, &pipeline));
+                 &pipeline_create_info,
+                 GetDriverAllocator(&application_->device(),
+                                    VK_OBJECT_TYPE_PIPELINE),
+                 &pipeline));
   pipeline_.initialize(pipeline);
+  application_->debug_labels().SetName(&application_->device(),
+                                       VK_OBJECT_TYPE_PIPELINE,
+                                       uint64_t(pipeline), "Compute pipeline");
 }
 
 ::VkDeviceSize VulkanApplication::Image::size() const {
@@ -24,7 +24,13 @@
 #include "support/containers/vector.h"
 #include "support/entry/entry.h"
 #include "support/log/log.h"
+#include "vulkan_helpers/debug_labels.h"
+#include "vulkan_helpers/driver_memory_tracker.h"
 #include "vulkan_helpers/helper_functions.h"
+#include "vulkan_helpers/image_layout_tracker.h"
+#include "vulkan_helpers/mapped_range_batcher.h"
+#include "vulkan_helpers/mapped_span.h"
+#include "vulkan_helpers/object_cache.h"
 #include "vulkan_wrapper/command_buffer_wrapper.h"
 #include "vulkan_wrapper/device_wrapper.h"
 #include "vulkan_wrapper/instance_wrapper.h"
@@ -34,6 +40,7 @@
 
 namespace vulkan {
 struct VulkanModel;
+class MeshPool;
 struct AllocationToken;
 
 // This class represents a location in GPU memory for storing data.
@@ -57,18 +64,33 @@ class VulkanArena {
                                   ::VkDeviceMemory* memory,
                                   ::VkDeviceSize* offset, char** base_address);
 
-  // Frees the memory pointed to by the AllocationToken.
+  // Frees the memory pointed to by the AllocationToken. Once the device is
+  // in bulk teardown this only marks the block as unused, and the blocks are
+  // all released together when the arena is destroyed.
   void FreeMemory(AllocationToken* token);
 
+  ::VkDeviceMemory memory() const { return memory_.get_raw_object(); }
+  // The size of memory(), which may be less than was asked for if the
+  // device was short on memory.
+  ::VkDeviceSize memory_size() const { return memory_size_; }
+
+  // The name that the memory of this arena, and the buffers bound to it,
+  // are given when debug labels are enabled.
+  const char* debug_name() const { return debug_name_; }
+  void set_debug_name(const char* name) { debug_name_ = name; }
+
  private:
   containers::Allocator* allocator_;
   containers::ordered_multimap<::VkDeviceSize, AllocationToken*> freeblocks_;
   AllocationToken* first_block_;
   char* base_address_;
   ::VkDevice device_;
+  const DeviceFunctions* functions_;
   LazyDeviceFunction<PFN_vkUnmapMemory>* unmap_memory_function_;
   VkDeviceMemory memory_;
+  ::VkDeviceSize memory_size_;
   logging::Logger* log_;
+  const char* debug_name_;
 };
 
 class VulkanApplication;
@@ -154,12 +176,15 @@ class VulkanGraphicsPipeline {
   void AddDynamicState(VkDynamicState dynamic_state);
 
   // Adds a vertex input stream to this pipeline, with the given
-  // bindings.
-  void AddInputStream(uint32_t stride, VkVertexInputRate input_rate,
-                      std::initializer_list<InputStream> inputs);
+  // bindings. Returns the vertex buffer binding of the new stream.
+  uint32_t AddInputStream(uint32_t stride, VkVertexInputRate input_rate,
+                          std::initializer_list<InputStream> inputs);
 
-  // Sets the vertex input streams from the given model.
+  // Sets the vertex input streams from the given model. The model's streams
+  // use the bindings from 0 up, so this must be called before any
+  // AddInputStream.
   void SetInputStreams(VulkanModel* model);
+  void SetInputStreams(MeshPool* pool);
 
   // Sets the extensions to create the pipeline with. This is pNext of
   // VkGraphicsPipelineCreateInfo
@@ -234,6 +259,18 @@ struct DescriptorSetLayoutBinding {
   VkDescriptorSetLayoutCreateFlags flags_;
 };
 
+// Something that owns a range of the push constants of a pipeline layout,
+// such as DrawConstants. Passing these to CreatePipelineLayout keeps the
+// ranges of the layout in sync with what is actually pushed.
+class PushConstantSource {
+ public:
+  // Fills in |range| and returns true if push constants are used.
+  virtual bool GetPushConstantRange(VkPushConstantRange* range) const = 0;
+
+ protected:
+  ~PushConstantSource() {}
+};
+
 // PipelineLayout holds a VkPipelineLayout object as well as as set of
 // VkDescriptorSetLayout objects used to create that pipeline layout.
 class PipelineLayout {
@@ -247,8 +284,9 @@ class PipelineLayout {
  private:
   PipelineLayout(containers::Allocator* allocator, VkDevice* device,
                  std::initializer_list<DescriptorSetLayoutBinding> layouts,
-                 std::initializer_list<VkPushConstantRange> ranges = {})
-      : pipeline_layout_(VK_NULL_HANDLE, nullptr, device),
+                 const containers::vector<VkPushConstantRange>&
+                     push_constant_ranges)
+      : pipeline_layout_(VK_NULL_HANDLE, device->allocator(), device),
         descriptor_set_layouts_(allocator) {
     containers::vector<::VkDescriptorSetLayout> raw_layouts(allocator);
     raw_layouts.reserve(layouts.size());
@@ -260,9 +298,6 @@ class PipelineLayout {
       raw_layouts.push_back(descriptor_set_layouts_.back());
     }
 
-    containers::vector<VkPushConstantRange> push_constant_ranges(
-        ranges.begin(), ranges.end(), allocator);
-
     VkPipelineLayoutCreateInfo create_info = {
         VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,  // sType
         nullptr,                                        // pNext
@@ -276,8 +311,10 @@ class PipelineLayout {
 
     ::VkPipelineLayout layout;
     LOG_ASSERT(==, device->GetLogger(), VK_SUCCESS,
-               (*device)->vkCreatePipelineLayout(*device, &create_info, nullptr,
-                                                 &layout));
+               (*device)->vkCreatePipelineLayout(
+                   *device, &create_info,
+                   GetDriverAllocator(device, VK_OBJECT_TYPE_PIPELINE_LAYOUT),
+                   &layout));
     pipeline_layout_.initialize(layout);
   }
   friend class VulkanApplication;
@@ -336,18 +373,34 @@ class VulkanApplication {
   // The Image class holds onto a VkImage as well as memory that is bound to it.
   // When it is destroyed, it will return the memory to the heap from which
   // it was created.
+  // It also tracks the layout and access state of each of its subresources,
+  // see layout_tracker(), and destroys any cached views of itself.
   class Image : public ImageCore {
    public:
-    ~Image() { heap_->FreeMemory(token_); }
+    ~Image() {
+      if (view_cache_) {
+        view_cache_->EvictImage(get_raw_image());
+      }
+      heap_->FreeMemory(token_);
+    }
     ::VkDeviceSize size() const;
 
+    ImageLayoutTracker* layout_tracker() { return &layout_tracker_; }
+
    private:
     friend class ::vulkan::VulkanApplication;
     Image(VulkanArena* heap, AllocationToken* token, VkImage&& image,
-          VkFormat format)
-        : ImageCore(std::move(image), format), heap_(heap), token_(token) {}
+          VkFormat format, ImageLayoutTracker&& layout_tracker,
+          ImageViewCache* view_cache)
+        : ImageCore(std::move(image), format),
+          heap_(heap),
+          token_(token),
+          layout_tracker_(std::move(layout_tracker)),
+          view_cache_(view_cache) {}
     VulkanArena* heap_;
     AllocationToken* token_;
+    ImageLayoutTracker layout_tracker_;
+    ImageViewCache* view_cache_;
   };
 
   // The SparseImage class holds onto a VkImage as well as the memories that
@@ -418,6 +471,42 @@ class VulkanApplication {
       }
     }
 
+    // If this is host-visible memory, adds the given range to the
+    // application's MappedRangeBatcher. The writes are only visible to the
+    // GPU after the next MappedRangeBatcher::Flush().
+    void defer_flush(size_t offset, size_t size) {
+      if (base_address_) {
+        batcher_->AddFlushRange(memory_, heap_->memory_size(), offset_ + offset,
+                                size);
+      }
+    }
+    void defer_flush() { defer_flush(0, static_cast<size_t>(size_)); }
+
+    // Returns a view of |count| elements of type T, starting |offset| bytes
+    // into the host-visible memory. A |count| of kWholeSpan covers the rest
+    // of the buffer. If |invalidate| is true, only the viewed range is
+    // invalidated first, so that GPU writes become visible. No memory is
+    // allocated or copied.
+    static const size_t kWholeSpan = ~size_t(0);
+    template <typename T>
+    MappedSpan<T> mapped_span(size_t offset = 0, size_t count = kWholeSpan,
+                              bool invalidate = true) {
+      LOG_ASSERT(==, log_, true, base_address_ != nullptr);
+      LOG_ASSERT(<=, log_, offset, static_cast<size_t>(size_));
+      const size_t available =
+          (static_cast<size_t>(size_) - offset) / sizeof(T);
+      if (count == kWholeSpan) {
+        count = available;
+      }
+      LOG_ASSERT(<=, log_, count, available);
+      if (invalidate && count != 0) {
+        batcher_->Invalidate(memory_, heap_->memory_size(), offset_ + offset,
+                             count * sizeof(T));
+      }
+      return MappedSpan<T>(log_,
+                           reinterpret_cast<T*>(base_address_ + offset), count);
+    }
+
    private:
     friend class ::vulkan::VulkanApplication;
     Buffer(
@@ -426,7 +515,8 @@ class VulkanApplication {
         ::VkDeviceSize offset, ::VkDeviceSize size,
         LazyDeviceFunction<PFN_vkFlushMappedMemoryRanges>* flush_memory_range,
         LazyDeviceFunction<PFN_vkInvalidateMappedMemoryRanges>*
-            invalidate_memory_range)
+            invalidate_memory_range,
+        MappedRangeBatcher* batcher, logging::Logger* log)
         : base_address_(base_address),
           heap_(heap),
           token_(token),
@@ -436,7 +526,9 @@ class VulkanApplication {
           offset_(offset),
           size_(size),
           flush_memory_range_(flush_memory_range),
-          invalidate_memory_range_(invalidate_memory_range) {}
+          invalidate_memory_range_(invalidate_memory_range),
+          batcher_(batcher),
+          log_(log) {}
     char* base_address_;
     VulkanArena* heap_;
     AllocationToken* token_;
@@ -448,6 +540,8 @@ class VulkanApplication {
     LazyDeviceFunction<PFN_vkFlushMappedMemoryRanges>* flush_memory_range_;
     LazyDeviceFunction<PFN_vkInvalidateMappedMemoryRanges>*
         invalidate_memory_range_;
+    MappedRangeBatcher* batcher_;
+    logging::Logger* log_;
   };
 
   // On creation creates an instance, device, surface, swapchain, queues,
@@ -473,10 +567,13 @@ class VulkanApplication {
       bool use_shared_presentation = false,
       bool use_mutable_swapchain_format = false,
       const void* swapchain_extensions = nullptr, bool use_vulkan_1_1 = false,
-      bool use_10bit_hdr = false, void* device_next = nullptr);
+      bool use_10bit_hdr = false, void* device_next = nullptr,
+      bool track_driver_memory = false);
 
   // Creates an image from the given create_info, and binds memory from the
-  // device-only image Arena.
+  // device-only image Arena. Images created with
+  // VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT are bound to lazily allocated
+  // memory instead, if the device has any.
   containers::unique_ptr<Image> CreateAndBindImage(
       const VkImageCreateInfo* create_info,
       const uint32_t* device_indices = nullptr);
@@ -497,6 +594,23 @@ class VulkanApplication {
   containers::unique_ptr<VkImageView> CreateImageView(
       const Image* image, VkImageViewType view_type,
       const VkImageSubresourceRange& subresource_range);
+  // Returns a view of the given image from the image view cache. Requests
+  // with the same view type, format, subresource range and swizzle share a
+  // single VkImageView, which is destroyed when the last reference to it is
+  // released or when the image is destroyed. A |format| of
+  // VK_FORMAT_UNDEFINED means the format of the image.
+  CachedImageView GetCachedImageView(
+      const Image* image, VkImageViewType view_type,
+      const VkImageSubresourceRange& subresource_range,
+      VkFormat format = VK_FORMAT_UNDEFINED,
+      const VkComponentMapping& components = {
+          VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+          VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY});
+  // Returns a sampler from the sampler cache. Identical create infos share a
+  // single VkSampler, which is destroyed when the last reference to it is
+  // released. |create_info| must not have a pNext chain; samplers that need
+  // one should be made with CreateSampler.
+  CachedSampler GetCachedSampler(const VkSamplerCreateInfo& create_info);
   // Creates a buffer from the given create_info, and binds memory from the
   // host-visible buffer Arena. Also maps the memory needed for the device.
   containers::unique_ptr<Buffer> CreateAndBindHostBuffer(
@@ -551,7 +665,9 @@ class VulkanApplication {
   // signaled. The target image layout will be changed to
   // VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL. If the operation can not be done
   // successfully, this method returns false and a command buffer wrapping
-  // VK_NULL_HANDLE, the layout of the image will not be changed.
+  // VK_NULL_HANDLE, the layout of the image will not be changed. As writes
+  // the layout tracker did not see may have happened, e.g. in a render pass,
+  // all writes to the image are waited on.
   std::tuple<bool, VkCommandBuffer,
              containers::unique_ptr<VulkanApplication::Buffer>>
   FillImageLayersData(
@@ -561,6 +677,17 @@ class VulkanApplication {
       std::initializer_list<::VkSemaphore> wait_semaphores,
       std::initializer_list<::VkSemaphore> signal_semaphores, ::VkFence fence);
 
+  // Same as above, but takes the current layout, and the accesses that have
+  // to be waited on, from the image's layout tracker.
+  std::tuple<bool, VkCommandBuffer,
+             containers::unique_ptr<VulkanApplication::Buffer>>
+  FillImageLayersData(
+      Image* img, const VkImageSubresourceLayers& image_subresource,
+      const VkOffset3D& image_offset, const VkExtent3D& image_extent,
+      const containers::vector<uint8_t>& data,
+      std::initializer_list<::VkSemaphore> wait_semaphores,
+      std::initializer_list<::VkSemaphore> signal_semaphores, ::VkFence fence);
+
   // Fills a small buffer with the given data.
   // This inserts a series of calls to vkCmdUpdateBuffer into the given
   // command_buffer, so it is
@@ -571,9 +698,11 @@ class VulkanApplication {
                        VkAccessFlags target_usage, uint32_t device_mask = 0);
 
   // Fills a mapped host-visible buffer with the given data.
-  // This calls the vkFlushMappedMemoryRanges upon the backing memory of the
-  // given host-visible buffer, then records a buffer memory barrier to the
-  // given command buffer.
+  // This flushes the written range, along with any other pending ranges in
+  // the MappedRangeBatcher, then records a buffer memory barrier to the
+  // given command buffer. The flush cannot wait for the frame's, as the
+  // command buffer may be submitted by code that never flushes the batcher,
+  // e.g. outside of the sample framework.
   void FillHostVisibleBuffer(Buffer* buffer, const void* data, size_t data_size,
                              size_t buffer_offset,
                              VkCommandBuffer* command_buffer,
@@ -586,12 +715,22 @@ class VulkanApplication {
   // returns true and changes the source image layout to
   // VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL if the operation is done
   // successfully, otherwise returns false and keeps the layout unchanged.
+  // As writes the layout tracker did not see may have happened, e.g. in a
+  // render pass, all writes to the image are waited on.
   bool DumpImageLayersData(
       Image* img, const VkImageSubresourceLayers& image_subresource,
       const VkOffset3D& image_offset, const VkExtent3D& image_extent,
       VkImageLayout initial_img_layout, containers::vector<uint8_t>* data,
       std::initializer_list<::VkSemaphore> wait_semaphores);
 
+  // Same as above, but takes the current layout, and the accesses that have
+  // to be waited on, from the image's layout tracker.
+  bool DumpImageLayersData(
+      Image* img, const VkImageSubresourceLayers& image_subresource,
+      const VkOffset3D& image_offset, const VkExtent3D& image_extent,
+      containers::vector<uint8_t>* data,
+      std::initializer_list<::VkSemaphore> wait_semaphores);
+
   // Creates and returns a new primary level CommandBuffer using the
   // Application's default VkCommandPool.
   VkCommandBuffer GetCommandBuffer(uint32_t queueFamilyIndex = 0) {
@@ -697,6 +836,11 @@ class VulkanApplication {
 
   logging::Logger* GetLogger() { return log_; }
 
+  // Returns the properties, including the limits, of the physical device.
+  const VkPhysicalDeviceProperties& physical_device_properties() const {
+    return physical_device_properties_;
+  }
+
   // Creates and returns a shader module from the given spirv code.
   template <int size>
   VkShaderModule CreateShaderModule(uint32_t (&vals)[size]) {
@@ -708,10 +852,12 @@ class VulkanApplication {
         vals                                          // pCode
     };
     ::VkShaderModule module;
-    LOG_ASSERT(
-        ==, log_, VK_SUCCESS,
-        device_->vkCreateShaderModule(device_, &create_info, nullptr, &module));
-    return VkShaderModule(module, nullptr, &device_);
+    LOG_ASSERT(==, log_, VK_SUCCESS,
+               device_->vkCreateShaderModule(
+                   device_, &create_info,
+                   GetDriverAllocator(&device_, VK_OBJECT_TYPE_SHADER_MODULE),
+                   &module));
+    return VkShaderModule(module, device_.allocator(), &device_);
   }
 
   // Returns true if the Present queue is not the same as the present queue.
@@ -719,20 +865,74 @@ class VulkanApplication {
     return present_queue_ != render_queue_;
   }
 
+  // Switches the device to bulk teardown: from now on its child objects
+  // are not destroyed one by one, and the arenas skip their bookkeeping,
+  // until vkDestroyDevice releases everything at once. Swapchains, and the
+  // children of the instance, are still destroyed. The device must be idle,
+  // and nothing may be created or recorded afterwards.
+  void BeginBulkTeardown() { device_.functions()->BeginBulkTeardown(); }
+
+  // Returns the labels that the framework marks its work and objects with.
+  // These do nothing unless the application was run with -debug-labels, and
+  // VK_EXT_debug_utils is available.
+  const DebugLabels& debug_labels() const { return debug_labels_; }
+
+  // Returns the tracker that the driver's host memory allocations for the
+  // device are counted by, or nullptr if they are not tracked.
+  DriverMemoryTracker* driver_memory_tracker() {
+    return driver_memory_tracker_.get();
+  }
+
+  // Returns the batcher that collects deferred flushes and invalidations of
+  // host-visible buffers.
+  MappedRangeBatcher* mapped_range_batcher() {
+    return mapped_range_batcher_.get();
+  }
+
+  // Returns true if transient attachments are backed by lazily allocated
+  // memory.
+  bool HasTransientImageMemory() const {
+    return transient_image_heap_ != nullptr;
+  }
+
   // Creates and returns a PipelineLayout from the given
   // DescriptorSetLayoutBindings
   PipelineLayout CreatePipelineLayout(
       std::initializer_list<DescriptorSetLayoutBinding>
           layouts,
       std::initializer_list<VkPushConstantRange> ranges = {}) {
-    return PipelineLayout(allocator_, &device_, layouts, ranges);
+    return PipelineLayout(
+        allocator_->WithTag(containers::AllocationTag::kPipelines), &device_,
+        layouts,
+        containers::vector<VkPushConstantRange>(ranges.begin(), ranges.end(),
+                                                allocator_));
+  }
+
+  // Creates and returns a PipelineLayout from the given
+  // DescriptorSetLayoutBindings, with the push constant ranges of every
+  // source that uses push constants.
+  PipelineLayout CreatePipelineLayout(
+      std::initializer_list<DescriptorSetLayoutBinding> layouts,
+      std::initializer_list<const PushConstantSource*> sources) {
+    containers::vector<VkPushConstantRange> ranges(allocator_);
+    for (const PushConstantSource* source : sources) {
+      VkPushConstantRange range;
+      if (source->GetPushConstantRange(&range)) {
+        ranges.push_back(range);
+      }
+    }
+    return PipelineLayout(
+        allocator_->WithTag(containers::AllocationTag::kPipelines), &device_,
+        layouts, ranges);
   }
 
   // Allocates a descriptor set with one descriptor according to the given
   // |binding|.
   DescriptorSet AllocateDescriptorSet(
       std::initializer_list<VkDescriptorSetLayoutBinding> bindings) {
-    return DescriptorSet(allocator_, &device_, bindings);
+    return DescriptorSet(
+        allocator_->WithTag(containers::AllocationTag::kDescriptors), &device_,
+        bindings);
   }
 
   VkSwapchainKHR& swapchain() { return swapchain_; }
@@ -740,6 +940,30 @@ class VulkanApplication {
   containers::vector<::VkImage>& swapchain_images() {
     return swapchain_images_;
   }
+
+  // An output besides the main one, with its own window, surface and
+  // swapchain, that is rendered to with the same device, queues and memory.
+  struct Output {
+    Output(containers::Allocator* allocator, VkSurfaceKHR&& surface,
+           VkSwapchainKHR&& swapchain)
+        : surface(std::move(surface)),
+          swapchain(std::move(swapchain)),
+          swapchain_images(allocator) {}
+    VkSurfaceKHR surface;
+    VkSwapchainKHR swapchain;
+    containers::vector<::VkImage> swapchain_images;
+  };
+
+  // Opens another window of the given size, and creates a surface and a
+  // swapchain with the default settings for it. Returns nullptr if no
+  // window can be added on this platform, or if the present queue cannot
+  // present to it.
+  Output* AddOutput(uint32_t width, uint32_t height);
+  size_t num_additional_outputs() const { return additional_outputs_.size(); }
+  Output* additional_output(size_t index) {
+    return additional_outputs_[index].get();
+  }
+
   // Creates a render pass, from the given VkAttachmentDescriptions,
   // VkSubpassDescriptions, and VkSubpassDependencies
   VkRenderPass CreateRenderPass(
@@ -767,16 +991,19 @@ class VulkanApplication {
 
     ::VkRenderPass render_pass;
     LOG_ASSERT(==, log_, VK_SUCCESS,
-               device_->vkCreateRenderPass(device_, &create_info, nullptr,
-                                           &render_pass));
-    return vulkan::VkRenderPass(render_pass, nullptr, &device_);
+               device_->vkCreateRenderPass(
+                   device_, &create_info,
+                   GetDriverAllocator(&device_, VK_OBJECT_TYPE_RENDER_PASS),
+                   &render_pass));
+    return vulkan::VkRenderPass(render_pass, device_.allocator(), &device_);
   }
 
   VulkanGraphicsPipeline CreateGraphicsPipeline(PipelineLayout* layout,
                                                 VkRenderPass* render_pass,
                                                 uint32_t subpass_) {
-    return VulkanGraphicsPipeline(allocator_, layout, this, render_pass,
-                                  subpass_);
+    return VulkanGraphicsPipeline(
+        allocator_->WithTag(containers::AllocationTag::kPipelines), layout,
+        this, render_pass, subpass_);
   }
 
   // Call this when all initialization has been done, and applications
@@ -816,9 +1043,11 @@ class VulkanApplication {
 
     ::VkRenderPass render_pass;
     LOG_ASSERT(==, log_, VK_SUCCESS,
-               device_->vkCreateRenderPass2KHR(device_, &create_info, nullptr,
-                                               &render_pass));
-    return vulkan::VkRenderPass(render_pass, nullptr, &device_);
+               device_->vkCreateRenderPass2KHR(
+                   device_, &create_info,
+                   GetDriverAllocator(&device_, VK_OBJECT_TYPE_RENDER_PASS),
+                   &render_pass));
+    return vulkan::VkRenderPass(render_pass, device_.allocator(), &device_);
   }
 
   // Creates and returns a compute pipeline a shader module created from the
@@ -829,9 +1058,9 @@ class VulkanApplication {
       const VkShaderModuleCreateInfo& shader_module_create_info,
       const char* shader_entry,
       const VkSpecializationInfo* specialization_info = nullptr) {
-    return VulkanComputePipeline(allocator_, layout, this,
-                                 shader_module_create_info, shader_entry,
-                                 specialization_info);
+    return VulkanComputePipeline(
+        allocator_->WithTag(containers::AllocationTag::kPipelines), layout,
+        this, shader_module_create_info, shader_entry, specialization_info);
   }
 
   bool should_exit() const { return should_exit_.load(); }
@@ -853,10 +1082,16 @@ class VulkanApplication {
   containers::Allocator* GetAllocator() { return allocator_; }
 
  private:
+  // Creates the layout tracker for an image created from |create_info|.
+  ImageLayoutTracker CreateLayoutTracker(const VkImageCreateInfo* create_info);
+
   containers::unique_ptr<Buffer> CreateAndBindBuffer(
       VulkanArena* heap, const VkBufferCreateInfo* create_info,
       const uint32_t* device_indices);
 
+  // Gives |arena| and its memory the debug name |name|.
+  void NameArena(VulkanArena* arena, const char* name);
+
   // Intended to be called by the constructor to create the device, since
   // VkDevice does not have a default constructor.
   VkDevice CreateDevice(const std::initializer_list<const char*> extensions,
@@ -900,7 +1135,11 @@ class VulkanApplication {
   uint32_t compute_queue_index_;
   uint32_t sparse_binding_queue_index_;
   bool use_protected_memory_;
+  DebugLabels debug_labels_;
 
+  // Declared before the instance and device, so that it outlives everything
+  // that was allocated through it.
+  containers::unique_ptr<DriverMemoryTracker> driver_memory_tracker_;
   LibraryWrapper library_wrapper_;
   VkInstance instance_;
   VkSurfaceKHR surface_;
@@ -911,23 +1150,45 @@ class VulkanApplication {
   containers::vector<containers::unique_ptr<VulkanArena>> host_accessible_heap_;
   containers::vector<containers::unique_ptr<VulkanArena>> coherent_heap_;
   containers::unique_ptr<VulkanArena> device_only_image_heap_;
+  // Only set if the device has a lazily allocated memory type.
+  containers::unique_ptr<VulkanArena> transient_image_heap_;
   containers::unique_ptr<VulkanArena> device_only_buffer_heap_;
   containers::vector<containers::unique_ptr<VulkanArena>>
       device_peer_memory_heaps_;
   containers::vector<::VkImage> swapchain_images_;
+  containers::vector<containers::unique_ptr<Output>> additional_outputs_;
+  VkPhysicalDeviceProperties physical_device_properties_;
+  containers::unique_ptr<MappedRangeBatcher> mapped_range_batcher_;
+  containers::unique_ptr<SamplerCache> sampler_cache_;
+  containers::unique_ptr<ImageViewCache> image_view_cache_;
   std::atomic<bool> should_exit_;
 };
 
+// Returns a view of the contents of the given host-visible buffer, after
+// making the GPU writes to it visible. The view is only valid as long as
+// the buffer is.
+template <typename T = uint32_t>
+MappedSpan<T> GetHostVisibleBufferView(vulkan::VulkanApplication::Buffer* buf) {
+  return buf->mapped_span<T>();
+}
+
+// Returns a copy of the contents of the given host-visible buffer. Prefer
+// GetHostVisibleBufferView unless the data has to outlive the buffer.
 inline containers::vector<uint32_t> GetHostVisibleBufferData(
     containers::Allocator* allocator, vulkan::VulkanApplication::Buffer* buf) {
-  buf->invalidate();
-  uint32_t* p = reinterpret_cast<uint32_t*>(buf->base_address());
-  containers::vector<uint32_t> data(allocator);
-  data.reserve(static_cast<size_t>(
-      buf->size() / static_cast<VkDeviceSize>(sizeof(uint32_t))));
-  std::for_each(p, p + buf->size() / sizeof(uint32_t),
-                [&data](uint32_t w) { data.push_back(w); });
-  return data;
+  MappedSpan<uint32_t> view = GetHostVisibleBufferView(buf);
+  return containers::vector<uint32_t>(view.begin(), view.end(), allocator);
+}
+
+// Records the barriers needed for the subresources of |image| in |range| to
+// be used in |new_layout| with |dst_access| in |dst_stages|, based on the
+// state tracked for the image. Nothing is recorded if no barrier is needed.
+inline void RecordImageLayoutTransition(
+    VulkanApplication::Image* image, const VkImageSubresourceRange& range,
+    VkImageLayout new_layout, VkAccessFlags dst_access,
+    VkPipelineStageFlags dst_stages, VkCommandBuffer* cmd_buffer) {
+  image->layout_tracker()->Record(cmd_buffer, *image, range, new_layout,
+                                  dst_access, dst_stages);
 }
 
 using BufferPointer = containers::unique_ptr<VulkanApplication::Buffer>;
@@ -118,7 +118,8 @@ struct VulkanModel {
   //    layout(location = 0) in vec3 positions_;
   //    layout(location = 1) in vec2 texture_coords_;
   //    layout(location = 2) in vec3 normals_;
-  void GetAssemblyInfo(
+  // This is the same for every model, and for MeshPool.
+  static void GetAssemblyInfo(
       containers::vector<VkVertexInputBindingDescription>* input_bindings,
       containers::vector<VkVertexInputAttributeDescription>*
           vertex_attribute_descriptions) {
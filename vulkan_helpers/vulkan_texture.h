@@ -165,13 +165,16 @@ struct VulkanTexture {
         {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
 
     ::VkImageView raw_view;
-    LOG_ASSERT(
-        ==, logger_, VK_SUCCESS,
-        application->device()->vkCreateImageView(
-            application->device(), &view_create_info, nullptr, &raw_view));
+    LOG_ASSERT(==, logger_, VK_SUCCESS,
+               application->device()->vkCreateImageView(
+                   application->device(), &view_create_info,
+                   GetDriverAllocator(&application->device(),
+                                      VK_OBJECT_TYPE_IMAGE_VIEW),
+                   &raw_view));
     image_view_ = containers::make_unique<vulkan::VkImageView>(
-        allocator_,
-        vulkan::VkImageView(raw_view, nullptr, &application->device()));
+        allocator_, vulkan::VkImageView(raw_view,
+                                        application->device().allocator(),
+                                        &application->device()));
 
     VkImageMemoryBarrier barrier = {
         VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,  // sType
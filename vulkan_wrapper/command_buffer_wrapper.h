@@ -28,16 +28,15 @@ namespace vulkan {
 // VkCommandBuffer takes the ownership and wraps a native VkCommandBuffer
 // object. It provides lazily initialized function pointers for all of its
 // methods. It will automatically call VkFreeCommandBuffers when it goes out of
-// scope.
+// scope. Apart from the handles and the device mask, everything it needs is
+// in the ObjectContext shared by all the children of the device.
 class VkCommandBuffer {
  public:
   VkCommandBuffer(VkCommandBuffer&& other)
       : command_buffer_(other.command_buffer_),
         pool_(other.pool_),
-        device_(other.device_),
-        log_(other.log_),
-        destruction_function_(other.destruction_function_),
-        functions_(other.functions_) {
+        context_(other.context_),
+        device_mask_(other.device_mask_) {
     other.command_buffer_ = static_cast<::VkCommandBuffer>(VK_NULL_HANDLE);
   }
 
@@ -45,31 +44,26 @@ class VkCommandBuffer {
                   VkDevice* device)
       : command_buffer_(command_buffer),
         pool_(*pool),
-        device_(*device),
-        log_(device->GetLogger()),
-        destruction_function_(&(*device)->vkFreeCommandBuffers),
-        functions_((*device)->command_buffer_functions()) {
-    for (size_t i = 0; i < device->num_devices(); ++i) {
-      default_mask_ |= 1 << i;
-    }
-  }
+        context_(device->functions()->object_context(nullptr)),
+        device_mask_(0) {}
 
   ~VkCommandBuffer() {
-    if (command_buffer_ != VK_NULL_HANDLE) {
-      (*destruction_function_)(device_, pool_, 1, &command_buffer_);
+    if (command_buffer_ != VK_NULL_HANDLE && !context_->skip_destruction()) {
+      context_->functions->vkFreeCommandBuffers(context_->owner, pool_, 1,
+                                                &command_buffer_);
     }
   }
 
-  logging::Logger* GetLogger() { return log_; }
+  logging::Logger* GetLogger() { return context_->GetLogger(); }
 
   void set_device_mask(uint32_t device_mask) {
     device_mask_ = device_mask;
-    functions_->vkCmdSetDeviceMask(command_buffer_, device_mask);
+    functions()->vkCmdSetDeviceMask(command_buffer_, device_mask);
   }
   uint32_t get_device_mask() { return device_mask_; }
 
   void begin_command_buffer(const VkCommandBufferBeginInfo* begin_info) {
-    device_mask_ = default_mask_;
+    device_mask_ = context_->functions->default_device_mask();
     const VkDeviceGroupCommandBufferBeginInfo* dgcbbi = 
       reinterpret_cast<const VkDeviceGroupCommandBufferBeginInfo*>(begin_info->pNext);
     if (dgcbbi &&
@@ -77,25 +71,24 @@ class VkCommandBuffer {
             VK_STRUCTURE_TYPE_DEVICE_GROUP_COMMAND_BUFFER_BEGIN_INFO) {
       device_mask_ = dgcbbi->deviceMask;
     }
-    functions_->vkBeginCommandBuffer(command_buffer_, begin_info);
+    functions()->vkBeginCommandBuffer(command_buffer_, begin_info);
   }
 
  private:
+  CommandBufferFunctions* functions() {
+    return context_->functions->command_buffer_functions();
+  }
+
   ::VkCommandBuffer command_buffer_;
   ::VkCommandPool pool_;
-  ::VkDevice device_;
-  logging::Logger* log_;
-  LazyFunction<PFN_vkFreeCommandBuffers, ::VkDevice, DeviceFunctions>*
-      destruction_function_;
-  CommandBufferFunctions* functions_;
-  uint32_t device_mask_ = 0;
-  uint32_t default_mask_ = 0;
+  const ObjectContext<::VkDevice, DeviceFunctions>* context_;
+  uint32_t device_mask_;
 
  public:
   const ::VkCommandBuffer& get_command_buffer() const { return command_buffer_; }
   operator ::VkCommandBuffer() const { return command_buffer_; }
-  CommandBufferFunctions* operator->() { return functions_; }
-  CommandBufferFunctions& operator*() { return *functions_; }
+  CommandBufferFunctions* operator->() { return functions(); }
+  CommandBufferFunctions& operator*() { return *functions(); }
 };
 
 }  // namespace vulkan
@@ -34,34 +34,28 @@ class VkDescriptorSet {
                   VkDevice* device)
       : descriptor_set_(set),
         pool_(pool),
-        device_(*device),
-        log_(device->GetLogger()),
-        destruction_function_(&(*device)->vkFreeDescriptorSets) {}
+        context_(device->functions()->object_context(nullptr)) {}
 
   VkDescriptorSet(VkDescriptorSet&& other)
       : descriptor_set_(other.descriptor_set_),
         pool_(other.pool_),
-        device_(other.device_),
-        log_(other.log_),
-        destruction_function_(other.destruction_function_) {
+        context_(other.context_) {
     other.descriptor_set_ = VK_NULL_HANDLE;
   }
 
   ~VkDescriptorSet() {
-    if (descriptor_set_ != VK_NULL_HANDLE) {
-      (*destruction_function_)(device_, pool_, 1, &descriptor_set_);
+    if (descriptor_set_ != VK_NULL_HANDLE && !context_->skip_destruction()) {
+      context_->functions->vkFreeDescriptorSets(context_->owner, pool_, 1,
+                                                &descriptor_set_);
     }
   }
 
-  logging::Logger* GetLogger() { return log_; }
+  logging::Logger* GetLogger() { return context_->GetLogger(); }
 
  private:
   ::VkDescriptorSet descriptor_set_;
   ::VkDescriptorPool pool_;
-  ::VkDevice device_;
-  logging::Logger* log_;
-  LazyFunction<PFN_vkFreeDescriptorSets, ::VkDevice, DeviceFunctions>*
-      destruction_function_;
+  const ObjectContext<::VkDevice, DeviceFunctions>* context_;
 
  public:
   const ::VkDescriptorSet& get_raw_object() const { return descriptor_set_; }
@@ -41,24 +41,18 @@ class VkDevice {
   // If properties is not nullptr, then the device_id, vendor_id and
   // driver_version will be copied out of it.
   VkDevice(containers::Allocator* container_allocator, ::VkDevice device,
-           VkAllocationCallbacks* allocator, VkInstance* instance,
+           const VkAllocationCallbacks* allocator, VkInstance* instance,
            VkPhysicalDeviceProperties* properties = nullptr,
            ::VkPhysicalDevice physical_device = VK_NULL_HANDLE,
            uint32_t num_devices = 1)
       : device_(device),
         physical_device_(physical_device),
-        has_allocator_(allocator != nullptr),
         log_(instance->GetLogger()),
         device_id_(0),
         vendor_id_(0),
         driver_version_(0),
         physical_device_memory_properties_({0}),
         num_devices_(num_devices) {
-    if (has_allocator_) {
-      allocator_ = *allocator;
-    } else {
-      memset(&allocator_, 0, sizeof(allocator_));
-    }
     vkGetDeviceProcAddr = reinterpret_cast<PFN_vkGetDeviceProcAddr>(
         instance->get_wrapper()->getProcAddr(*instance, "vkGetDeviceProcAddr"));
     LOG_ASSERT(!=, log_, vkGetDeviceProcAddr,
@@ -68,9 +62,11 @@ class VkDevice {
       vendor_id_ = properties->vendorID;
       driver_version_ = properties->driverVersion;
     }
-    // Initialize the lazily resolved device functions.
+    // Initialize the lazily resolved device functions, which also hold the
+    // context shared by the objects created from this device.
     functions_ = containers::make_unique<DeviceFunctions>(
-        container_allocator, device_, vkGetDeviceProcAddr, log_);
+        container_allocator, device_, vkGetDeviceProcAddr, log_, allocator,
+        num_devices);
     if (physical_device) {
       (*instance)->vkGetPhysicalDeviceMemoryProperties(
           physical_device, &physical_device_memory_properties_);
@@ -80,8 +76,7 @@ class VkDevice {
   ~VkDevice() {
     // functions_ will be nullptr if this has been moved
     if (device_ && functions_) {
-      functions_->vkDestroyDevice(device_,
-                                  has_allocator_ ? &allocator_ : nullptr);
+      functions_->vkDestroyDevice(device_, functions_->allocator());
     }
   }
 
@@ -98,6 +93,11 @@ class VkDevice {
   logging::Logger* GetLogger() { return log_; }
 
   DeviceFunctions* functions() { return functions_.get(); }
+  // The callbacks that the device was created with, or nullptr. Objects
+  // created from the device may be destroyed with these.
+  const VkAllocationCallbacks* allocator() const {
+    return functions_->allocator();
+  }
   ::VkPhysicalDevice physical_device() const { return physical_device_; }
 
   const VkPhysicalDeviceMemoryProperties& physical_device_memory_properties()
@@ -108,11 +108,6 @@ class VkDevice {
  private:
   ::VkDevice device_;
   ::VkPhysicalDevice physical_device_;
-  bool has_allocator_;
-  // Intentionally keep a copy of the callbacks, they are just a bunch of
-  // pointers, but it means we don't force our user to keep the allocator struct
-  // around forever.
-  VkAllocationCallbacks allocator_;
   logging::Logger* log_;
   PFN_vkGetDeviceProcAddr vkGetDeviceProcAddr;
   // Lazily resolved Vulkan device functions.
@@ -17,6 +17,7 @@
 #define VULKAN_WRAPPER_FUNCTION_TABLE_H_
 
 #include "vulkan_wrapper/lazy_function.h"
+#include "vulkan_wrapper/object_context.h"
 
 namespace vulkan {
 
@@ -37,11 +38,15 @@ class InstanceFunctions {
   InstanceFunctions& operator=(const InstanceFunctions& other) = delete;
   InstanceFunctions& operator=(InstanceFunctions&& other) = delete;
 
+  // |allocator| is the set of callbacks the instance was created with, or
+  // nullptr.
   InstanceFunctions(::VkInstance instance,
                     PFN_vkGetInstanceProcAddr get_proc_addr_func,
-                    logging::Logger* log)
+                    logging::Logger* log,
+                    const VkAllocationCallbacks* allocator = nullptr)
       : log_(log),
         vkGetInstanceProcAddr_(get_proc_addr_func),
+        object_contexts_(instance, this, allocator),
 #define CONSTRUCT_LAZY_FUNCTION(function) function(instance, #function, this)
         CONSTRUCT_LAZY_FUNCTION(vkDestroyInstance),
         CONSTRUCT_LAZY_FUNCTION(vkEnumeratePhysicalDevices),
@@ -101,10 +106,24 @@ class InstanceFunctions {
   logging::Logger* log_;
   // The function pointer to Vulkan vkGetInstanceProcAddr().
   PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr_;
+  ObjectContexts<::VkInstance, InstanceFunctions> object_contexts_;
 
  public:
   // Returns the logger. This is required to conform LazyFunction template.
   logging::Logger* GetLogger() { return log_; }
+  // Returns the context shared by the child objects of the instance that
+  // were created with |allocator|.
+  const ObjectContext<::VkInstance, InstanceFunctions>* object_context(
+      const VkAllocationCallbacks* allocator) const {
+    return object_contexts_.Get(allocator);
+  }
+  // The callbacks that the instance was created with, or nullptr.
+  const VkAllocationCallbacks* allocator() const {
+    return object_contexts_.allocator();
+  }
+  // The children of an instance, surfaces and debug messengers, must always
+  // be destroyed before it, so they are never left to the instance.
+  bool in_bulk_teardown() const { return false; }
   // Resolves an instance function with the given name. This is required to
   // conform LazyFunction template.
   PFN_vkVoidFunction getProcAddr(::VkInstance instance, const char* function) {
@@ -338,12 +357,19 @@ class DeviceFunctions {
   DeviceFunctions& operator=(const DeviceFunctions& other) = delete;
   DeviceFunctions& operator=(DeviceFunctions&& other) = delete;
 
+  // |allocator| is the set of callbacks the device was created with, or
+  // nullptr, and |num_devices| the number of physical devices in its group.
   DeviceFunctions(::VkDevice device, PFN_vkGetDeviceProcAddr get_proc_addr_func,
-                  logging::Logger* log)
+                  logging::Logger* log,
+                  const VkAllocationCallbacks* allocator = nullptr,
+                  uint32_t num_devices = 1)
       : log_(log),
         vkGetDeviceProcAddr_(get_proc_addr_func),
         command_buffer_functions_(device, this),
         queue_functions_(device, this),
+        object_contexts_(device, this, allocator),
+        default_device_mask_((1u << num_devices) - 1),
+        in_bulk_teardown_(false),
 #define CONSTRUCT_LAZY_FUNCTION(function) function(device, #function, this)
         CONSTRUCT_LAZY_FUNCTION(vkDestroyDevice),
         CONSTRUCT_LAZY_FUNCTION(vkCreateCommandPool),
@@ -461,10 +487,29 @@ class DeviceFunctions {
   // Functions of sub device objects.
   CommandBufferFunctions command_buffer_functions_;
   QueueFunctions queue_functions_;
+  ObjectContexts<::VkDevice, DeviceFunctions> object_contexts_;
+  uint32_t default_device_mask_;
+  bool in_bulk_teardown_;
 
  public:
   // Returns the logger. This is required to conform LazyFunction template.
   logging::Logger* GetLogger() { return log_; }
+  // Returns the context shared by the child objects of the device that were
+  // created with |allocator|.
+  const ObjectContext<::VkDevice, DeviceFunctions>* object_context(
+      const VkAllocationCallbacks* allocator) const {
+    return object_contexts_.Get(allocator);
+  }
+  // The callbacks that the device was created with, or nullptr.
+  const VkAllocationCallbacks* allocator() const {
+    return object_contexts_.allocator();
+  }
+  // From now on the child objects of the device are not destroyed or freed
+  // one by one, they go away with the device itself.
+  void BeginBulkTeardown() { in_bulk_teardown_ = true; }
+  bool in_bulk_teardown() const { return in_bulk_teardown_; }
+  // The device mask that includes every physical device of the device.
+  uint32_t default_device_mask() const { return default_device_mask_; }
   // Resolves a device function with the given name. This is required to
   // conform LazyFunction template.
   PFN_vkVoidFunction getProcAddr(::VkDevice device, const char* function) {
@@ -36,27 +36,18 @@ namespace vulkan {
 class VkInstance {
  public:
   VkInstance(containers::Allocator* container_allocator, ::VkInstance instance,
-             VkAllocationCallbacks* allocator, LibraryWrapper* wrapper)
-      : instance_(instance),
-        has_allocator_(allocator != nullptr),
-        wrapper_(wrapper) {
-    if (has_allocator_) {
-      allocator_ = *allocator;
-    } else {
-      memset(&allocator_, 0, sizeof(allocator_));
-    }
+             const VkAllocationCallbacks* allocator, LibraryWrapper* wrapper)
+      : instance_(instance), wrapper_(wrapper) {
     functions_ = containers::make_unique<InstanceFunctions>(
         container_allocator, instance_, getProcAddrFunction(),
-        wrapper_->GetLogger());
+        wrapper_->GetLogger(), allocator);
     // functions_.reset(new InstanceFunctions(instance_, getProcAddrFunction(),
     // wrapper_->GetLogger()));
   }
 
   VkInstance(VkInstance&& other)
       : instance_(other.instance_),
-        allocator_(other.allocator_),
         wrapper_(other.wrapper_),
-        has_allocator_(other.has_allocator_),
         functions_(std::move(other.functions_)) {
     other.instance_ = VK_NULL_HANDLE;
   }
@@ -66,8 +57,7 @@ class VkInstance {
 
   ~VkInstance() {
     if (instance_ != VK_NULL_HANDLE) {
-      functions_->vkDestroyInstance(instance_,
-                                    has_allocator_ ? &allocator_ : nullptr);
+      functions_->vkDestroyInstance(instance_, functions_->allocator());
     }
   }
 
@@ -83,11 +73,6 @@ class VkInstance {
 
  private:
   ::VkInstance instance_;
-  bool has_allocator_;
-  // Intentionally keep a copy of the callbacks, they are just a bunch of
-  // pointers, but it means we don't force our user to keep the allocator struct
-  // around forever.
-  VkAllocationCallbacks allocator_;
   LibraryWrapper* wrapper_;
   containers::unique_ptr<InstanceFunctions> functions_;
 
@@ -0,0 +1,97 @@
+/* Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VULKAN_WRAPPER_OBJECT_CONTEXT_H_
+#define VULKAN_WRAPPER_OBJECT_CONTEXT_H_
+
+#include <cstring>
+
+#include "support/log/log.h"
+#include "vulkan_helpers/vulkan_header_wrapper.h"
+
+namespace vulkan {
+
+// ObjectContext is everything that an object created from an instance or a
+// device needs in order to destroy itself and to log. It is shared by all of
+// the objects of one owner, so wrappers only keep a pointer to it next to
+// their handle.
+// H is the raw handle of the owner, and F its function table.
+template <typename H, typename F>
+struct ObjectContext {
+  H owner;
+  F* functions;
+  // The callbacks that the objects using this context were created with, or
+  // nullptr.
+  const VkAllocationCallbacks* allocator;
+
+  logging::Logger* GetLogger() const { return functions->GetLogger(); }
+  // True if objects should no longer be destroyed individually, because
+  // the owner is about to be destroyed with all of them.
+  bool skip_destruction() const { return functions->in_bulk_teardown(); }
+};
+
+// ObjectContexts holds the contexts of one owner: one for objects created
+// without allocation callbacks, and one for objects created with the
+// callbacks that the owner itself was created with. It lives in the function
+// table of the owner, which never moves, so the contexts stay valid for as
+// long as the owner does.
+template <typename H, typename F>
+class ObjectContexts {
+ public:
+  ObjectContexts(const ObjectContexts&) = delete;
+  ObjectContexts& operator=(const ObjectContexts&) = delete;
+
+  ObjectContexts(H owner, F* functions, const VkAllocationCallbacks* allocator)
+      : has_allocator_(allocator != nullptr) {
+    if (has_allocator_) {
+      allocator_ = *allocator;
+    } else {
+      memset(&allocator_, 0, sizeof(allocator_));
+    }
+    contexts_[0] = {owner, functions, nullptr};
+    contexts_[1] = {owner, functions, has_allocator_ ? &allocator_ : nullptr};
+  }
+
+  // Returns the context for objects created with |allocator|. Objects can
+  // only be created with no callbacks or with the callbacks of their owner.
+  const ObjectContext<H, F>* Get(const VkAllocationCallbacks* allocator) const {
+    if (!allocator) {
+      return &contexts_[0];
+    }
+    LOG_ASSERT(==, contexts_[0].GetLogger(), true,
+               has_allocator_ && allocator->pUserData == allocator_.pUserData &&
+                   allocator->pfnAllocation == allocator_.pfnAllocation &&
+                   allocator->pfnReallocation == allocator_.pfnReallocation &&
+                   allocator->pfnFree == allocator_.pfnFree);
+    return &contexts_[1];
+  }
+
+  // The callbacks that the owner was created with, or nullptr.
+  const VkAllocationCallbacks* allocator() const {
+    return contexts_[1].allocator;
+  }
+
+ private:
+  bool has_allocator_;
+  // Intentionally keep a copy of the callbacks, they are just a bunch of
+  // pointers, but it means we don't force our user to keep the allocator
+  // struct around forever.
+  VkAllocationCallbacks allocator_;
+  ObjectContext<H, F> contexts_[2];
+};
+
+}  // namespace vulkan
+
+#endif  // VULKAN_WRAPPER_OBJECT_CONTEXT_H_
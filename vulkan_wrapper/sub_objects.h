@@ -16,6 +16,8 @@
 #ifndef VULKAN_WRAPPER_SUB_OBJECTS_H_
 #define VULKAN_WRAPPER_SUB_OBJECTS_H_
 
+#include <type_traits>
+
 #include "vulkan_helpers/vulkan_header_wrapper.h"
 #include "vulkan_wrapper/device_wrapper.h"
 #include "vulkan_wrapper/instance_wrapper.h"
@@ -25,6 +27,9 @@ namespace vulkan {
 
 // VkSubObject wraps any object that is the child of an instance or device.
 // It exists just so it gets cleaned up when it goes out of scope.
+// It is only two words: the handle, and a pointer to the ObjectContext
+// that all the children of the owner share, which is used to destroy the
+// object and to log.
 // T is expected to be a set of traits that describes the object in question.
 // It should be of the form
 // struct FooTraits {
@@ -35,6 +40,8 @@ namespace vulkan {
 //       {Device|Instance|...}Functions* functions) {
 //     return &functions->vkDestroyVulkanType;
 //   }
+//   // Optional, for objects that must be destroyed even in bulk teardown.
+//   static const bool kDestroyInBulkTeardown = true;
 // }
 // O is expected to be a set of traits that describe the owner of this object.
 // It should be of the form
@@ -42,16 +49,24 @@ namespace vulkan {
 //   using type = VulkanType; // Typically VkDevice or VkInstance
 //   using proc_addr_function_type; // PFN_vkGetInstanceProcAddr for example
 //   using raw_vulkan_type; // Raw vulkan type that this is associated with
+//   using function_table_type; // InstanceFunctions for example
 // }
 //}
+// DestroyInBulkTeardown<T>::value is T::kDestroyInBulkTeardown, or false if
+// T does not declare it.
+template <typename T, typename = void>
+struct DestroyInBulkTeardown : std::false_type {};
+template <typename T>
+struct DestroyInBulkTeardown<T, decltype(void(T::kDestroyInBulkTeardown))>
+    : std::integral_constant<bool, T::kDestroyInBulkTeardown> {};
+
 template <typename T, typename O>
 class VkSubObject {
   using type = typename T::type;
   using owner_type = typename O::type;
   using raw_owner_type = typename O::raw_vulkan_type;
-  using proc_addr_type = typename O::proc_addr_function_type;
-  using destruction_function_pointer_type =
-      typename T::destruction_function_pointer_type;
+  using context_type =
+      ObjectContext<raw_owner_type, typename O::function_table_type>;
 
   static_assert(std::is_copy_constructible<type>::value,
                 "The type must be copy constructible.");
@@ -59,70 +74,52 @@ class VkSubObject {
  public:
   // This does not retain a reference to the owner, or the
   // VkAllocationCallbacks object, it does take ownership of the object in
-  // question.
-  VkSubObject(type raw_object, VkAllocationCallbacks* allocator,
+  // question. |allocator| must either be nullptr, or the callbacks that the
+  // owner was created with.
+  VkSubObject(type raw_object, const VkAllocationCallbacks* allocator,
               owner_type* owner)
-      : owner_(owner ? static_cast<raw_owner_type>(*owner)
-                     : static_cast<raw_owner_type>(VK_NULL_HANDLE)),
-        log_(owner ? owner->GetLogger() : nullptr),
-        has_allocator_(allocator != nullptr),
-        raw_object_(raw_object),
-        destruction_function_(
-            owner ? T::get_destruction_function(owner->functions()) : nullptr),
-        get_proc_addr_fn_(nullptr) {
-    if (allocator) {
-      allocator_ = *allocator;
-    }
-    if (owner) {
-      get_proc_addr_fn_ = owner->getProcAddrFunction();
-    }
-  }
+      : context_(owner ? owner->functions()->object_context(allocator)
+                       : nullptr),
+        raw_object_(raw_object) {}
 
   ~VkSubObject() { clean_up(); }
 
   VkSubObject(VkSubObject<T, O>&& other)
-      : owner_(other.owner_),
-        log_(other.log_),
-        get_proc_addr_fn_(other.get_proc_addr_fn_),
-        allocator_(other.allocator_),
-        has_allocator_(other.has_allocator_),
-        raw_object_(other.raw_object_),
-        destruction_function_(other.destruction_function_) {
+      : context_(other.context_), raw_object_(other.raw_object_) {
     other.raw_object_ = VK_NULL_HANDLE;
   }
 
-  logging::Logger* GetLogger() { return log_; }
+  logging::Logger* GetLogger() {
+    return context_ ? context_->GetLogger() : nullptr;
+  }
 
   void initialize(type raw_object) {
-    LOG_ASSERT(==, log_, true, raw_object_ == VK_NULL_HANDLE);
+    LOG_ASSERT(==, GetLogger(), true, raw_object_ == VK_NULL_HANDLE);
     raw_object_ = raw_object;
   }
 
  private:
   inline void clean_up() {
     if (raw_object_) {
-      LOG_ASSERT(!=, log_, destruction_function_, static_cast<void*>(nullptr));
-      (*destruction_function_)(owner_, raw_object_,
-                               has_allocator_ ? &allocator_ : nullptr);
+      LOG_ASSERT(!=, GetLogger(), static_cast<const void*>(context_),
+                 static_cast<const void*>(nullptr));
+      if (DestroyInBulkTeardown<T>::value || !context_->skip_destruction()) {
+        (*T::get_destruction_function(context_->functions))(
+            context_->owner, raw_object_, context_->allocator);
+      }
       raw_object_ = VK_NULL_HANDLE;
     }
   }
 
-  raw_owner_type owner_;
-  logging::Logger* log_;
-  proc_addr_type get_proc_addr_fn_;
-  VkAllocationCallbacks allocator_;
-  bool has_allocator_;
+  const context_type* context_;
   type raw_object_;
 
-  destruction_function_pointer_type destruction_function_;
-
  public:
   operator type() const { return raw_object_; }
   const type& get_raw_object() const { return raw_object_; }
 
   PFN_vkVoidFunction getProcAddr(raw_owner_type owner, const char* function) {
-    return get_proc_addr_fn_(owner, function);
+    return context_->functions->getProcAddr(owner, function);
   }
 };
 
@@ -137,6 +134,7 @@ struct DeviceTraits {
   using type = VkDevice;
   using proc_addr_function_type = PFN_vkGetDeviceProcAddr;
   using raw_vulkan_type = ::VkDevice;
+  using function_table_type = DeviceFunctions;
 };
 
 struct CommandPoolTraits {
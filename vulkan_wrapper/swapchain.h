@@ -27,37 +27,45 @@ struct SwapchainTraits {
       DeviceFunctions* functions) {
     return &functions->vkDestroySwapchainKHR;
   }
+  // The device does not release the swapchain or its surface, so it must
+  // be destroyed before the device even in bulk teardown.
+  static const bool kDestroyInBulkTeardown = true;
 };
 
 class VkSwapchainKHR : public VkSubObject<SwapchainTraits, DeviceTraits> {
  public:
   VkSwapchainKHR(::VkSwapchainKHR swapchain, VkAllocationCallbacks* allocator,
                  VkDevice* device, uint32_t width, uint32_t height,
-                 uint32_t depth, VkFormat format)
+                 uint32_t depth, VkFormat format,
+                 VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR)
       : VkSubObject<SwapchainTraits, DeviceTraits>(swapchain, allocator,
                                                    device),
         format_(format),
         width_(width),
         height_(height),
-        depth_(depth) {}
+        depth_(depth),
+        present_mode_(present_mode) {}
 
   VkSwapchainKHR(VkSwapchainKHR&& other)
       : VkSubObject<SwapchainTraits, DeviceTraits>(std::move(other)),
         format_(other.format_),
         width_(other.width_),
         height_(other.height_),
-        depth_(other.depth_) {}
+        depth_(other.depth_),
+        present_mode_(other.present_mode_) {}
 
   uint32_t width() const { return width_; }
   uint32_t height() const { return height_; }
   uint32_t depth() const { return depth_; }
   VkFormat format() const { return format_; }
+  VkPresentModeKHR present_mode() const { return present_mode_; }
 
  private:
   VkFormat format_;
   uint32_t width_;
   uint32_t height_;
   uint32_t depth_;
+  VkPresentModeKHR present_mode_;
 };
 }
 